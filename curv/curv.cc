@@ -101,6 +101,8 @@ const char help_infix[] =
 "general options:\n"
 "   -v : Verbose & debug output.\n"
 "   --depr=N : Deprecation warning level 0, 1 or 2; default is 1.\n"
+"   --inline=N : Compile shape functions larger than N bytes of code\n"
+"      only once, instead of inline at each call. -1 means never.\n"
 "   -O name=value : Set parameter controlling the specified output format.\n"
 "      If '-o fmt' is specified, use 'curv --help -o fmt' for help.\n"
 "      If '-o fmt' is not specified, the following parameters are available:\n"
@@ -127,6 +129,7 @@ main(int argc, char** argv)
     Export_Params::Options options;
     bool verbose = false;
     int depr = 1;
+    const char* inline_limit = nullptr;
     bool live = false;
     std::list<const char*> libs;
     bool expr = false;
@@ -137,11 +140,13 @@ main(int argc, char** argv)
     constexpr int HELP = 1000;
     constexpr int VERSION = 1001;
     constexpr int DEPR = 1002;
+    constexpr int INLINE = 1003;
     static const char opts[] = ":o:O:lnNi:xev";
     static struct option longopts[] = {
         {"help",    no_argument,       nullptr, HELP },
         {"version", no_argument,       nullptr, VERSION },
         {"depr",    required_argument, nullptr, DEPR },
+        {"inline",  required_argument, nullptr, INLINE },
         {nullptr,   0,                 nullptr, 0 }
     };
 
@@ -158,6 +163,9 @@ main(int argc, char** argv)
         case DEPR:
             depr = atoi(optarg);
             break;
+        case INLINE:
+            inline_limit = optarg;
+            break;
         case 'o':
           {
             const char* oarg = optarg;
@@ -308,6 +316,8 @@ main(int argc, char** argv)
     // This can fail, so we do as much argument validation as possible
     // before this point.
     curv::System& sys(make_system(usestdlib, libs, std::cerr, verbose, depr));
+    if (inline_limit != nullptr)
+        sys.sc_inline_limit_ = atoi(inline_limit);
     atexit(curv::io::remove_all_tempfiles);
 
     try {
@@ -258,9 +258,20 @@ void export_all_png(
     double animate,
     io::Output_File& ofile)
 {
+    // The CPU renderer JIT compiles the shape once, for all of the frames.
+    std::unique_ptr<io::Compiled_Shape> cshape = nullptr;
+    if (ix.renderer_ == io::Image_Export::Renderer::cpu)
+        cshape = std::make_unique<io::Compiled_Shape>(shape);
+    auto export_frame = [&](io::Output_File& f) -> void {
+        if (cshape)
+            io::export_png_cpu(*cshape, ix, f);
+        else
+            io::export_png(shape, ix, f);
+    };
+
     if (animate <= 0.0) {
         // export single image
-        io::export_png(shape, ix, ofile);
+        export_frame(ofile);
         return;
     }
 
@@ -284,7 +295,7 @@ void export_all_png(
         auto opath = stringify(prefix, num, suffix);
         io::Output_File oofile{shape.system()};
         oofile.set_path(opath->c_str());
-        io::export_png(shape, ix, oofile);
+        export_frame(oofile);
         oofile.commit();
         //std::cerr << ".";
         //std::cerr.flush();
@@ -298,7 +309,9 @@ void describe_png_opts(std::ostream& out)
     "-v : verbose output logged to stderr\n"
     "-O xsize=<image width in pixels>\n"
     "-O ysize=<image height in pixels>\n"
-    "-O fstart=<animation frame start time, in seconds> (default 0)\n";
+    "-O fstart=<animation frame start time, in seconds> (default 0)\n"
+    "-O renderer=#gpu|#cpu (default #gpu) : #cpu ray-marches a JIT compiled\n"
+    "   shape on all CPU cores, and doesn't need OpenGL\n";
     describe_render_opts(out);
     out <<
     "-O animate=<duration of animation> (exports an image sequence)\n";
@@ -326,6 +339,14 @@ void export_png(Value value,
             ix.fstart_ = p.to_double();
         } else if (p.name_ == "animate") {
             animate = p.to_double();
+        } else if (p.name_ == "renderer") {
+            auto val = p.to_symbol();
+            if (val == "gpu")
+                ix.renderer_ = io::Image_Export::Renderer::gpu;
+            else if (val == "cpu")
+                ix.renderer_ = io::Image_Export::Renderer::cpu;
+            else
+                throw Exception(p, "'renderer' must be #gpu or #cpu");
         } else {
             p.unknown_parameter();
         }
@@ -403,11 +424,15 @@ void describe_no_opts(std::ostream&) {}
 
 std::map<std::string, Exporter> exporters = {
     {"curv", {export_curv, "Curv expression", describe_no_opts}},
-    {"stl", {export_stl, "STL mesh file (3D shape only)", describe_mesh_opts}},
+    {"stl", {export_stl, "STL mesh file (3D shape only)", describe_stl_opts}},
     {"obj", {export_obj, "OBJ mesh file (3D shape only)", describe_mesh_opts}},
     {"x3d", {export_x3d, "X3D colour mesh file (3D shape only)",
              describe_colour_mesh_opts}},
-    {"gltf", {export_gltf, "GLTF file (3D shape only)", describe_mesh_opts}},
+    {"gltf", {export_gltf, "GLTF file (3D shape only)", describe_gltf_opts}},
+    {"glb", {export_glb, "binary GLTF file (3D shape only)",
+             describe_gltf_opts}},
+    {"ply", {export_ply, "binary PLY mesh file (3D shape only)",
+             describe_mesh_opts}},
     {"gpu", {export_gpu, "compiled GPU program, in Curv format (shape only)",
         describe_render_opts}},
     {"jgpu", {export_jgpu, "compiled GPU program, in JSON format (shape only)",
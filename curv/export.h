@@ -120,6 +120,16 @@ extern void export_gltf(curv::Value,
     const Export_Params& params,
     curv::io::Output_File&);
 
+extern void export_glb(curv::Value,
+    curv::Program&,
+    const Export_Params& params,
+    curv::io::Output_File&);
+
+extern void export_ply(curv::Value,
+    curv::Program&,
+    const Export_Params& params,
+    curv::io::Output_File&);
+
 extern void export_json(curv::Value value,
     curv::Program&,
     const Export_Params& params,
@@ -139,6 +149,8 @@ extern void export_png(curv::Value value,
     curv::io::Output_File&);
 
 void describe_mesh_opts(std::ostream&);
+void describe_stl_opts(std::ostream&);
+void describe_gltf_opts(std::ostream&);
 void describe_colour_mesh_opts(std::ostream&);
 
 void parse_viewer_config(
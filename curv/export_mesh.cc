@@ -6,6 +6,7 @@
 #include <climits>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <chrono>
 #include <thread>
 #include <glm/geometric.hpp>
@@ -18,21 +19,22 @@
 #include <libcurv/exception.h>
 #include <libcurv/context.h>
 #include <libcurv/die.h>
+#include <libcurv/format.h>
+#include <libcurv/parametric.h>
 
 using namespace curv::io;
 
 void export_mesh(Mesh_Format, curv::Value value,
     curv::Program&,
     const Export_Params& params,
-    std::ostream& out);
+    Output_File& ofile);
 
 void export_stl(curv::Value value,
     curv::Program& prog,
     const Export_Params& params,
     Output_File& ofile)
 {
-    ofile.open();
-    export_mesh(Mesh_Format::stl, value, prog, params, ofile.ostream());
+    export_mesh(Mesh_Format::stl, value, prog, params, ofile);
 }
 
 void export_obj(curv::Value value,
@@ -40,8 +42,7 @@ void export_obj(curv::Value value,
     const Export_Params& params,
     Output_File& ofile)
 {
-    ofile.open();
-    export_mesh(Mesh_Format::obj, value, prog, params, ofile.ostream());
+    export_mesh(Mesh_Format::obj, value, prog, params, ofile);
 }
 
 void export_x3d(curv::Value value,
@@ -49,8 +50,7 @@ void export_x3d(curv::Value value,
     const Export_Params& params,
     Output_File& ofile)
 {
-    ofile.open();
-    export_mesh(Mesh_Format::x3d, value, prog, params, ofile.ostream());
+    export_mesh(Mesh_Format::x3d, value, prog, params, ofile);
 }
 
 void export_gltf(curv::Value value,
@@ -58,8 +58,23 @@ void export_gltf(curv::Value value,
     const Export_Params& params,
     Output_File& ofile)
 {
-    ofile.open();
-    export_mesh(Mesh_Format::gltf, value, prog, params, ofile.ostream());
+    export_mesh(Mesh_Format::gltf, value, prog, params, ofile);
+}
+
+void export_glb(curv::Value value,
+    curv::Program& prog,
+    const Export_Params& params,
+    Output_File& ofile)
+{
+    export_mesh(Mesh_Format::glb, value, prog, params, ofile);
+}
+
+void export_ply(curv::Value value,
+    curv::Program& prog,
+    const Export_Params& params,
+    Output_File& ofile)
+{
+    export_mesh(Mesh_Format::ply, value, prog, params, ofile);
 }
 
 void describe_mesh_opts(std::ostream& out)
@@ -70,7 +85,29 @@ void describe_mesh_opts(std::ostream& out)
     "-O vsize=<voxel size>\n"
     "-O vcount=<approximate voxel count>\n"
     "-O eps=<small number> : epsilon to compute normal by partial differences\n"
+    "    (not used with -O jit, which computes exact normals)\n"
     "-O adaptive=<0...1> : Deprecated. Use meshlab to simplify mesh.\n"
+    "-O narrowband : Only evaluate voxels near the surface (#smooth, #tmc).\n"
+    "-O chunk=<n> : Mesh in slabs of n voxels, to bound memory use (#tmc).\n"
+    "-O bench : Print stage timings, mesh size and peak memory as JSON.\n"
+    "-O parallel : Use all CPU cores without -O jit (#smooth, #tmc).\n"
+    "-O params=[{...},...] : Export one mesh per argument record of a\n"
+    "    parametric shape. The '-o' pathname must contain a '*'.\n"
+    ;
+}
+void describe_stl_opts(std::ostream& out)
+{
+    describe_mesh_opts(out);
+    out <<
+    "-O binary : Write a binary STL file (smaller and faster than ASCII).\n"
+    ;
+}
+void describe_gltf_opts(std::ostream& out)
+{
+    describe_mesh_opts(out);
+    out <<
+    "-O normals : Include per-vertex normals.\n"
+    "-O colours : Include per-vertex colours.\n"
     ;
 }
 void describe_colour_mesh_opts(std::ostream& out)
@@ -81,10 +118,101 @@ void describe_colour_mesh_opts(std::ostream& out)
     ;
 }
 
+// Export a single mesh. If cshape_p is not null, then *cshape_p is the
+// compiled shape, which is compiled on the first call if -O jit is used,
+// and reused by later calls.
+void export_mesh_variant(Mesh_Format format,
+    const curv::Shape_Program& shape,
+    std::unique_ptr<curv::io::Compiled_Shape>* cshape_p,
+    curv::Program& prog,
+    Mesh_Export& opts,
+    bool bench,
+    bool parallel,
+    Output_File& ofile)
+{
+    curv::At_Program cx(prog);
+    Mesh_Bench bstats;
+    std::unique_ptr<curv::io::Compiled_Shape> local_cshape = nullptr;
+    if (cshape_p == nullptr)
+        cshape_p = &local_cshape;
+    auto& cshape = *cshape_p;
+    if (opts.jit_ && cshape == nullptr) {
+        auto cstart_time = std::chrono::steady_clock::now();
+        // The libfive meshers use interval arithmetic to prune the octree,
+        // and exact gradients to find the normals of sharp features.
+        // Vertex normals are also computed from exact gradients.
+        bool interval = opts.mgen_ == Mesh_Gen::sharp
+            || opts.mgen_ == Mesh_Gen::iso
+            || opts.mgen_ == Mesh_Gen::hybrid;
+        bool gradient = interval || opts.normals_;
+        cshape = std::make_unique<curv::io::Compiled_Shape>(
+            shape, interval, gradient);
+        auto cend_time = std::chrono::steady_clock::now();
+        std::chrono::duration<double> compile_time = cend_time - cstart_time;
+        bstats.compile_time = compile_time.count();
+        std::cerr
+            << "Compiled shape in " << compile_time.count() << "s\n";
+        std::cerr.flush();
+    } else if (!opts.jit_ && !parallel) {
+        std::cerr <<
+            "You are in SLOW MODE. Use '-O jit' to speed up rendering,\n"
+            "or '-O parallel' to use all CPU cores.\n";
+    }
+    const curv::Shape* pshape;
+    if (cshape) pshape = &*cshape; else pshape = &shape;
+    ofile.open();
+    std::ostream& out = ofile.ostream();
+    bool multithreaded = (cshape != nullptr);
+
+    // The interpreted shape can be evaluated by multiple threads once
+    // refcounts are atomic. Not used with libfive, whose worker threads
+    // can't report a Curv exception.
+    std::unique_ptr<curv::Atomic_Refcounts> atomic = nullptr;
+#if !LEAN_BUILD
+    if (opts.mgen_ != Mesh_Gen::smooth && opts.mgen_ != Mesh_Gen::tmc)
+        parallel = false;
+#endif
+    if (parallel && !multithreaded) {
+        atomic = std::make_unique<curv::Atomic_Refcounts>();
+        multithreaded = true;
+    }
+
+#if LEAN_BUILD
+    const char* mgen = "tmc";
+    tmc_mesher(*pshape, multithreaded, opts, bstats, cx, format, out);
+#else
+    const char* mgen;
+    switch (opts.mgen_) {
+    case Mesh_Gen::smooth:
+        mgen = "smooth";
+        vdb_mesher(*pshape, multithreaded, opts, bstats, cx, format, out);
+        break;
+    case Mesh_Gen::sharp:
+    case Mesh_Gen::iso:
+    case Mesh_Gen::hybrid:
+        mgen = opts.mgen_ == Mesh_Gen::sharp ? "sharp"
+             : opts.mgen_ == Mesh_Gen::iso ? "iso" : "hybrid";
+        libfive_mesher(*pshape, multithreaded, opts, bstats, cx, format, out);
+        break;
+    case Mesh_Gen::tmc:
+        mgen = "tmc";
+        tmc_mesher(*pshape, multithreaded, opts, bstats, cx, format, out);
+        break;
+    default:
+        throw curv::Exception(cx, "mesh export: unknown mesh generator");
+    }
+#endif
+    if (bench) {
+        // Use stdout, unless the mesh is being written there.
+        bstats.write_json(ofile.ostream_ == &std::cout ? std::cerr : std::cout,
+            mgen, opts.jit_);
+    }
+}
+
 void export_mesh(Mesh_Format format, curv::Value value,
     curv::Program& prog,
     const Export_Params& params,
-    std::ostream& out)
+    Output_File& ofile)
 {
     curv::Shape_Program shape(prog);
     curv::At_Program cx(prog);
@@ -92,6 +220,9 @@ void export_mesh(Mesh_Format format, curv::Value value,
         throw curv::Exception(cx, "mesh export: not a 3D shape");
 
     Mesh_Export opts;
+    bool bench = false;
+    bool parallel = false;
+    curv::Shared<const curv::List> variants = nullptr;
     for (auto& i : params.map_) {
         Param p{params, i};
         if (p.name_ == "mgen") {
@@ -117,7 +248,10 @@ void export_mesh(Mesh_Format format, curv::Value value,
                 throw curv::Exception(p, "'vsize' must be positive");
             }
         } else if (p.name_ == "vcount") {
-            opts.vcount_ = p.to_int(1, INT_MAX);
+            opts.vcount_ = p.to_double();
+            if (opts.vcount_ < 1.0) {
+                throw curv::Exception(p, "'vcount' must be at least 1");
+            }
         } else if (p.name_ == "eps") {
             opts.eps_ = p.to_double();
         } else if (p.name_ == "adaptive") {
@@ -125,6 +259,27 @@ void export_mesh(Mesh_Format format, curv::Value value,
             if (opts.adaptive_ < 0.0 || opts.adaptive_ > 1.0) {
                 throw curv::Exception(p, "'adaptive' must be in range 0...1");
             }
+        } else if (p.name_ == "narrowband") {
+            opts.narrowband_ = p.to_bool();
+        } else if (p.name_ == "bench") {
+            bench = p.to_bool();
+        } else if (p.name_ == "parallel") {
+            parallel = p.to_bool();
+        } else if (p.name_ == "params") {
+            variants = p.eval().to<curv::List>(p);
+            if (variants->empty())
+                throw curv::Exception(p, "'params' must not be empty");
+        } else if (p.name_ == "chunk") {
+            opts.chunk_ = p.to_int(2, INT_MAX);
+        } else if (format == Mesh_Format::stl && p.name_ == "binary") {
+            if (p.to_bool())
+                format = Mesh_Format::stl_binary;
+        } else if ((format == Mesh_Format::gltf || format == Mesh_Format::glb)
+                   && p.name_ == "normals") {
+            opts.normals_ = p.to_bool();
+        } else if ((format == Mesh_Format::gltf || format == Mesh_Format::glb)
+                   && p.name_ == "colours") {
+            opts.colours_ = p.to_bool();
         } else if (format == Mesh_Format::x3d && p.name_ == "colouring") {
             auto val = p.to_symbol();
             if (val == "face")
@@ -138,40 +293,53 @@ void export_mesh(Mesh_Format format, curv::Value value,
             p.unknown_parameter();
     }
 
-    std::unique_ptr<curv::io::Compiled_Shape> cshape = nullptr;
-    if (opts.jit_) {
-        auto cstart_time = std::chrono::steady_clock::now();
-        cshape = std::make_unique<curv::io::Compiled_Shape>(shape);
-        auto cend_time = std::chrono::steady_clock::now();
-        std::chrono::duration<double> compile_time = cend_time - cstart_time;
-        std::cerr
-            << "Compiled shape in " << compile_time.count() << "s\n";
-        std::cerr.flush();
-    } else {
-        std::cerr <<
-            "You are in SLOW MODE. Use '-O jit' to speed up rendering.\n";
+    if (variants == nullptr) {
+        export_mesh_variant(format, shape, nullptr, prog, opts, bench,
+            parallel, ofile);
+        return;
     }
-    const curv::Shape* pshape;
-    if (cshape) pshape = &*cshape; else pshape = &shape;
-    bool multithreaded = (cshape != nullptr);
 
-#if LEAN_BUILD
-    tmc_mesher(*pshape, multithreaded, opts, cx, format, out);
-#else
-    switch (opts.mgen_) {
-    case Mesh_Gen::smooth:
-        vdb_mesher(*pshape, multithreaded, opts, cx, format, out);
-        break;
-    case Mesh_Gen::sharp:
-    case Mesh_Gen::iso:
-    case Mesh_Gen::hybrid:
-        libfive_mesher(*pshape, multithreaded, opts, cx, format, out);
-        break;
-    case Mesh_Gen::tmc:
-        tmc_mesher(*pshape, multithreaded, opts, cx, format, out);
-        break;
-    default:
-        throw curv::Exception(cx, "mesh export: unknown mesh generator");
+    // Export each instance of a parametric shape to a separate file.
+    // With -O jit, the shape is compiled once, and the parameters that have
+    // pickers are passed to the compiled code at run time.
+    static curv::Symbol_Ref call_key = curv::make_symbol("call");
+    auto ctor = shape.record_->hasfield(call_key)
+        ? shape.record_->getfield(call_key, cx)
+            .maybe<const curv::Parametric_Ctor>()
+        : nullptr;
+    if (ctor == nullptr)
+        throw curv::Exception(cx, "'-O params=' requires a parametric shape");
+    auto opath = ofile.path_.string();
+    const char* star = strchr(opath.c_str(), '*');
+    if (star == nullptr) {
+        throw curv::Exception(cx,
+          "'-O params=' requires pathname in '-o pathname' to contain a '*'");
+    }
+    curv::Range<const char*> prefix(opath.c_str(), star);
+    curv::Range<const char*> suffix(star+1, strlen(star+1));
+    unsigned digs = curv::ndigits(variants->size());
+    std::unique_ptr<curv::io::Compiled_Shape> cshape = nullptr;
+    for (unsigned i = 0; i < variants->size(); ++i) {
+        std::unique_ptr<curv::Frame> f = curv::Frame::make(
+            ctor->nslots_, prog.sstate_, nullptr, nullptr, shape.nub_);
+        curv::Value val = ctor->call(variants->at(i), curv::Fail::hard, *f);
+        curv::Shape_Program variant(prog);
+        if (!variant.recognize(val, nullptr) || !variant.is_3d_)
+            throw curv::Exception(cx, curv::stringify(
+                "mesh export: params[",i,"]: not a 3D shape"));
+        // A parameter without a picker is compiled into the code,
+        // so changing it requires a new compilation.
+        if (opts.jit_ && cshape && !cshape->set_parameters(variant))
+            cshape = nullptr;
+
+        char num[12];
+        snprintf(num, sizeof(num), "%0*d", digs, i);
+        auto path = curv::stringify(prefix, num, suffix);
+        Output_File vfile{shape.system()};
+        vfile.set_path(path->c_str());
+        export_mesh_variant(format, variant, &cshape, prog, opts, bench,
+            parallel, vfile);
+        vfile.commit();
     }
-#endif
 }
+
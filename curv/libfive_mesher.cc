@@ -34,35 +34,47 @@ struct CurvOracle : public libfive::OracleStorage<LIBFIVE_EVAL_ARRAY_SIZE>
 
     void evalInterval(libfive::Interval& out) override
     {
-        // Since Curv currently doesn't do interval arithmetic,
-        // return a large interval. Which magic number do I choose?
+        // A compiled shape bounds the distance field over the region using
+        // interval arithmetic, which lets libfive skip cells that are
+        // entirely inside or outside of the shape. Otherwise, the result
+        // is [-inf,inf], and libfive subdivides every cell.
         //
         // mkeeter: If the top-level tree is just this CurvOracle, then
         // returning [-inf, inf] should be fine; however, if you're
         // transforming it further, then I agree that the math could get iffy.
-        // You could also return [NaN, NaN], which should cause interval
-        // subdivision to always subdivide (down to individual voxels).
-
-        // This gives rounded edges for a large cube (`cube 9999999`).
-        //out = {-10000.0, 10000.0};
-
-        // This gives the same results (rounded edges) for a large cube.
-        // I'm using infinity because it is "the least magic" alternative
-        // and is not overly scale dependent like 10000 is.
-        out = { -std::numeric_limits<double>::infinity(),
-                 std::numeric_limits<double>::infinity() };
-
-      #if 0
-        // This gives the same results (rounded edges) for a large cube.
-        out = { std::numeric_limits<double>::quiet_NaN(),
-                std::numeric_limits<double>::quiet_NaN() };
-      #endif
+        double lo[3] = {lower.x(), lower.y(), lower.z()};
+        double hi[3] = {upper.x(), upper.y(), upper.z()};
+        double d[2];
+        shape_.dist_interval(lo, hi, 0.0, d);
+        out = {d[0], d[1]};
     }
     void evalPoint(float& out, size_t index=0) override
     {
         const auto pt = points.col(index);
         out = shape_.dist(pt.x(), pt.y(), pt.z(), 0.0);
     }
+    void evalArray(
+        Eigen::Block<Eigen::Array<float, Eigen::Dynamic,
+                                  LIBFIVE_EVAL_ARRAY_SIZE,
+                                  Eigen::RowMajor>,
+                     1, Eigen::Dynamic> out) override
+    {
+        // Convert the column-major point matrix to structure-of-arrays,
+        // then evaluate all of the points in one call to dist_batch.
+        float xs[LIBFIVE_EVAL_ARRAY_SIZE];
+        float ys[LIBFIVE_EVAL_ARRAY_SIZE];
+        float zs[LIBFIVE_EVAL_ARRAY_SIZE];
+        float ds[LIBFIVE_EVAL_ARRAY_SIZE];
+        size_t n = out.cols();
+        for (size_t i = 0; i < n; ++i) {
+            xs[i] = points(0, i);
+            ys[i] = points(1, i);
+            zs[i] = points(2, i);
+        }
+        shape_.dist_batch(xs, ys, zs, 0.0f, ds, n);
+        for (size_t i = 0; i < n; ++i)
+            out(i) = ds[i];
+    }
     void checkAmbiguous(Eigen::Block<
         Eigen::Array<bool, 1, LIBFIVE_EVAL_ARRAY_SIZE>,
         1, Eigen::Dynamic>) override
@@ -72,7 +84,18 @@ struct CurvOracle : public libfive::OracleStorage<LIBFIVE_EVAL_ARRAY_SIZE>
     }
     void evalFeatures(boost::container::small_vector<libfive::Feature, 4>& out)
     override {
-        // Find one derivative with partial differences.
+        // Find one derivative. A compiled shape computes the exact gradient
+        // using dual numbers, in one call. Otherwise, or if the gradient is
+        // zero or not finite, use partial differences.
+        float x = points(0, 0), y = points(1, 0), z = points(2, 0);
+        float g[4];
+        if (shape_.dist_grad_batch(&x, &y, &z, 0.0f, g, 1)) {
+            Eigen::Vector3f grad(g[1], g[2], g[3]);
+            if (grad.allFinite() && grad.squaredNorm() > 0) {
+                out.push_back(grad.normalized());
+                return;
+            }
+        }
 
         float centre, dx, dy, dz;
         Eigen::Vector3f before = points.col(0);
@@ -141,6 +164,7 @@ void libfive_mesher(
     const curv::Shape &shape,
     bool multithreaded,
     Mesh_Export &opts,
+    Mesh_Bench &bench,
     curv::At_Program &cx,
     Mesh_Format format,
     std::ostream& out)
@@ -179,9 +203,11 @@ void libfive_mesher(
     Libfive_Mesh mesh(libfive::Mesh::render(tree, region, settings));
     auto end_time = std::chrono::steady_clock::now();
     std::chrono::duration<double> render_time = end_time - start_time;
+    bench.vsize = vox.cellsize;
+    bench.mesh_time = render_time.count();
     std::cerr
         << "Rendered " << mesh.mesh_->branes.size()
         << " triangles in " << render_time.count() << "s\n";
 
-    (void) write_mesh(format, mesh, shape, opts, out);
+    bench.write_mesh(format, mesh, shape, multithreaded, opts, out);
 }
@@ -32,6 +32,8 @@ extern "C" {
 #include "view_server.h"
 #include <libcurv/context.h>
 #include <libcurv/exception.h>
+#include <libcurv/import.h>
+#include <libcurv/io/file_watcher.h>
 #include <libcurv/program.h>
 #include <libcurv/source.h>
 #include <libcurv/system.h>
@@ -166,12 +168,10 @@ poll_file(
     editor_handle_t *editor_handle, const char* filename)
 {
     for (;;) {
-        struct stat st;
-        if (stat(filename, &st) != 0) {
-            // file doesn't exist.
-            memset((void*)&st, 0, sizeof(st));
-        } else {
-            // evaluate file.
+        curv::io::Watch_List wl(filename);
+        if (wl.main_exists_) {
+            // evaluate file, recording the files that it imports.
+            curv::Active_Import_Guard imports(sys->import_cache_);
             try {
                 curv::Program prog{*sys};
                 auto file = curv::make<curv::File_Source>(
@@ -188,21 +188,33 @@ poll_file(
             } catch (std::exception& e) {
                 sys->error(e);
             }
+            wl.deps_ = imports.get().deps_;
         }
-        // Wait for file to change or editor to quit.
+        // Wait for a file to change or editor to quit.
+#ifdef __linux__
+        curv::io::File_Watcher watcher(wl);
+#endif
+        // A file saved during evaluation, before the watcher was created,
+        // is detected by comparing stamps.
+        bool changed = wl.changed();
         for (;;) {
-            usleep(500'000);
             if (editor_handle && !poll_editor(*editor_handle)) {
                 // We actually started an editor, but it got now closed as signalled by poll_editor
                 // => also exit Curv's livemode
                 live_view_server.exit();
                 return;
             }
-            struct stat st2;
-            if (stat(filename, &st2) != 0)
-                memset((void*)&st2, 0, sizeof(st));
-            if (st.st_mtime != st2.st_mtime)
+            if (changed)
                 break;
+#ifdef __linux__
+            if (watcher.ok())
+                changed = watcher.wait(200);
+            else
+#endif
+            {
+                usleep(500'000);
+                changed = wl.changed();
+            }
         }
     }
 }
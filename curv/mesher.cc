@@ -3,9 +3,85 @@
 // See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
 
 #include "mesher.h"
+#include <glm/common.hpp>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 
 using namespace curv::io;
 
+// Round i down to origin plus a multiple of n.
+static int align_down(int i, int origin, int n)
+{
+    return origin + int(floor(double(i - origin) / n)) * n;
+}
+
+Narrow_Band::Narrow_Band(
+    const curv::Shape& shape, const Voxel_Config& vox, glm::ivec3 origin,
+    double margin)
+:
+    shape_(shape),
+    vox_(vox),
+    margin_(margin * vox.cellsize)
+{
+    for (int x = align_down(vox.range_min.x, origin.x, coarse_size);
+         x <= vox.range_max.x; x += coarse_size)
+    {
+        for (int y = align_down(vox.range_min.y, origin.y, coarse_size);
+             y <= vox.range_max.y; y += coarse_size)
+        {
+            for (int z = align_down(vox.range_min.z, origin.z, coarse_size);
+                 z <= vox.range_max.z; z += coarse_size)
+            {
+                visit(glm::ivec3{x,y,z}, coarse_size);
+            }
+        }
+    }
+}
+
+void Narrow_Band::visit(glm::ivec3 origin, int size)
+{
+    // Clip the tile to the voxel grid.
+    Voxel_Box box{
+        glm::max(origin, vox_.range_min),
+        glm::min(origin + (size - 1), vox_.range_max)};
+    if (box.min.x > box.max.x || box.min.y > box.max.y
+        || box.min.z > box.max.z)
+    {
+        return;
+    }
+
+    // Measure the distance at the centre of the clipped tile.
+    glm::dvec3 lo = box.min, hi = box.max;
+    glm::dvec3 centre = 0.5 * (lo + hi) * vox_.cellsize;
+    double radius = 0.5 * glm::length(hi - lo) * vox_.cellsize;
+    double d = shape_.dist(centre.x, centre.y, centre.z, 0.0);
+    ++ntiles_;
+
+    if (std::abs(d) > radius + margin_) {
+        if (d < 0.0)
+            interior_.push_back(box);
+        return;
+    }
+    if (size <= leaf_size) {
+        bricks_.push_back(box);
+        return;
+    }
+    int h = size / 2;
+    for (int i = 0; i < 8; ++i) {
+        visit(origin + glm::ivec3{
+            (i & 1) ? h : 0, (i & 2) ? h : 0, (i & 4) ? h : 0}, h);
+    }
+}
+
+size_t Narrow_Band::nvoxels() const
+{
+    size_t n = 0;
+    for (auto& box : bricks_)
+        n += box.nvoxels();
+    return n;
+}
+
 void print_mesh_stats(Mesh_Stats& stats)
 {
     if (stats.ntri == 0 && stats.nquad == 0) {
@@ -21,3 +97,53 @@ void print_mesh_stats(Mesh_Stats& stats)
         std::cerr << ".\n";
     }
 }
+
+void Mesh_Bench::write_mesh(
+    Mesh_Format format, Mesh& mesh, const curv::Shape& shape,
+    bool multithreaded, const Mesh_Export& opts, std::ostream& out)
+{
+    auto start_time = std::chrono::steady_clock::now();
+    stats = curv::io::write_mesh(format, mesh, shape, multithreaded, opts, out);
+    out.flush();
+    auto end_time = std::chrono::steady_clock::now();
+    std::chrono::duration<double> time = end_time - start_time;
+    write_time = time.count();
+}
+
+// Peak resident set size of this process in kilobytes, or 0 if unknown.
+static long peak_rss_kb()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+  #ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+  #else
+    return usage.ru_maxrss;
+  #endif
+#endif
+}
+
+void Mesh_Bench::write_json(std::ostream& out, const char* mgen, bool jit) const
+{
+    out << "{\"mgen\":\"" << mgen << "\""
+        << ",\"jit\":" << (jit ? "true" : "false")
+        << ",\"vsize\":" << vsize
+        << ",\"voxels\":" << nvoxels
+        << ",\"compile_time\":" << compile_time
+        << ",\"voxel_time\":" << voxel_time
+        << ",\"voxels_per_second\":"
+            << (voxel_time > 0.0 ? size_t(nvoxels / voxel_time) : 0)
+        << ",\"mesh_time\":" << mesh_time
+        << ",\"write_time\":" << write_time
+        << ",\"total_time\":"
+            << compile_time + voxel_time + mesh_time + write_time
+        << ",\"triangles\":" << stats.ntri + 2*size_t(stats.nquad)
+        << ",\"quads\":" << stats.nquad
+        << ",\"peak_rss_kb\":" << peak_rss_kb()
+        << "}\n";
+    out.flush();
+}
@@ -7,6 +7,8 @@
 //#include <cstdlib>
 #include <chrono>
 #include <thread>
+#include <algorithm>
+#include <vector>
 #include <glm/geometric.hpp>
 
 //#include <libcurv/io/compiled_shape.h>
@@ -21,12 +23,12 @@ struct Voxel_Config
     double cellsize;
     glm::ivec3 range_min, range_max;
     glm::ivec3 gridsize;
-    int nvoxels;
+    size_t nvoxels;
 
     // Configure the voxel grid based on command line arguments.
     Voxel_Config(curv::BBox shape_bbox,
                  double vsize_opt,
-                 int vcount_opt,
+                 double vcount_opt,
                  const curv::Context& shape_cx)
     {
         glm::dvec3 shape_size = shape_bbox.max - shape_bbox.min;
@@ -55,7 +57,7 @@ struct Voxel_Config
             int(ceil(shape_bbox.max.z/cellsize)) + 2);
 
         gridsize = range_max - range_min + 1;
-        nvoxels = gridsize.x * gridsize.y * gridsize.z;
+        nvoxels = size_t(gridsize.x) * gridsize.y * gridsize.z;
 
         std::cerr
             << "vsize=" << cellsize << ": "
@@ -63,14 +65,155 @@ struct Voxel_Config
             << " voxels. Use '-O vsize=N' to change voxel size.\n";
         std::cerr.flush();
     }
+
+    // The slab of this voxel grid with X coordinates in [xmin,xmax].
+    Voxel_Config slab(int xmin, int xmax) const
+    {
+        Voxel_Config s = *this;
+        s.range_min.x = xmin;
+        s.range_max.x = xmax;
+        s.gridsize.x = xmax - xmin + 1;
+        s.nvoxels = size_t(s.gridsize.x) * gridsize.y * gridsize.z;
+        return s;
+    }
+};
+
+// A row of voxels parallel to the Z axis, spanning the voxel grid.
+// The whole row is evaluated by a single call to Shape::dist_batch,
+// which, for a JIT compiled shape, is a tight loop in the generated code.
+// Not thread safe: each thread needs its own Voxel_Scanline.
+struct Voxel_Scanline
+{
+    const Voxel_Config& vox_;
+    std::vector<float> xs_, ys_, zs_;
+
+    Voxel_Scanline(const Voxel_Config& vox)
+    :
+        vox_(vox),
+        xs_(vox.gridsize.z),
+        ys_(vox.gridsize.z),
+        zs_(vox.gridsize.z)
+    {
+        for (int i = 0; i < vox.gridsize.z; ++i)
+            zs_[i] = (vox.range_min.z + i) * vox.cellsize;
+    }
+
+    // Evaluate the distance field at voxels (x,y,z) for each z in
+    // z0 ... z0+n-1, which must lie within the voxel grid.
+    // Store n results in 'out'.
+    void eval(const curv::Shape& shape, int x, int y, int z0, int n,
+        float* out)
+    {
+        std::fill(xs_.begin(), xs_.begin() + n, float(x * vox_.cellsize));
+        std::fill(ys_.begin(), ys_.begin() + n, float(y * vox_.cellsize));
+        shape.dist_batch(xs_.data(), ys_.data(),
+            zs_.data() + (z0 - vox_.range_min.z), 0.0f, out, n);
+    }
+
+    // Evaluate the distance field at voxels (x,y,z) for each z in
+    // range_min.z ... range_max.z. Store gridsize.z results in 'out'.
+    void eval(const curv::Shape& shape, int x, int y, float* out)
+    {
+        eval(shape, x, y, vox_.range_min.z, vox_.gridsize.z, out);
+    }
+};
+
+// A box of voxels, with inclusive bounds, in voxel coordinates.
+struct Voxel_Box
+{
+    glm::ivec3 min, max;
+
+    glm::ivec3 size() const { return max - min + 1; }
+    size_t nvoxels() const
+    {
+        glm::ivec3 s = size();
+        return size_t(s.x) * size_t(s.y) * size_t(s.z);
+    }
+};
+
+// Find the voxels that lie in a narrow band around the surface of a shape,
+// so that a mesher can evaluate those voxels and skip the rest.
+//
+// The voxel grid is divided into coarse tiles, which are recursively
+// subdivided into octants down to leaf tiles of 8^3 voxels. Tiles are
+// aligned to multiples of their size, relative to 'origin' (in voxel
+// coordinates), so the caller can line them up with its own data structure.
+// Each tile is tested by evaluating the distance field once, at its centre.
+// Since a distance field is Lipschitz continuous (its value changes no faster
+// than the distance from the point where it was measured), if |dist| at the
+// centre exceeds the tile's radius plus a safety margin, then the surface
+// does not pass near the tile, and it is skipped. Leaf tiles that are not
+// skipped are "bricks", which must be evaluated voxel by voxel. For a shape
+// with a smooth surface, the number of bricks is proportional to surface
+// area rather than volume.
+//
+// This relies on the shape's `dist` function being a true distance field or
+// a distance bound. A shape whose `dist` overestimates the distance may be
+// missing parts of its surface.
+struct Narrow_Band
+{
+    static constexpr int leaf_size = 8;
+    static constexpr int coarse_size = 64;
+
+    const curv::Shape& shape_;
+    const Voxel_Config& vox_;
+    // The narrow band extends this far (in world units) from the surface.
+    // Every voxel whose distance from the surface is less than this
+    // lies within a brick.
+    double margin_;
+
+    // Leaf tiles that intersect the narrow band, clipped to the voxel grid.
+    std::vector<Voxel_Box> bricks_;
+    // Skipped tiles that lie entirely inside the shape, clipped to the grid.
+    // Skipped tiles that aren't listed here lie outside the shape.
+    std::vector<Voxel_Box> interior_;
+    // Number of distance evaluations made while classifying tiles.
+    size_t ntiles_ = 0;
+
+    // The margin is measured in voxels. Voxels within 2 units of the surface
+    // must have accurate values (see Voxel_Config), so that is the minimum.
+    Narrow_Band(const curv::Shape&, const Voxel_Config&, glm::ivec3 origin,
+        double margin = 2.0);
+
+    // Number of voxels in the bricks.
+    size_t nvoxels() const;
+
+private:
+    void visit(glm::ivec3 origin, int size);
+};
+
+// Timings and counts for each stage of mesh export. '-O bench' prints them
+// as a JSON object, so that performance can be tracked across releases.
+struct Mesh_Bench
+{
+    double compile_time = 0.0;  // JIT compiling the shape
+    double vsize = 0.0;
+    size_t nvoxels = 0;
+    double voxel_time = 0.0;    // evaluating the distance field
+    double mesh_time = 0.0;     // generating the mesh
+    double write_time = 0.0;    // computing colours and writing the file
+    curv::io::Mesh_Stats stats;
+
+    // Call curv::io::write_mesh, recording the time taken and the mesh size.
+    void write_mesh(
+        curv::io::Mesh_Format, curv::io::Mesh&, const curv::Shape&,
+        bool multithreaded, const curv::io::Mesh_Export&, std::ostream&);
+
+    // Write a JSON object containing the timings, the mesh size,
+    // and the peak resident set size of the process.
+    void write_json(std::ostream&, const char* mgen, bool jit) const;
 };
 
 struct Voxel_Timer
 {
     const Voxel_Config& vox_;
+    Mesh_Bench& bench_;
     std::chrono::time_point<std::chrono::steady_clock> start_time_, end_time_;
 
-    Voxel_Timer(const Voxel_Config& vox) : vox_(vox)
+    Voxel_Timer(const Voxel_Config& vox, Mesh_Bench& bench)
+    :
+        vox_(vox),
+        bench_(bench)
     {
         start_time_ = std::chrono::steady_clock::now();
     }
@@ -79,10 +222,13 @@ struct Voxel_Timer
     {
         end_time_ = std::chrono::steady_clock::now();
         std::chrono::duration<double> render_time = end_time_ - start_time_;
+        bench_.vsize = vox_.cellsize;
+        bench_.nvoxels = vox_.nvoxels;
+        bench_.voxel_time = render_time.count();
         std::cerr
             << "Rendered " << vox_.nvoxels
             << " voxels in " << render_time.count() << "s ("
-            << int(vox_.nvoxels/render_time.count()) << " voxels/s).\n";
+            << size_t(vox_.nvoxels/render_time.count()) << " voxels/s).\n";
         std::cerr.flush();
     }
 };
@@ -93,6 +239,7 @@ void libfive_mesher(
     const curv::Shape &shape,
     bool multithreaded,
     curv::io::Mesh_Export &opts,
+    Mesh_Bench &bench,
     curv::At_Program &cx,
     curv::io::Mesh_Format format,
     std::ostream& out);
@@ -101,6 +248,7 @@ void vdb_mesher(
     const curv::Shape &shape,
     bool multithreaded,
     curv::io::Mesh_Export &opts,
+    Mesh_Bench &bench,
     curv::At_Program &cx,
     curv::io::Mesh_Format format,
     std::ostream& out);
@@ -109,6 +257,7 @@ void tmc_mesher(
     const curv::Shape &shape,
     bool multithreaded,
     curv::io::Mesh_Export &opts,
+    Mesh_Bench &bench,
     curv::At_Program &cx,
     curv::io::Mesh_Format format,
     std::ostream& out);
@@ -5,6 +5,11 @@
 #include <extern/dmc/UniformGrid.h>
 #include <extern/dmc/DualMarchingCubes.h>
 #include <omp.h>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
 
 #include "mesher.h"
 
@@ -21,7 +26,8 @@ struct TMC_Mesh : public Mesh
         dmc::DualMarchingCubes dmc;
         dmc.dualMC(0.0, grid, v_, n_, tri_, quad_, simplify);
     };
-    virtual void each_triangle(std::function<void(const glm::ivec3& tri)> f)
+    // All faces are quads: tri_ holds the same faces, split into triangles.
+    virtual void each_triangle(std::function<void(const glm::ivec3& tri)>)
     {
     }
     virtual void each_quad(std::function<void(const glm::ivec4& quad)> f)
@@ -39,7 +45,7 @@ struct TMC_Mesh : public Mesh
     {
         int ntri = tri_.size() / 3;
         for (int i = 0; i < ntri; ++i) {
-            f(glm::ivec3{tri_[4*i+0], tri_[4*i+1], tri_[4*i+2]});
+            f(glm::ivec3{tri_[3*i+0], tri_[3*i+1], tri_[3*i+2]});
         }
     }
     virtual unsigned num_vertices()
@@ -53,78 +59,326 @@ struct TMC_Mesh : public Mesh
     }
 };
 
-void tmc_mesher(
+// A mesh assembled from the meshes of overlapping slabs of the voxel grid.
+// Adjacent slabs share a layer of cells. Both slabs compute bitwise identical
+// vertices for a shared cell (see dmc::UniformGrid::place), so vertices are
+// stitched by their exact position. A quad whose vertices were all created by
+// the previous slab lies within the shared layer, and is a duplicate.
+// Only the vertices of the previous slab are kept in the stitching table,
+// so memory use is proportional to the size of the output mesh.
+struct Chunked_Mesh : public Mesh
+{
+    using Key = std::array<std::uint64_t, 3>;
+    struct Key_Hash
+    {
+        size_t operator()(const Key& k) const
+        {
+            return std::hash<std::uint64_t>()(
+                k[0] ^ (k[1] * 0x9E3779B97F4A7C15ull) ^ (k[2] << 1));
+        }
+    };
+    std::vector<glm::vec3> v_;
+    std::vector<glm::ivec4> quad_;
+    std::unordered_map<Key, int, Key_Hash> prev_;
+
+    void add(const TMC_Mesh& slab)
+    {
+        std::unordered_map<Key, int, Key_Hash> next;
+        std::vector<int> index(slab.v_.size());
+        std::vector<bool> shared(slab.v_.size());
+        for (size_t i = 0; i < slab.v_.size(); ++i) {
+            auto& pt = slab.v_[i];
+            double xyz[3] = {pt[0], pt[1], pt[2]};
+            Key key;
+            std::memcpy(key.data(), xyz, sizeof(key));
+            auto found = prev_.find(key);
+            if (found != prev_.end()) {
+                index[i] = found->second;
+                shared[i] = true;
+            } else {
+                index[i] = int(v_.size());
+                shared[i] = false;
+                v_.push_back(glm::vec3{pt[0], pt[1], pt[2]});
+            }
+            next.emplace(key, index[i]);
+        }
+        size_t nquad = slab.quad_.size() / 4;
+        for (size_t q = 0; q < nquad; ++q) {
+            const int* quad = &slab.quad_[4*q];
+            if (shared[quad[0]] && shared[quad[1]]
+                && shared[quad[2]] && shared[quad[3]])
+            {
+                continue;
+            }
+            quad_.push_back(glm::ivec4{
+                index[quad[0]], index[quad[1]],
+                index[quad[2]], index[quad[3]]});
+        }
+        prev_.swap(next);
+    }
+    // Dual marching cubes only produces quads, so there are no triangles
+    // besides the ones that all_triangles() splits the quads into. Writers
+    // that call both each_triangle() and each_quad() (eg, OBJ) would output
+    // every face twice if the quads were also triangulated here.
+    virtual void each_triangle(std::function<void(const glm::ivec3& tri)>)
+    {
+    }
+    virtual void each_quad(std::function<void(const glm::ivec4& quad)> f)
+    {
+        for (auto& quad : quad_)
+            f(quad);
+    }
+    virtual void all_triangles(std::function<void(const glm::ivec3& tri)> f)
+    {
+        // Split each quad along its shorter diagonal.
+        for (auto& q : quad_) {
+            glm::vec3 d02 = v_[q[2]] - v_[q[0]];
+            glm::vec3 d13 = v_[q[3]] - v_[q[1]];
+            if (glm::dot(d02, d02) <= glm::dot(d13, d13)) {
+                f(glm::ivec3{q[0], q[1], q[2]});
+                f(glm::ivec3{q[0], q[2], q[3]});
+            } else {
+                f(glm::ivec3{q[1], q[2], q[3]});
+                f(glm::ivec3{q[1], q[3], q[0]});
+            }
+        }
+    }
+    virtual unsigned num_vertices()
+    {
+        return v_.size();
+    }
+    virtual glm::vec3 vertex(unsigned i)
+    {
+        return v_[i];
+    }
+};
+
+// Voxel grids larger than this are meshed in slabs, if '-O chunk' is not
+// specified. A DMC grid uses 32 bytes per voxel, and it numbers the grid
+// edges using an int, so a slab must have fewer than INT_MAX/3 voxels.
+constexpr size_t max_slab_voxels = size_t(1) << 27;
+
+struct Fill_Stats
+{
+    size_t nvoxels = 0;
+    size_t ntiles = 0;
+};
+
+// Populate a DMC grid with the voxels of 'vox', which is either the whole
+// voxel grid 'whole', or a slab of it.
+void fill_grid(
+    dmc::UniformGrid& grid,
     const curv::Shape &shape,
+    const Voxel_Config& vox,
+    const Voxel_Config& whole,
+    bool narrowband,
     bool multithreaded,
-    curv::io::Mesh_Export &opts,
-    curv::At_Program &cx,
-    curv::io::Mesh_Format format,
-    std::ostream& out)
+    Fill_Stats& stats)
 {
-    Voxel_Config vox(shape.bbox_, opts.vsize_, opts.vcount_, cx);
-    Voxel_Timer vtimer(vox);
-    dmc::UniformGrid grid;
-    const curv::BBox& b = shape.bbox_;
+    // The bounding box of the voxel grid (not of the shape, which lies
+    // a few voxels inside the grid), so that vertices are placed correctly.
+    glm::dvec3 bmin = glm::dvec3(vox.range_min) * vox.cellsize;
+    glm::dvec3 bmax = glm::dvec3(vox.range_max) * vox.cellsize;
     dmc::UniformGrid::BBox bb = {
-        dmc::Vector{ b.min.x, b.min.y, b.min.z },
-        dmc::Vector{ b.max.x, b.min.y, b.min.z },
-        dmc::Vector{ b.min.x, b.max.y, b.min.z },
-        dmc::Vector{ b.max.x, b.max.y, b.min.z },
-        dmc::Vector{ b.min.x, b.min.y, b.max.z },
-        dmc::Vector{ b.max.x, b.min.y, b.max.z },
-        dmc::Vector{ b.min.x, b.max.y, b.max.z },
-        dmc::Vector{ b.max.x, b.max.y, b.max.z },
+        dmc::Vector{ bmin.x, bmin.y, bmin.z },
+        dmc::Vector{ bmax.x, bmin.y, bmin.z },
+        dmc::Vector{ bmin.x, bmax.y, bmin.z },
+        dmc::Vector{ bmax.x, bmax.y, bmin.z },
+        dmc::Vector{ bmin.x, bmin.y, bmax.z },
+        dmc::Vector{ bmax.x, bmin.y, bmax.z },
+        dmc::Vector{ bmin.x, bmax.y, bmax.z },
+        dmc::Vector{ bmax.x, bmax.y, bmax.z },
     };
-    grid.init(vox.gridsize.x, vox.gridsize.y, vox.gridsize.z, bb);
-    if (multithreaded) {
+    if (narrowband) {
+        // Only allocate and evaluate the grid blocks near the surface.
+        // The tiles are aligned with the grid blocks. The margin is 3 voxels,
+        // because the gradient at a voxel is estimated from its neighbours.
+        constexpr int bbits = dmc::UniformGrid::block_bits;
+        Narrow_Band nb(shape, vox, vox.range_min, 3.0);
+        grid.init_sparse(vox.gridsize.x, vox.gridsize.y, vox.gridsize.z,
+            bb, nb.margin_);
+        for (auto& box : nb.interior_) {
+            glm::ivec3 lo = (box.min - vox.range_min) >> bbits;
+            glm::ivec3 hi = (box.max - vox.range_min) >> bbits;
+            for (int bi = lo.x; bi <= hi.x; ++bi)
+                for (int bj = lo.y; bj <= hi.y; ++bj)
+                    for (int bk = lo.z; bk <= hi.z; ++bk)
+                        grid.uniform_block(bi, bj, bk, -nb.margin_);
+        }
+        for (auto& box : nb.bricks_) {
+            glm::ivec3 blk = (box.min - vox.range_min) >> bbits;
+            grid.allocate_block(blk.x, blk.y, blk.z);
+        }
+        int nbricks = int(nb.bricks_.size());
+        curv::Thread_Exception ex;
+        #pragma omp parallel if (multithreaded)
+        {
+            Voxel_Scanline scan(vox);
+            float row[Narrow_Band::leaf_size];
+            #pragma omp for schedule(dynamic)
+            for (int b = 0; b < nbricks; ++b) ex.guard([&]{
+                const Voxel_Box& box = nb.bricks_[b];
+                int nz = box.size().z;
+                for (int x = box.min.x; x <= box.max.x; ++x) {
+                    for (int y = box.min.y; y <= box.max.y; ++y) {
+                        scan.eval(shape, x, y, box.min.z, nz, row);
+                        for (int i = 0; i < nz; ++i) {
+                            grid.scalar(
+                                x - vox.range_min.x,
+                                y - vox.range_min.y,
+                                box.min.z + i - vox.range_min.z,
+                                row[i]);
+                        }
+                    }
+                }
+            });
+        }
+        ex.rethrow();
+        stats.nvoxels += nb.nvoxels();
+        stats.ntiles += nb.ntiles_;
+    } else if (multithreaded) {
+        grid.init(vox.gridsize.x, vox.gridsize.y, vox.gridsize.z, bb);
+        curv::Thread_Exception ex;
         #pragma omp parallel for
-        for (int x = vox.range_min.x; x <= vox.range_max.x; ++x) {
+        for (int x = vox.range_min.x; x <= vox.range_max.x; ++x) ex.guard([&]{
+            Voxel_Scanline scan(vox);
+            std::vector<float> row(vox.gridsize.z);
             for (int y = vox.range_min.y; y <= vox.range_max.y; ++y) {
-                for (int z = vox.range_min.z; z <= vox.range_max.z; ++z) {
+                scan.eval(shape, x, y, row.data());
+                for (int z = 0; z < vox.gridsize.z; ++z) {
                     grid.scalar(
                         x - vox.range_min.x,
                         y - vox.range_min.y,
-                        z - vox.range_min.z,
-                        shape.dist(
-                            x*vox.cellsize,
-                            y*vox.cellsize,
-                            z*vox.cellsize,
-                            0.0));
+                        z,
+                        row[z]);
                 }
             }
-        }
+        });
+        ex.rethrow();
+        stats.nvoxels += vox.nvoxels;
     } else {
+        grid.init(vox.gridsize.x, vox.gridsize.y, vox.gridsize.z, bb);
+        Voxel_Scanline scan(vox);
+        std::vector<float> row(vox.gridsize.z);
         for (int x = vox.range_min.x; x <= vox.range_max.x; ++x) {
             for (int y = vox.range_min.y; y <= vox.range_max.y; ++y) {
-                for (int z = vox.range_min.z; z <= vox.range_max.z; ++z) {
+                scan.eval(shape, x, y, row.data());
+                for (int z = 0; z < vox.gridsize.z; ++z) {
                     grid.scalar(
                         x - vox.range_min.x,
                         y - vox.range_min.y,
-                        z - vox.range_min.z,
-                        shape.dist(
-                            x*vox.cellsize,
-                            y*vox.cellsize,
-                            z*vox.cellsize,
-                            0.0));
+                        z,
+                        row[z]);
                 }
             }
         }
+        stats.nvoxels += vox.nvoxels;
     }
+    // Use the exact cell size, and place the slab within the whole grid,
+    // so that adjacent slabs agree on the vertices of the cells they share.
+    grid.set_dx(vox.cellsize);
+    grid.set_dy(vox.cellsize);
+    grid.set_dz(vox.cellsize);
+    glm::dvec3 origin = glm::dvec3(whole.range_min) * whole.cellsize;
+    glm::ivec3 offset = vox.range_min - whole.range_min;
+    grid.place(dmc::Vector{ origin.x, origin.y, origin.z },
+        { offset.x, offset.y, offset.z });
     grid.estimateGradient();
     grid.flip_gradient();
-    vtimer.print_stats();
+}
+
+void tmc_mesher(
+    const curv::Shape &shape,
+    bool multithreaded,
+    curv::io::Mesh_Export &opts,
+    Mesh_Bench &bench,
+    curv::At_Program &cx,
+    curv::io::Mesh_Format format,
+    std::ostream& out)
+{
+    Voxel_Config vox(shape.bbox_, opts.vsize_, opts.vcount_, cx);
+    Voxel_Timer vtimer(vox, bench);
+    Fill_Stats fstats;
+
+    // Choose the slab thickness, in voxels. 0 means don't use slabs.
+    size_t layer = size_t(vox.gridsize.y) * vox.gridsize.z;
+    size_t slab = opts.chunk_;
+    if (slab == 0 && vox.nvoxels > max_slab_voxels)
+        slab = max_slab_voxels / layer;
+    if (slab >= size_t(vox.gridsize.x))
+        slab = 0;
+    if (slab > 0 && (slab < 3 || slab * layer >= size_t(INT_MAX / 3))) {
+        throw curv::Exception(cx, "mesh export: voxel grid is too large."
+            " Use '-O vsize=N' to increase voxel size");
+    }
 
-    TMC_Mesh mesh(true, grid);
-    auto tnow = std::chrono::steady_clock::now();
-    std::chrono::duration<double> gen_time = tnow - vtimer.end_time_;
-    unsigned nquads = mesh.quad_.size() / 4;
+    if (slab == 0) {
+        dmc::UniformGrid grid;
+        fill_grid(grid, shape, vox, vox, opts.narrowband_, multithreaded,
+            fstats);
+        vtimer.print_stats();
+        if (opts.narrowband_) {
+            std::cerr
+                << "Narrow band: evaluated " << fstats.nvoxels << " of "
+                << vox.nvoxels << " voxels ("
+                << fstats.ntiles << " tiles tested).\n";
+        }
+
+        TMC_Mesh mesh(true, grid);
+        auto tnow = std::chrono::steady_clock::now();
+        std::chrono::duration<double> gen_time = tnow - vtimer.end_time_;
+        bench.mesh_time = gen_time.count();
+        unsigned nquads = mesh.quad_.size() / 4;
+        std::cerr
+            << "Generated " << nquads
+            << " quads in " << gen_time.count() << "s ("
+            << int(nquads/gen_time.count()) << " quads/s).\n";
+        std::cerr.flush();
+
+        bench.write_mesh(format, mesh, shape, multithreaded, opts, out);
+        //print_mesh_stats(bench.stats);
+        return;
+    }
+
+    // Mesh one slab at a time, so that only one slab of the voxel grid is in
+    // memory. Adjacent slabs share two planes of voxels (one layer of cells).
+    // The mesh simplifier is disabled, because it would simplify the shared
+    // cells differently in each slab.
+    Chunked_Mesh mesh;
+    int nslabs = 0;
+    std::chrono::duration<double> gen_time{0};
+    for (int x0 = vox.range_min.x; ; x0 += int(slab) - 2) {
+        int x1 = std::min(x0 + int(slab) - 1, vox.range_max.x);
+        {
+            dmc::UniformGrid grid;
+            fill_grid(grid, shape, vox.slab(x0, x1), vox,
+                opts.narrowband_, multithreaded, fstats);
+            auto gen_start = std::chrono::steady_clock::now();
+            TMC_Mesh smesh(false, grid);
+            mesh.add(smesh);
+            gen_time += std::chrono::steady_clock::now() - gen_start;
+        }
+        ++nslabs;
+        if (x1 == vox.range_max.x) break;
+    }
+    mesh.prev_.clear();
+    // Exclude the mesh generation time from the voxel time.
+    vtimer.start_time_ +=
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            gen_time);
+    vtimer.print_stats();
+    bench.mesh_time = gen_time.count();
+    if (opts.narrowband_) {
+        std::cerr
+            << "Narrow band: evaluated " << fstats.nvoxels << " of "
+            << vox.nvoxels << " voxels ("
+            << fstats.ntiles << " tiles tested).\n";
+    }
     std::cerr
-        << "Generated " << nquads
-        << " quads in " << gen_time.count() << "s ("
-        << int(nquads/gen_time.count()) << " quads/s).\n";
+        << "Generated " << mesh.quad_.size() << " quads in "
+        << nslabs << " slabs of " << slab << " voxels in "
+        << gen_time.count() << "s.\n";
     std::cerr.flush();
 
-    auto stats = write_mesh(format, mesh, shape, opts, out);
-    (void) stats;
-    //print_mesh_stats(stats);
+    bench.write_mesh(format, mesh, shape, multithreaded, opts, out);
 }
@@ -68,10 +68,96 @@ struct VDB_Mesh : public Mesh
     }
 };
 
+using Grid_Accessor = openvdb::FloatGrid::Accessor;
+
+// VDB leaf nodes are 8*8*8 voxels.
+constexpr int leaf_size = 8;
+
+// Round a voxel coordinate down to a multiple of n.
+inline int align_down(int i, int n)
+{
+    return int(floor(double(i) / n)) * n;
+}
+
+// Populate a VDB grid in parallel, without a dense intermediate buffer.
+// The work is divided into 'nitems' work items. Each thread writes its
+// voxels into a private tree, using fill(accessor, scanline, item), and
+// then the private trees are merged into the grid. Each work item must
+// write to a distinct set of VDB leaf nodes: then merging just moves
+// nodes from one tree to another, and doesn't copy voxels.
+// If multithreaded is false, fill() writes directly to the grid.
+template <class Fill>
+void populate_grid(
+    openvdb::FloatGrid& grid, const Voxel_Config& vox,
+    bool multithreaded, int nitems, Fill fill)
+{
+    if (multithreaded) {
+        curv::Thread_Exception ex;
+        #pragma omp parallel
+        {
+            openvdb::FloatTree tree(grid.background());
+            {
+                Grid_Accessor accessor(tree);
+                Voxel_Scanline scan(vox);
+                #pragma omp for schedule(dynamic)
+                for (int i = 0; i < nitems; ++i)
+                    ex.guard([&]{ fill(accessor, scan, i); });
+            }
+            #pragma omp critical
+            grid.tree().merge(tree, openvdb::MERGE_ACTIVE_STATES);
+        }
+        ex.rethrow();
+    } else {
+        auto accessor = grid.getAccessor();
+        Voxel_Scanline scan(vox);
+        for (int i = 0; i < nitems; ++i)
+            fill(accessor, scan, i);
+    }
+}
+
+inline openvdb::CoordBBox vdb_box(const Voxel_Box& box)
+{
+    return openvdb::CoordBBox(
+        openvdb::Coord{box.min.x, box.min.y, box.min.z},
+        openvdb::Coord{box.max.x, box.max.y, box.max.z});
+}
+
+// Populate a VDB grid with a narrow band of voxels around the surface,
+// instead of evaluating every voxel in the bounding box: see Narrow_Band,
+// which must be aligned to the origin, so that each brick lies within one
+// VDB leaf node. Tiles outside the shape are left with the background value;
+// tiles inside the shape are filled with inactive negative values, which the
+// mesher needs in order to know which side of the surface is inside.
+void fill_narrow_band(
+    openvdb::FloatGrid& grid, const curv::Shape& shape,
+    const Narrow_Band& nb, bool multithreaded)
+{
+    for (auto& box : nb.interior_)
+        grid.fill(vdb_box(box), -grid.background(), false);
+
+    populate_grid(grid, nb.vox_, multithreaded, int(nb.bricks_.size()),
+        [&](Grid_Accessor& accessor, Voxel_Scanline& scan, int b)->void
+        {
+            const auto& box = nb.bricks_[b];
+            int nz = box.size().z;
+            float row[leaf_size];
+            for (int x = box.min.x; x <= box.max.x; ++x) {
+                for (int y = box.min.y; y <= box.max.y; ++y) {
+                    scan.eval(shape, x, y, box.min.z, nz, row);
+                    for (int i = 0; i < nz; ++i) {
+                        accessor.setValue(
+                            openvdb::Coord{x, y, box.min.z + i}, row[i]);
+                    }
+                }
+            }
+        });
+}
+
 void vdb_mesher(
     const curv::Shape &shape,
     bool multithreaded,
     curv::io::Mesh_Export &opts,
+    Mesh_Bench &bench,
     curv::At_Program &cx,
     curv::io::Mesh_Format format,
     std::ostream& out)
@@ -80,7 +166,7 @@ void vdb_mesher(
     openvdb::initialize();
 
     // Create a FloatGrid and populate it with a signed distance field.
-    Voxel_Timer vtimer(vox);
+    Voxel_Timer vtimer(vox, bench);
 
     // 2.0 is the background (or default) distance value for this
     // sparse array of voxels. Each voxel is a `float`.
@@ -95,48 +181,45 @@ void vdb_mesher(
 
     // Populate the grid.
     // I assume each distance value is in the centre of a voxel.
-    auto accessor = grid->getAccessor();
-    if (multithreaded) {
-        auto voxels = std::make_unique<float[]>(vox.nvoxels);
-        #pragma omp parallel for
-        for (int x = vox.range_min.x; x <= vox.range_max.x; ++x) {
-            for (int y = vox.range_min.y; y <= vox.range_max.y; ++y) {
-                for (int z = vox.range_min.z; z <= vox.range_max.z; ++z) {
-                    int i = (x - vox.range_min.x) * vox.gridsize.y * vox.gridsize.z
-                        + (y - vox.range_min.y) * vox.gridsize.z
-                        + (z - vox.range_min.z);
-                    voxels[i] = shape.dist(x*vox.cellsize, y*vox.cellsize, z*vox.cellsize, 0.0);
-                }
-            }
-        }
-        for (int x = vox.range_min.x; x <= vox.range_max.x; ++x) {
-            for (int y = vox.range_min.y; y <= vox.range_max.y; ++y) {
-                for (int z = vox.range_min.z; z <= vox.range_max.z; ++z) {
-                    int i = (x - vox.range_min.x) * vox.gridsize.y * vox.gridsize.z
-                        + (y - vox.range_min.y) * vox.gridsize.z
-                        + (z - vox.range_min.z);
-                    accessor.setValue(openvdb::Coord{x,y,z}, voxels[i]);
-                }
-            }
-        }
+    if (opts.narrowband_) {
+        Narrow_Band nb(shape, vox, glm::ivec3(0));
+        fill_narrow_band(*grid, shape, nb, multithreaded);
+        std::cerr
+            << "Narrow band: evaluated " << nb.nvoxels() << " of "
+            << vox.nvoxels << " voxels (" << nb.ntiles_ << " tiles tested).\n";
     } else {
-        for (int x = vox.range_min.x; x <= vox.range_max.x; ++x) {
-            for (int y = vox.range_min.y; y <= vox.range_max.y; ++y) {
-                for (int z = vox.range_min.z; z <= vox.range_max.z; ++z) {
-                    accessor.setValue(openvdb::Coord{x,y,z},
-                        shape.dist(x*vox.cellsize, y*vox.cellsize, z*vox.cellsize, 0.0));
+        // Each work item is a slab of voxels, one VDB leaf node thick,
+        // perpendicular to the X axis.
+        int x0 = align_down(vox.range_min.x, leaf_size);
+        int nslabs = (vox.range_max.x - x0) / leaf_size + 1;
+        populate_grid(*grid, vox, multithreaded, nslabs,
+            [&](Grid_Accessor& accessor, Voxel_Scanline& scan, int s)->void
+            {
+                std::vector<float> row(vox.gridsize.z);
+                int xmin = std::max(x0 + s*leaf_size, vox.range_min.x);
+                int xmax = std::min(x0 + s*leaf_size + leaf_size - 1,
+                    vox.range_max.x);
+                for (int x = xmin; x <= xmax; ++x) {
+                    for (int y = vox.range_min.y; y <= vox.range_max.y; ++y) {
+                        scan.eval(shape, x, y, row.data());
+                        for (int z = vox.range_min.z; z <= vox.range_max.z; ++z)
+                        {
+                            accessor.setValue(openvdb::Coord{x,y,z},
+                                row[z - vox.range_min.z]);
+                        }
+                    }
                 }
-            }
-        }
+            });
     }
     vtimer.print_stats();
 
     VDB_Mesh mesh(opts.adaptive_, grid);
     auto tnow = std::chrono::steady_clock::now();
     std::chrono::duration<double> gen_time = tnow - vtimer.end_time_;
+    bench.mesh_time = gen_time.count();
     std::cerr << "Generated mesh in " << gen_time.count() << "s\n";
     std::cerr.flush();
 
-    auto stats = write_mesh(format, mesh, shape, opts, out);
-    print_mesh_stats(stats);
+    bench.write_mesh(format, mesh, shape, multithreaded, opts, out);
+    print_mesh_stats(bench.stats);
 }
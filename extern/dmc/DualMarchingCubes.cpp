@@ -13,40 +13,76 @@ void dmc::DualMarchingCubes::dualMC(const double i0, UGrid& ugrid,
 	const int kdim = ugrid.z_size();
 	std::map<int, std::array<int, 5>> m_;
     //std::cout << " ... compute iso-surface" << std::endl;
-#pragma omp parallel for
-    for (int k = 0; k < (kdim - 1); k++)
-	{
-		for (int j = 0; j < (jdim - 1); j++)
-		{
-			for (int i = 0; i < (idim - 1); i++)
-			{
-				double u[8];
-				u[0] = ugrid.scalar(i, j, k);
-				u[1] = ugrid.scalar(i + 1, j, k);
-				u[2] = ugrid.scalar(i, j + 1, k);
-				u[3] = ugrid.scalar(i + 1, j + 1, k);
-				u[4] = ugrid.scalar(i, j, k + 1);
-				u[5] = ugrid.scalar(i + 1, j, k + 1);
-				u[6] = ugrid.scalar(i, j + 1, k + 1);
-				u[7] = ugrid.scalar(i + 1, j + 1, k + 1);
+	auto visit = [&](const int i, const int j, const int k) {
+		double u[8];
+		u[0] = ugrid.scalar(i, j, k);
+		u[1] = ugrid.scalar(i + 1, j, k);
+		u[2] = ugrid.scalar(i, j + 1, k);
+		u[3] = ugrid.scalar(i + 1, j + 1, k);
+		u[4] = ugrid.scalar(i, j, k + 1);
+		u[5] = ugrid.scalar(i + 1, j, k + 1);
+		u[6] = ugrid.scalar(i, j + 1, k + 1);
+		u[7] = ugrid.scalar(i + 1, j + 1, k + 1);
 
-				//
-				uint i_case{ 0 };
-				i_case = i_case + ((uint)(u[0] >= i0));
-				i_case = i_case + ((uint)(u[1] >= i0)) * 2;
-				i_case = i_case + ((uint)(u[2] >= i0)) * 4;
-				i_case = i_case + ((uint)(u[3] >= i0)) * 8;
-				i_case = i_case + ((uint)(u[4] >= i0)) * 16;
-				i_case = i_case + ((uint)(u[5] >= i0)) * 32;
-				i_case = i_case + ((uint)(u[6] >= i0)) * 64;
-				i_case = i_case + ((uint)(u[7] >= i0)) * 128;
+		//
+		uint i_case{ 0 };
+		i_case = i_case + ((uint)(u[0] >= i0));
+		i_case = i_case + ((uint)(u[1] >= i0)) * 2;
+		i_case = i_case + ((uint)(u[2] >= i0)) * 4;
+		i_case = i_case + ((uint)(u[3] >= i0)) * 8;
+		i_case = i_case + ((uint)(u[4] >= i0)) * 16;
+		i_case = i_case + ((uint)(u[5] >= i0)) * 32;
+		i_case = i_case + ((uint)(u[6] >= i0)) * 64;
+		i_case = i_case + ((uint)(u[7] >= i0)) * 128;
 
-				if (i_case == 0 || i_case == 255)
-					continue;
-				else
-					slice(i0, i_case, i, j, k, u, ugrid, v, n, m_);
-			}
+		if (i_case != 0 && i_case != 255)
+			slice(i0, i_case, i, j, k, u, ugrid, v, n, m_);
+	};
+	if (ugrid.is_dense())
+	{
+#pragma omp parallel for
+		for (int k = 0; k < (kdim - 1); k++)
+			for (int j = 0; j < (jdim - 1); j++)
+				for (int i = 0; i < (idim - 1); i++)
+					visit(i, j, k);
+	}
+	else
+	{
+	// Visit the cells of a sparse grid block by block. The cells in a block
+	// have corners in that block and in its neighbours in the +x, +y and +z
+	// directions. If all of those blocks are uniform, with values on the
+	// same side of the iso-value, then none of the cells intersect the
+	// iso-surface.
+	using UBlock = std::array<int, 3>;
+	auto isEmpty = [&](const UBlock b) {
+		bool below{ false };
+		bool above{ false };
+		for (int n = 0; n < 8; n++) {
+			const int bi = b[0] + (n & 1);
+			const int bj = b[1] + ((n >> 1) & 1);
+			const int bk = b[2] + ((n >> 2) & 1);
+			if (bi >= ugrid.x_blocks() || bj >= ugrid.y_blocks() || bk >= ugrid.z_blocks())
+				continue;
+			if (!ugrid.is_uniform(bi, bj, bk))
+				return false;
+			if (ugrid.uniform_value(bi, bj, bk) >= i0) above = true;
+			else below = true;
 		}
+		return !(above && below);
+	};
+	const int bsize = UGrid::block_size;
+	const int nr_blocks = ugrid.x_blocks() * ugrid.y_blocks() * ugrid.z_blocks();
+#pragma omp parallel for schedule(dynamic)
+	for (int b = 0; b < nr_blocks; b++)
+	{
+		const UBlock blk{ b % ugrid.x_blocks(), (b / ugrid.x_blocks()) % ugrid.y_blocks(), b / (ugrid.x_blocks() * ugrid.y_blocks()) };
+		if (isEmpty(blk))
+			continue;
+		for (int k = blk[2] * bsize; k < std::min(kdim - 1, (blk[2] + 1) * bsize); k++)
+		for (int j = blk[1] * bsize; j < std::min(jdim - 1, (blk[1] + 1) * bsize); j++)
+		for (int i = blk[0] * bsize; i < std::min(idim - 1, (blk[0] + 1) * bsize); i++)
+			visit(i, j, k);
+	}
 	}
     //std::cout << " ... projections failed level 1: " << nrProj1 << std::endl;
     //std::cout << " ... projections failed level 2: " << nrProj2 << std::endl;
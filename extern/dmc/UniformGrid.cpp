@@ -26,18 +26,20 @@ void dmc::UniformGrid::init(const std::string& filename)
 	m_bbox[5] = Point{ xmax, 0, zmax };
 	m_bbox[6] = Point{ 0, ymax, zmax };
 	m_bbox[7] = Point{ xmax, ymax, zmax };
+	// the grid is not part of a larger grid
+	m_origin = m_bbox[0];
+	m_offset = { 0, 0, 0 };
 
 	size_t size_ = static_cast<size_t>(m_nx) * static_cast<size_t>(m_ny) * static_cast<size_t>(m_nz);
-	m_scalars.resize(size_);
+	init_dense(m_nx, m_ny, m_nz, 0);
 	//ushort* t_buff = new ushort[size_];
 	float* t_buff = new float[size_];
 	//ifile.read(reinterpret_cast<char*>(t_buff), size_ * sizeof(ushort));
 	ifile.read(reinterpret_cast<char*>(t_buff), size_ * sizeof(float));
 	ifile.close();
-	int pos = 0;
-	for (auto& v : m_scalars)
+	for (int pos = 0; pos < static_cast<int>(size_); pos++)
 	{
-		v = static_cast<double>(*(t_buff + pos++));
+		scalar(pos, static_cast<double>(*(t_buff + pos)));
 	}
 	delete[] t_buff;
 	// compute gradient for normals
@@ -55,16 +57,8 @@ void dmc::UniformGrid::init(const int nx, const int ny, const int nz)
 	m_dx = 1. / (static_cast<double>(m_nx) - 1.0);
 	m_dy = 1. / (static_cast<double>(m_ny) - 1.0);
 	m_dz = 1. / (static_cast<double>(m_nz) - 1.0);
-	// total number of grid points
-	size_t tot_size = m_nx * m_ny * m_nz;
 	// initialize scalar fields
-	m_scalars.resize(tot_size, 0);
-	m_gradient.resize(tot_size);
-	for (auto& p : m_gradient) {
-		p[0] = 0;
-		p[1] = 0;
-		p[2] = 0;
-	}
+	init_dense(nx, ny, nz, 0);
 	// create bounding box in [0,1]x[0,1]x[0,1]
 	// fastest index is x, then y and slowest index is z
 	for (int i = 0; i <= 1; i++) {
@@ -76,6 +70,9 @@ void dmc::UniformGrid::init(const int nx, const int ny, const int nz)
 			}
 		}
 	}
+	// the grid is not part of a larger grid
+	m_origin = m_bbox[0];
+	m_offset = { 0, 0, 0 };
 }
 
 void dmc::UniformGrid::init(const int nx, const int ny, const int nz, BBox & bb)
@@ -84,17 +81,8 @@ void dmc::UniformGrid::init(const int nx, const int ny, const int nz, BBox & bb)
 	m_nx = nx;
 	m_ny = ny;
 	m_nz = nz;
-	// total number of grid points
-	size_t tot_size = static_cast<size_t>(m_nx * m_ny * m_nz);
-	m_scalars.clear();
-	m_scalars.resize(tot_size, 0);
-	m_gradient.clear();
-	m_gradient.resize(tot_size);
-	for (auto& n : m_gradient) {
-		n[0] = 0;
-		n[1] = 0;
-		n[2] = 0;
-	}
+	// initialize scalar fields
+	init_dense(nx, ny, nz, 0);
 
 	// create bounding box
 	// fastest index is x, then y and slowest index is z
@@ -113,25 +101,25 @@ void dmc::UniformGrid::init(const int nx, const int ny, const int nz, BBox & bb)
 	m_dx = x_space / (static_cast<double>(m_nx) - 1.0);
 	m_dy = y_space / (static_cast<double>(m_ny) - 1.0);
 	m_dz = z_space / (static_cast<double>(m_nz) - 1.0);
+	// the grid is not part of a larger grid
+	m_origin = m_bbox[0];
+	m_offset = { 0, 0, 0 };
 }
 
 void dmc::UniformGrid::init(const int nx, const int ny, const int nz, BBox & bb, const double val)
+{
+	init(nx, ny, nz, bb);
+	setScalars(val);
+}
+
+void dmc::UniformGrid::init_sparse(const int nx, const int ny, const int nz, BBox& bb, const double val)
 {
 	// set grid size
 	m_nx = nx;
 	m_ny = ny;
 	m_nz = nz;
-	// total number of grid points
-	size_t tot_size = m_nx * m_ny * m_nz;
-	m_scalars.clear();
-	m_scalars.resize(tot_size, val);
-	m_gradient.clear();
-	m_gradient.resize(tot_size);
-	for (auto& n : m_gradient) {
-		n[0] = 0;
-		n[1] = 0;
-		n[2] = 0;
-	}
+	// initialize scalar fields, without allocating any blocks
+	init_blocks(nx, ny, nz, val);
 
 	// create bounding box
 	// fastest index is x, then y and slowest index is z
@@ -150,8 +138,56 @@ void dmc::UniformGrid::init(const int nx, const int ny, const int nz, BBox & bb,
 	m_dx = x_space / (static_cast<double>(m_nx) - 1.0);
 	m_dy = y_space / (static_cast<double>(m_ny) - 1.0);
 	m_dz = z_space / (static_cast<double>(m_nz) - 1.0);
+	// the grid is not part of a larger grid
+	m_origin = m_bbox[0];
+	m_offset = { 0, 0, 0 };
+}
+
+
+void dmc::UniformGrid::init_blocks(const int nx, const int ny, const int nz, const double val)
+{
+	m_nx = nx;
+	m_ny = ny;
+	m_nz = nz;
+	m_bx = (nx + block_size - 1) >> block_bits;
+	m_by = (ny + block_size - 1) >> block_bits;
+	m_bz = (nz + block_size - 1) >> block_bits;
+	const size_t nr_blocks = static_cast<size_t>(m_bx) * m_by * m_bz;
+	m_dense = false;
+	m_scalars.clear();
+	m_scalars.shrink_to_fit();
+	m_gradient.clear();
+	m_gradient.shrink_to_fit();
+	m_blocks.clear();
+	m_blocks.shrink_to_fit();
+	m_block_address.assign(nr_blocks, -1);
+	m_block_value.assign(nr_blocks, val);
 }
 
+void dmc::UniformGrid::init_dense(const int nx, const int ny, const int nz, const double val)
+{
+	m_nx = nx;
+	m_ny = ny;
+	m_nz = nz;
+	m_bx = m_by = m_bz = 0;
+	m_dense = true;
+	m_blocks.clear();
+	m_blocks.shrink_to_fit();
+	m_block_address.clear();
+	m_block_value.clear();
+	const size_t size_ = static_cast<size_t>(nx) * ny * nz;
+	m_scalars.assign(size_, val);
+	m_gradient.assign(size_, Normal{});
+}
+
+void dmc::UniformGrid::allocate_block(const int bi, const int bj, const int bk)
+{
+	const int b = block_index(bi, bj, bk);
+	if (m_block_address[b] >= 0) return;
+	m_block_address[b] = static_cast<int>(m_blocks.size());
+	m_blocks.emplace_back();
+	m_blocks.back().scalars.fill(m_block_value[b]);
+}
 
 void dmc::UniformGrid::estimateGradient()
 {
@@ -159,39 +195,74 @@ void dmc::UniformGrid::estimateGradient()
 	{
 		return (i < 0) ? 0 : (i >= max) ? max - i : i;
 	};
-	m_gradient.resize(m_scalars.size());
-	const int nr = static_cast<int>(m_scalars.size());
+	if (m_dense) {
+		const int nr = static_cast<int>(m_scalars.size());
 #pragma omp parallel for
-	for (int s = 0; s < nr; s++) {
-		Index idx = local_index(s);
-		const int i = idx[0];
-		const int i0 = index(i - 1, m_nx);
-		const int i1 = index(i + 1, m_nx);
-		const int j = idx[1];
-		const int j0 = index(j - 1, m_ny);
-		const int j1 = index(j + 1, m_ny);
-		const int k = idx[2];
-		const int k0 = index(k - 1, m_nz);
-		const int k1 = index(k + 1, m_nz);
-		const double nx = (scalar(i1, j, k) - scalar(i0, j, k)) / (2*m_dx);
-		const double ny = (scalar(i, j1, k) - scalar(i, j0, k)) / (2*m_dy);
-		const double nz = (scalar(i, j, k1) - scalar(i, j, k0)) / (2*m_dz);
-
-		m_gradient[s][0] = nx;
-		m_gradient[s][1] = ny;
-		m_gradient[s][2] = nz;
+		for (int s = 0; s < nr; s++) {
+			Index idx = local_index(s);
+			const int i = idx[0];
+			const int i0 = index(i - 1, m_nx);
+			const int i1 = index(i + 1, m_nx);
+			const int j = idx[1];
+			const int j0 = index(j - 1, m_ny);
+			const int j1 = index(j + 1, m_ny);
+			const int k = idx[2];
+			const int k0 = index(k - 1, m_nz);
+			const int k1 = index(k + 1, m_nz);
+			m_gradient[s][0] = (scalar(i1, j, k) - scalar(i0, j, k)) / (2*m_dx);
+			m_gradient[s][1] = (scalar(i, j1, k) - scalar(i, j0, k)) / (2*m_dy);
+			m_gradient[s][2] = (scalar(i, j, k1) - scalar(i, j, k0)) / (2*m_dz);
+		}
+		return;
+	}
+	// The gradient of a uniform block is zero, so only visit allocated blocks.
+	const int nr = static_cast<int>(m_block_address.size());
+#pragma omp parallel for schedule(dynamic)
+	for (int b = 0; b < nr; b++) {
+		if (m_block_address[b] < 0) continue;
+		Block& blk = m_blocks[m_block_address[b]];
+		const int bi = b % m_bx;
+		const int bj = (b / m_bx) % m_by;
+		const int bk = b / (m_bx * m_by);
+		for (int k = bk * block_size; k < std::min(m_nz, (bk + 1) * block_size); k++)
+		for (int j = bj * block_size; j < std::min(m_ny, (bj + 1) * block_size); j++)
+		for (int i = bi * block_size; i < std::min(m_nx, (bi + 1) * block_size); i++) {
+			const int i0 = index(i - 1, m_nx);
+			const int i1 = index(i + 1, m_nx);
+			const int j0 = index(j - 1, m_ny);
+			const int j1 = index(j + 1, m_ny);
+			const int k0 = index(k - 1, m_nz);
+			const int k1 = index(k + 1, m_nz);
+			Normal& g = blk.gradient[node_offset(i, j, k)];
+			g[0] = (scalar(i1, j, k) - scalar(i0, j, k)) / (2*m_dx);
+			g[1] = (scalar(i, j1, k) - scalar(i, j0, k)) / (2*m_dy);
+			g[2] = (scalar(i, j, k1) - scalar(i, j, k0)) / (2*m_dz);
+		}
 	}
 }
 
 void dmc::UniformGrid::flip_gradient()
 {
 	const double s = -1.;
-	const int nr = static_cast<int>(m_gradient.size());
+	if (m_dense) {
+		const int ng = static_cast<int>(m_gradient.size());
 #pragma omp parallel for
-	for (int i = 0; i < nr; i++)
+		for (int i = 0; i < ng; i++)
+		{
+			m_gradient[i][0] *= s;
+			m_gradient[i][1] *= s;
+			m_gradient[i][2] *= s;
+		}
+		return;
+	}
+	const int nr = static_cast<int>(m_blocks.size());
+#pragma omp parallel for
+	for (int b = 0; b < nr; b++)
 	{
-		m_gradient[i][0] *= s;
-		m_gradient[i][1] *= s;
-		m_gradient[i][2] *= s;
+		for (auto& g : m_blocks[b].gradient) {
+			g[0] *= s;
+			g[1] *= s;
+			g[2] *= s;
+		}
 	}
 }
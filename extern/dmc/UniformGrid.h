@@ -9,6 +9,7 @@
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 // project
 #include "Vector.h"
@@ -23,11 +24,52 @@ namespace dmc {
 		using Normal = dmc::Vector;
 		using Index = std::array<int, 3>;
 		using BBox = std::array<Point, 8>;
+		/// A dense grid (see init) stores its nodes in flat arrays, indexed by
+		/// global_index. A sparse grid (see init_sparse) stores its nodes in
+		/// cubic blocks of block_size^3 nodes. A block is either allocated, or
+		/// uniform: a uniform block has no storage, and all of its nodes have
+		/// the same scalar value and a zero gradient. Only the blocks near the
+		/// iso-surface are allocated, so that memory is proportional to the
+		/// surface area, rather than to the volume. The block indirection makes
+		/// each node access slower, so dense grids don't use it.
+		static constexpr int block_bits = 3;
+		static constexpr int block_size = 1 << block_bits;
+		static constexpr int block_nodes = block_size * block_size * block_size;
+		struct Block {
+			std::array<double, block_nodes> scalars;
+			std::array<Normal, block_nodes> gradient;
+		};
 	public:
 		void init(const std::string& filename);
 		void init(const int nx, const int ny, const int nz);
 		void init(const int nx, const int ny, const int nz, BBox& bb);
 		void init(const int nx, const int ny, const int nz, BBox& bb, const double val);
+		/// Initialize a sparse grid, in which every block is uniform, with scalar value val.
+		/// Use allocate_block() to allocate the blocks that intersect the iso-surface.
+		/// The block functions below are only used with sparse grids.
+		void init_sparse(const int nx, const int ny, const int nz, BBox& bb, const double val);
+		/// grid size in blocks
+		int x_blocks() const { return m_bx; }
+		int y_blocks() const { return m_by; }
+		int z_blocks() const { return m_bz; }
+		/// Allocate storage for block (bi,bj,bk), initializing its nodes to the block's
+		/// uniform value. Not thread safe: allocate blocks before setting scalars in parallel.
+		void allocate_block(const int bi, const int bj, const int bk);
+		/// Set the scalar value of a uniform block.
+		void uniform_block(const int bi, const int bj, const int bk, const double val) { m_block_value[block_index(bi, bj, bk)] = val; }
+		/// true if the nodes are stored in flat arrays, rather than in blocks
+		bool is_dense() const { return m_dense; }
+		/// true if block (bi,bj,bk) is uniform.
+		bool is_uniform(const int bi, const int bj, const int bk) const { return m_block_address[block_index(bi, bj, bk)] < 0; }
+		/// scalar value of uniform block (bi,bj,bk)
+		double uniform_value(const int bi, const int bj, const int bk) const { return m_block_value[block_index(bi, bj, bk)]; }
+		/// number of allocated blocks
+		size_t allocated_blocks() const { return m_blocks.size(); }
+		/// Place this grid within a larger grid with the same spacing: node (i,j,k) of this
+		/// grid is node (i,j,k)+offset of the larger grid, whose first node is at origin.
+		/// Vertex positions are computed in the larger grid, so that grids which share
+		/// a cell compute bitwise identical vertices for it.
+		void place(const Point& origin, const Index& offset) { m_origin = origin; m_offset = offset; }
 		/// copy
 		void copy(const UniformGrid& ug)
 		{
@@ -38,8 +80,17 @@ namespace dmc {
 			m_dy = ug.m_dy; //!< grid spacing in y-direction
 			m_dz = ug.m_dz; //!< grid spacing in z-direction
 			m_bbox = ug.m_bbox; //!< the bounding box of the ugrid.
-			m_scalars = ug.m_scalars; //!< scalar values stored in the ugrid
-			m_gradient = ug.m_gradient; //!< vector values stored in the ugrid
+			m_origin = ug.m_origin; //!< first node of the enclosing grid
+			m_offset = ug.m_offset; //!< index of this grid within the enclosing grid
+			m_bx = ug.m_bx; //!< grid size in blocks
+			m_by = ug.m_by;
+			m_bz = ug.m_bz;
+			m_dense = ug.m_dense; //!< nodes are stored in m_scalars and m_gradient
+			m_scalars = ug.m_scalars; //!< scalar values of a dense grid
+			m_gradient = ug.m_gradient; //!< gradients of a dense grid
+			m_block_address = ug.m_block_address; //!< index of block in m_blocks
+			m_block_value = ug.m_block_value; //!< scalar value of uniform blocks
+			m_blocks = ug.m_blocks; //!< allocated blocks
 		}
 		/// grid spacing in x-direction.
 		double dx() { return m_dx; }
@@ -137,22 +188,45 @@ namespace dmc {
 			return { m_bbox[0][0] + i[0] * m_dx, m_bbox[0][1] + i[1] * m_dy, m_bbox[0][2] + i[2] * m_dz };
 		}
 		/// Set all scalar to an input value
-		void setScalars(const double val) { std::fill(m_scalars.begin(), m_scalars.end(), val); }
+		void setScalars(const double val)
+		{
+			std::fill(m_scalars.begin(), m_scalars.end(), val);
+			std::fill(m_block_value.begin(), m_block_value.end(), val);
+			for (auto& b : m_blocks) b.scalars.fill(val);
+		}
 		/// Set the scalar value at grid node using node's global index.
-		void scalar(const int gindex, const double val) { m_scalars[gindex] = val; }
+		/// In a sparse grid, the node's block must be allocated.
+		void scalar(const int gindex, const double val)
+		{
+			if (m_dense) { m_scalars[gindex] = val; return; }
+			Index i = local_index(gindex);
+			scalar(i[0], i[1], i[2], val);
+		}
 		/// set the scalar value at grid node specified by indices (i,j,k).
-		void scalar(const int i, const int j, const int k, const double val) { m_scalars[global_index(i, j, k)] = val; }
+		void scalar(const int i, const int j, const int k, const double val)
+		{
+			if (m_dense) m_scalars[global_index(i, j, k)] = val;
+			else block(i, j, k).scalars[node_offset(i, j, k)] = val;
+		}
 		/// set the scalar value at grid node specified by Index i.
-		void scalar(const Index i, const double val) { m_scalars[global_index(i)] = val; }
+		void scalar(const Index i, const double val) { scalar(i[0], i[1], i[2], val); }
 		/// returns scalar value at grid node using global node index.
-		double scalar(const int gindex) { return m_scalars[gindex]; }
-		double scalar(const int gindex) const { return m_scalars[gindex]; }
+		double scalar(const int gindex) const
+		{
+			if (m_dense) return m_scalars[gindex];
+			Index i = local_index(gindex);
+			return scalar(i[0], i[1], i[2]);
+		}
 		/// returns scalar value at grid node specified by indices (i,k,j).
-		double scalar(const int i, const int j, const int k) { return m_scalars[global_index(i, j, k)]; }
-		double scalar(const int i, const int j, const int k) const { return m_scalars[global_index(i, j, k)]; }
+		double scalar(const int i, const int j, const int k) const
+		{
+			if (m_dense) return m_scalars[global_index(i, j, k)];
+			const int b = block_index(i >> block_bits, j >> block_bits, k >> block_bits);
+			const int a = m_block_address[b];
+			return (a < 0) ? m_block_value[b] : m_blocks[a].scalars[node_offset(i, j, k)];
+		}
 		/// returns scalar value at grid node specified by index i.
-		double scalar(const Index i) { return m_scalars[global_index(i)]; }
-		double scalar(const Index i) const { return m_scalars[global_index(i)]; }
+		double scalar(const Index i) const { return scalar(i[0], i[1], i[2]); }
 		/// compute scalar value at input point
 		double scalar(Point& p)
 		{
@@ -190,15 +264,26 @@ namespace dmc {
 		}
 
 		/// set gradient at given position in array
-		void gradient(const int i, const int j, const int k, const Normal& g) { m_gradient[global_index(i, j, k)] = g; }
+		void gradient(const int i, const int j, const int k, const Normal& g)
+		{
+			if (m_dense) m_gradient[global_index(i, j, k)] = g;
+			else block(i, j, k).gradient[node_offset(i, j, k)] = g;
+		}
 		/// returns the normal vector at grid's node using node's global index.
-		Vector gradient(const int gindex) { return m_gradient[gindex]; }
-		const Vector gradient(const int gindex) const { return m_gradient[gindex]; }
+		const Vector gradient(const int gindex) const
+		{
+			if (m_dense) return m_gradient[gindex];
+			Index i = local_index(gindex);
+			return gradient(i[0], i[1], i[2]);
+		}
 		/// returns the normal vector at grid's node specified using i, j and k indices.
-		Vector gradient(const int i, const int j, const int k) { return m_gradient[global_index(i, j, k)]; }
-		const Vector gradient(const int i, const int j, const int k) const { return m_gradient[global_index(i, j, k)]; }
-		Vector gradient(const Index i) { return m_gradient[global_index(i)]; }
-		const Vector gradient(const Index i) const { return m_gradient[global_index(i)]; }
+		const Vector gradient(const int i, const int j, const int k) const
+		{
+			if (m_dense) return m_gradient[global_index(i, j, k)];
+			const int a = m_block_address[block_index(i >> block_bits, j >> block_bits, k >> block_bits)];
+			return (a < 0) ? Vector{} : m_blocks[a].gradient[node_offset(i, j, k)];
+		}
+		const Vector gradient(const Index i) const { return gradient(i[0], i[1], i[2]); }
 		/// invert normals
 		void flip_gradient();
 		/// check if a point is strictly inside the ugrid.
@@ -243,14 +328,14 @@ namespace dmc {
 		}
 		void cellGradients(const int i0, const int j0, const int k0, Normal n[8])
 		{
-			n[0] = m_gradient[global_index(i0, j0, k0)];
-			n[1] = m_gradient[global_index(i0 + 1, j0, k0)];
-			n[2] = m_gradient[global_index(i0, j0 + 1, k0)];
-			n[3] = m_gradient[global_index(i0 + 1, j0 + 1, k0)];
-			n[4] = m_gradient[global_index(i0, j0, k0 + 1)];
-			n[5] = m_gradient[global_index(i0 + 1, j0, k0 + 1)];
-			n[6] = m_gradient[global_index(i0, j0 + 1, k0 + 1)];
-			n[7] = m_gradient[global_index(i0 + 1, j0 + 1, k0 + 1)];
+			n[0] = gradient(i0, j0, k0);
+			n[1] = gradient(i0 + 1, j0, k0);
+			n[2] = gradient(i0, j0 + 1, k0);
+			n[3] = gradient(i0 + 1, j0 + 1, k0);
+			n[4] = gradient(i0, j0, k0 + 1);
+			n[5] = gradient(i0 + 1, j0, k0 + 1);
+			n[6] = gradient(i0, j0 + 1, k0 + 1);
+			n[7] = gradient(i0 + 1, j0 + 1, k0 + 1);
 		}
 		/// compute global index.
 		int global_index(const Point p)
@@ -277,11 +362,19 @@ namespace dmc {
 		/// interplate normal
 		//bool interpolate_normal(const Point& p, Normal& n);
 		/// returns maximum scalar value in the grid
-		double max_scalar() { return *std::max_element(m_scalars.begin(), m_scalars.end()); }
-		double max_scalar() const { return *std::max_element(m_scalars.begin(), m_scalars.end()); }
+		double max_scalar() const
+		{
+			double m = -std::numeric_limits<double>::infinity();
+			for (int g = 0; g < size(); g++) m = std::max(m, scalar(g));
+			return m;
+		}
 		/// compute minimum value of scalar data stored on the grid
-		double min_scalar() { return *std::min_element(m_scalars.begin(), m_scalars.end()); }
-		double min_scalar() const { return *std::min_element(m_scalars.begin(), m_scalars.end()); }
+		double min_scalar() const
+		{
+			double m = std::numeric_limits<double>::infinity();
+			for (int g = 0; g < size(); g++) m = std::min(m, scalar(g));
+			return m;
+		}
 		void estimateGradient();
 		void normal(Normal& n, const int i, const int j, const int k, const double u, const double v, const double w)
 		{
@@ -299,18 +392,20 @@ namespace dmc {
 		}
 		void position(Point& p, const int i, const int j, const int k, const double u, const double v, const double w)
 		{
-			p[0] = m_bbox[0][0] + (i + u) * m_dx;
-			p[1] = m_bbox[0][1] + (j + v) * m_dy;
-			p[2] = m_bbox[0][2] + (k + w) * m_dz;
+			p[0] = m_origin[0] + ((m_offset[0] + i) + u) * m_dx;
+			p[1] = m_origin[1] + ((m_offset[1] + j) + v) * m_dy;
+			p[2] = m_origin[2] + ((m_offset[2] + k) + w) * m_dz;
 		}
 		void writeVolume(std::string filename)
 		{
-			const size_t bytes{ m_scalars.size() };
 			auto myfile = std::fstream(filename, std::ios::out | std::ios::binary);
 			myfile.write((char*)&m_nx, sizeof(int));
 			myfile.write((char*)&m_ny, sizeof(int));
 			myfile.write((char*)&m_nz, sizeof(int));
-			myfile.write((char*)&m_scalars[0], sizeof(double) * bytes);
+			for (int g = 0; g < size(); g++) {
+				const double val = scalar(g);
+				myfile.write((char*)&val, sizeof(double));
+			}
 			myfile.close();
 		}
 		void clear()
@@ -327,8 +422,13 @@ namespace dmc {
 				m_bbox[i][1] = 0;
 				m_bbox[i][2] = 0;
 			}
-			m_scalars.clear(); //!< scalar values stored in the ugrid
-			m_gradient.clear(); //!< estimated gradient of scalar field
+			m_bx = m_by = m_bz = 0;
+			m_dense = true;
+			m_scalars.clear();
+			m_gradient.clear();
+			m_block_address.clear();
+			m_block_value.clear();
+			m_blocks.clear();
 		}
 	private:
 		int m_nx{ 0 }; //!< grid size in x-direction
@@ -338,14 +438,39 @@ namespace dmc {
 		double m_dy{ 0 }; //!< grid spacing in y-direction
 		double m_dz{ 0 }; //!< grid spacing in z-direction
 		std::array<Point, 8> m_bbox; //!< the bounding box of the ugrid.
-		std::vector<double> m_scalars; //!< scalar values stored in the ugrid
-		std::vector<Normal> m_gradient; //!< estimated gradient of scalar field
+		Point m_origin; //!< first node of the enclosing grid, see place()
+		Index m_offset{ 0, 0, 0 }; //!< index of this grid within the enclosing grid
+		bool m_dense{ true }; //!< nodes are stored in m_scalars and m_gradient, not in blocks
+		std::vector<double> m_scalars; //!< scalar values of a dense grid
+		std::vector<Normal> m_gradient; //!< estimated gradient of a dense grid
+		int m_bx{ 0 }; //!< grid size in blocks in x-direction
+		int m_by{ 0 }; //!< grid size in blocks in y-direction
+		int m_bz{ 0 }; //!< grid size in blocks in z-direction
+		std::vector<int> m_block_address; //!< index of each block in m_blocks, or -1 if uniform
+		std::vector<double> m_block_value; //!< scalar value of each uniform block
+		std::vector<Block> m_blocks; //!< allocated blocks: scalar values and estimated gradient
+
+		/// set the grid size, and make every block uniform with value val
+		void init_blocks(const int nx, const int ny, const int nz, const double val);
+		/// set the grid size, and allocate flat arrays with scalar value val
+		void init_dense(const int nx, const int ny, const int nz, const double val);
+		int block_index(const int bi, const int bj, const int bk) const { return (bk * m_by + bj) * m_bx + bi; }
+		static int node_offset(const int i, const int j, const int k)
+		{
+			constexpr int m = block_size - 1;
+			return (((k & m) << block_bits | (j & m)) << block_bits) | (i & m);
+		}
+		/// the allocated block containing node (i,j,k)
+		Block& block(const int i, const int j, const int k)
+		{
+			return m_blocks[m_block_address[block_index(i >> block_bits, j >> block_bits, k >> block_bits)]];
+		}
 
 	public:
 		/// print maximum scalar value stored in the ugrid.
-		void print_max_scalar() { std::cout << "min scalar: " << *std::max_element(m_scalars.begin(), m_scalars.end()) << std::endl; }
+		void print_max_scalar() { std::cout << "min scalar: " << max_scalar() << std::endl; }
 		/// print minimum scalar valued stored in the ugrid.
-		void print_min_scalar() { std::cout << "max scalar: " << *std::min_element(m_scalars.begin(), m_scalars.end()) << std::endl; }
+		void print_min_scalar() { std::cout << "max scalar: " << min_scalar() << std::endl; }
 		/// handle indices at grid boundaries using periodic conditions.
 		int mod(int n, int m) { return (n >= 0) ? (n%m) : (m - (-n % m)) % m; }
 		int mod(int n, int m) const { return (n >= 0) ? (n%m) : (m - (-n % m)) % m; }
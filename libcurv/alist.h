@@ -13,9 +13,10 @@ namespace curv {
 // See Generic_List for an API that abstracts over all list values,
 // both concrete and symbolic lists.
 //
-// At present, there are two Abstract_List subclasses: List and String.
-// String exists for efficiency reasons: with the List representation,
-// each character occupies 64 bits.
+// At present, there are three Abstract_List subclasses: List, String and
+// Num_Array. String exists for efficiency reasons: with the List
+// representation, each character occupies 64 bits. Num_Array is a packed
+// list of numbers, which array operations can process without unboxing.
 //
 // In the future, we need more specialized list representations,
 // for compactness and speed. Eg, bit lists, numeric ranges,
@@ -32,6 +33,8 @@ public:
     virtual Value val_at(size_t i) const = 0;
     static const char name[];
 };
+template<> struct Ref_Tag<Abstract_List>
+: Ref_Type_Tag<Ref_Value::ty_abstract_list> {};
 
 #define ASSERT_SIZE(fl,rval,list,sz,cx) \
     if (list->size() != sz) { \
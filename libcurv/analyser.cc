@@ -18,6 +18,7 @@
 #include <libcurv/tree.h>
 
 #include <functional>
+#include <mutex>
 
 namespace curv
 {
@@ -25,6 +26,9 @@ namespace curv
 void Source_State::deprecate(bool Source_State::* flag, int lvl,
     const Context& cx, String_Ref msg)
 {
+    // May be called by multiple threads during a parallel evaluation.
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
     if (system_.depr_ >= lvl && (system_.verbose_ || !((*this).*flag))) {
         system_.warning(Exception{cx, msg});
         (*this).*flag = true;
@@ -48,7 +52,7 @@ std_eval(const Phrase& ph, Environ& env)
     Builtin_Environ benv(
         env.sstate_.system_.std_namespace(), env.sstate_);
     auto op = analyse_op(ph, benv);
-    auto frame = make_tail_array<Frame>(benv.frame_maxslots_,
+    auto frame = Frame::make(benv.frame_maxslots_,
         env.sstate_, env.sstate_.file_frame_, nullptr, nullptr);
     return op->eval(*frame);
 }
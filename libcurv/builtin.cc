@@ -750,7 +750,11 @@ struct F_select : public Tuple_Function
         if (cond.type.is_bool()) {
             result = fm.sc_.newvalue(consequent.type);
             fm.sc_.out() << "  " << result.type << " " << result << " = ";
-            fm.sc_.out() << cond << "?" << consequent << ":" << alternate;
+            if (fm.sc_.target_ == SC_Target::interval) {
+                fm.sc_.out() << "select(" << cond << "," << consequent
+                    << "," << alternate << ")";
+            } else
+                fm.sc_.out() << cond << "?" << consequent << ":" << alternate;
         } else {
             // 'cond' is a boolean vector.
             if (consequent.type.count() == 1) {
@@ -774,7 +778,14 @@ struct F_select : public Tuple_Function
             // In GLSL 4.5, this is `mix(alt,cons,cond)` (all args are vectors).
             // Right now, we are locked to GLSL 3.3, so we can't use this.
             // TODO: SubCurv: more efficient `select` for vector case
-            if (result.type.is_num_vec()) {
+            if (fm.sc_.target_ == SC_Target::interval
+                || fm.sc_.target_ == SC_Target::dual)
+            {
+                // The interval and dual number preludes have an
+                // elementwise 'select'.
+                fm.sc_.out() << "select(" << cond << "," << consequent
+                    << "," << alternate << ")";
+            } else if (result.type.is_num_vec()) {
                 // This version of 'mix' is linear interpolation: it works by
                 // multiplication and addition of all 3 arguments. Which is
                 // different from the boolean vector 'mix' in GLSL 4.5 (which
@@ -869,8 +880,20 @@ struct F_dot : public Tuple_Function
 };
 Value F_dot::dot(Value a, Value b, Fail fl, const At_Arg& cx) const
 {
-    auto av = a.maybe<List>();
-    auto bv = b.maybe<List>();
+    auto an = a.maybe<const Num_Array>();
+    auto bn = b.maybe<const Num_Array>();
+    if (an && bn) {
+        // Fast path: the dot product of two packed vectors.
+        if (an->size() != bn->size())
+            throw Exception(cx, stringify("list of size ",an->size(),
+                " can't be multiplied by list of size ",bn->size()));
+        double result = 0.0;
+        for (size_t i = 0; i < an->size(); ++i)
+            result += an->at(i) * bn->at(i);
+        return {result};
+    }
+    auto av = an ? unpack_list(a, cx) : a.maybe<const List>();
+    auto bv = bn ? unpack_list(b, cx) : b.maybe<const List>();
     if (av && bv) {
         if (av->size() > 0 && av->at(0).maybe<List>()) {
             Shared<List> result = make_tail_array<List>(av->size());
@@ -936,6 +959,12 @@ struct F_mag : public Tuple_Function
         // Slower.  https://forum.kde.org/viewtopic.php?f=74&t=62402
 
         // Fast path: assume we have a list of numbers, compute a result.
+        if (auto na = args[0].maybe<const Num_Array>()) {
+            double sum = 0.0;
+            for (double x : *na)
+                sum += x * x;
+            return {sqrt(sum)};
+        }
         if (auto list = args[0].maybe<List>()) {
             double sum = 0.0;
             for (auto val : *list) {
@@ -1057,6 +1086,17 @@ Value to_char(Value arg, Fail fl, const Context& cx)
             return missing;
         return Value{char(code)};
     }
+    else if (auto na = arg.maybe<const Num_Array>()) {
+        // A Num_Array is non-empty, and its elements are all numbers.
+        Shared<String> s = make_uninitialized_string(na->size());
+        for (size_t i = 0; i < na->size(); ++i) {
+            int code;
+            if (!num_to_int(na->at(i), code, 1, 127, fl, cx))
+                return missing;
+            s->at(i) = char(code);
+        }
+        return {s};
+    }
     else if (auto list = arg.maybe<List>()) {
         if (list->empty()) return arg;
         Shared<String> s = make_uninitialized_string(list->size());
@@ -1200,7 +1240,7 @@ struct F_tslice : public Function
     virtual Value call(Value arg, Fail fl, Frame& fm) const override
     {
         At_Arg cx(*this, fm);
-        TRY_DEF(list, arg.to<List>(fl, cx));
+        TRY_DEF(list, unpack_list(arg, fl, cx));
         return make_tslice(list->begin(), list->end());
     }
 };
@@ -1210,7 +1250,7 @@ struct F_tpath : public Function
     virtual Value call(Value arg, Fail fl, Frame& fm) const override
     {
         At_Arg cx(*this, fm);
-        TRY_DEF(list, arg.to<List>(fl, cx));
+        TRY_DEF(list, unpack_list(arg, fl, cx));
         return make_tpath(list->begin(), list->end());
     }
 };
@@ -1219,7 +1259,8 @@ struct F_amend : public Curried_Function
     F_amend(const char* nm) : Curried_Function(3,nm) {}
     virtual Value ccall(const Function& self, Fail, Frame& args) const
     {
-        return tree_amend(args[2], args[0], args[1], At_Arg(*this, args));
+        return tree_amend(move(args[2]), args[0], args[1],
+            At_Arg(*this, args));
     }
 };
 
@@ -1243,7 +1284,7 @@ struct File_Expr : public Just_Expression
         // Each call to `file pathname` has its own stack frame,
         // which permits calls to `file pathname` to appear in stack traces.
         auto& callphrase = dynamic_cast<const Call_Phrase&>(*syntax_);
-        std::unique_ptr<Frame> f2 = make_tail_array<Frame>(0,
+        std::unique_ptr<Frame> f2 = Frame::make(0,
             fm.sstate_, &fm, fm.func_, &callphrase);
         At_Metacall_With_Call_Frame cx("file", 0, *f2);
 
@@ -7,8 +7,10 @@
 #include <libcurv/context.h>
 #include <libcurv/exception.h>
 #include <libcurv/import.h>
+#include <libcurv/system.h>
 #include <cstdlib>
 #include <iostream>
+#include <mutex>
 
 namespace curv {
 
@@ -93,6 +95,8 @@ Value Dir_Record::find_field(Symbol_Ref sym, const Context& cx) const
     auto p = fields_.find(sym);
     if (p == fields_.end())
         return missing;
+    std::lock_guard<std::recursive_mutex> lock(
+        cx.system().import_cache_.mutex_);
     if (p->second.value_.is_missing())
         p->second.value_ =
             import_value(p->second.importer_, p->second.path_, cx);
@@ -123,6 +127,8 @@ Dir_Record::ref_field(Symbol_Ref name, bool need_value, const Context& cx)
         throw Exception(cx, stringify(Value{share(*this)},
             " has no field named ", name));
     }
+    std::lock_guard<std::recursive_mutex> lock(
+        cx.system().import_cache_.mutex_);
     if (p->second.value_.is_missing()) {
         if (need_value)
             p->second.value_ =
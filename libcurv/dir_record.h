@@ -46,6 +46,8 @@ struct Dir_Record : public Record
     };
     virtual std::unique_ptr<Record::Iter> iter() const override;
 };
+template<> struct Ref_Tag<Dir_Record>
+: Ref_Subtype_Tag<Ref_Value::sty_dir_record> {};
 
 }
 #endif
@@ -60,7 +60,7 @@ Action_Executor::push_field(Symbol_Ref, Value, const Context& cstmt)
 void
 List_Executor::push_value(Value val, const Context& cx)
 {
-    list_.push_back(val);
+    list_.push_back(move(val));
 }
 void
 List_Executor::push_field(
@@ -76,12 +76,12 @@ Record_Executor::push_value(Value val, const Context& cstmt)
     auto pair = val.to<List>(cstmt);
     pair->assert_size(2, cstmt);
     Symbol_Ref name = value_to_symbol(pair->at(0), cstmt);
-    record_.fields_[name] = pair->at(1);
+    record_.set(name, pair->at(1));
 }
 void
 Record_Executor::push_field(Symbol_Ref name, Value value, const Context& cx)
 {
-    record_.fields_[name] = value;
+    record_.set(name, value);
 }
 
 void
@@ -148,6 +148,36 @@ Dot_Expr::eval(Frame& fm) const
 {
     Value basev = base_->eval(fm);
     Symbol_Ref id = selector_.eval(fm);
+    if (basev.is_ref() && basev.to_ref_unsafe().type_ == Ref_Value::ty_record) {
+        Ref_Value& r = basev.to_ref_unsafe();
+        if (r.subtype_ == Ref_Value::sty_drecord) {
+            auto& drec = (DRecord&)r;
+            if (drec.layout_.get() == ic_layout_.get() && id == ic_name_)
+                return drec.values_[ic_slot_];
+            int i = drec.layout_->find(id);
+            if (i >= 0) {
+                if (!atomic_refcounts) {
+                    ic_layout_ = drec.layout_;
+                    ic_name_ = id;
+                    ic_slot_ = slot_t(i);
+                }
+                return drec.values_[i];
+            }
+        } else if (r.subtype_ == Ref_Value::sty_module) {
+            auto& mod = (Module&)r;
+            if (mod.dictionary_.get() == ic_layout_.get() && id == ic_name_)
+                return mod.get(ic_slot_);
+            auto b = mod.dictionary_->find(id);
+            if (b != mod.dictionary_->end()) {
+                if (!atomic_refcounts) {
+                    ic_layout_ = mod.dictionary_;
+                    ic_name_ = id;
+                    ic_slot_ = b->second;
+                }
+                return mod.get(b->second);
+            }
+        }
+    }
     return record_at(basev, id, At_Phrase(*base_->syntax_, fm));
 }
 
@@ -350,7 +380,7 @@ call_func(Value func, Value arg, Shared<const Phrase> call_phrase, Frame& fm)
         case Ref_Value::ty_function:
           {
             Function* fun = (Function*)&funp;
-            std::unique_ptr<Frame> f2 = make_tail_array<Frame>(fun->nslots_,
+            std::unique_ptr<Frame> f2 = Frame::make(fun->nslots_,
                 fm.sstate_, &fm, fm.func_, call_phrase);
             f2->func_ = share(*fun);
             fun->tail_call(arg, f2);
@@ -396,7 +426,7 @@ tail_call_func(
         case Ref_Value::ty_function:
           {
             Function* fun = (Function*)&funp;
-            fm = make_tail_array<Frame>(fun->nslots_,
+            fm = Frame::make(fun->nslots_,
                 fm->sstate_, fm->parent_frame_, fm->func_, call_phrase);
             fm->func_ = share(*fun);
             fun->tail_call(arg, fm);
@@ -464,9 +494,16 @@ Spread_Op::exec(Frame& fm, Executor& ex) const
     At_Phrase cstmt(*syntax_, fm);
     At_Phrase carg(*arg_->syntax_, fm);
     auto arg = arg_->eval(fm);
-    if (auto list = arg.maybe<const List>()) {
+    if (auto list = arg.maybe<List>()) {
+        // If arg and list are the only references, move the elements.
+        bool unique = list->use_count == 2;
         for (size_t i = 0; i < list->size(); ++i)
-            ex.push_value(list->at(i), cstmt);
+            ex.push_value(unique ? move(list->at(i)) : list->at(i), cstmt);
+        return;
+    }
+    if (auto na = arg.maybe<const Num_Array>()) {
+        for (double n : *na)
+            ex.push_value(Value{n}, cstmt);
         return;
     }
     if (auto string = arg.maybe<const String>()) {
@@ -537,10 +574,15 @@ Local_Locative::fetch(Frame& fm) const
 {
     return fm[slot_];
 }
+Value
+Local_Locative::fetch_move(Frame& fm) const
+{
+    return move(fm[slot_]);
+}
 void
 Local_Locative::store(Frame& fm, Value val, const At_Syntax&) const
 {
-    fm[slot_] = val;
+    fm[slot_] = move(val);
 }
 
 Value
@@ -553,10 +595,20 @@ Indexed_Locative::fetch(Frame& fm) const
 void
 Indexed_Locative::store(Frame& fm, Value val, const At_Syntax& valcx) const
 {
-    auto curval = base_->fetch(fm);
+    // Evaluate the index first, since it may refer to the base.
     auto index = index_->eval(fm);
-    auto newval = tree_amend(curval, index, val, At_Phrase(*syntax_,fm));
-    base_->store(fm, newval, valcx);
+    auto curval = base_->fetch_move(fm);
+    Value newval;
+    try {
+        newval = tree_amend(move(curval), index, move(val),
+            At_Phrase(*syntax_,fm));
+    } catch (...) {
+        // tree_amend leaves curval unchanged if it fails, so put it back,
+        // instead of leaving the variable empty.
+        base_->store(fm, move(curval), valcx);
+        throw;
+    }
+    base_->store(fm, move(newval), valcx);
 }
 
 Value
@@ -695,6 +747,14 @@ For_Op::exec(Frame& fm, Executor& ex) const
                 break;
             body_->exec(fm, ex);
         }
+    } else if (auto na = values.maybe<const Num_Array>()) {
+        for (size_t i = 0; i < na->size(); ++i) {
+            icx.index_ = i;
+            pattern_->exec(fm.array_, {na->at(i)}, cx, fm);
+            if (cond_ && cond_->eval(fm).to_bool(At_Phrase{*cond_->syntax_,fm}))
+                break;
+            body_->exec(fm, ex);
+        }
     } else {
         throw Exception(cx, stringify(values, " is not a list"));
     }
@@ -797,7 +857,7 @@ void
 Bracket_Segment::generate(Frame& fm, String_Builder& sb) const
 {
     At_Phrase cx(*expr_->syntax_, fm);
-    auto list = expr_->eval(fm).to<List>(cx);
+    auto list = unpack_list(expr_->eval(fm), cx);
     for (size_t i = 0; i < list->size(); ++i)
         sb << (char)(*list)[i].to_int(1, 127, At_Index(i,cx));
 }
@@ -809,7 +869,7 @@ Brace_Segment::generate(Frame& fm, String_Builder& sb) const
     if (auto str = val.maybe<String>())
         sb << *str;
     else {
-        auto list = val.to<List>(cx);
+        auto list = unpack_list(val, cx);
         for (auto val : *list)
             val.print_string(sb);
     }
@@ -901,13 +961,13 @@ Value Parametric_Ctor::call(Value arg, Fail fl, Frame& fm) const
     // Merge defl_ with arec; fail if arec contains fields not in defl_;
     // place result in drec.
     defl_->each_field(acx, [&](Symbol_Ref id, Value val) -> void {
-        drec->fields_[id] = val;
+        drec->set(id, val);
     });
     for (auto field = arec->iter(); !field->empty(); field->next()) {
         auto id = field->key();
-        auto ep = drec->fields_.find(id);
-        if (ep != drec->fields_.end())
-            ep->second = field->value(acx);
+        auto ep = drec->find(id);
+        if (ep != nullptr)
+            *ep = field->value(acx);
         else {
             FAIL(fl, missing, acx, stringify("bad argument ",id));
         }
@@ -915,8 +975,10 @@ Value Parametric_Ctor::call(Value arg, Fail fl, Frame& fm) const
     // call parametric record constructor
     TRY_DEF(rval, ctor_->call({drec}, fl, fm));
     auto result = update_drecord(rval, acx); // fault on error
-    result->fields_[make_symbol("call")] = {ctor_};
-    result->fields_[make_symbol("argument")] = {drec};
+    // The result is another parametric record, whose parameters
+    // default to the values in this argument.
+    result->set(make_symbol("call"), {make<Parametric_Ctor>(ctor_, drec)});
+    result->set(make_symbol("argument"), {drec});
     return {result};
 }
 
@@ -930,19 +992,18 @@ Parametric_Expr::eval(Frame& fm) const
     if (closure == nullptr)
         throw Exception(cx, "internal error in Parametric_Expr");
     Shared<const Phrase> call_phrase = syntax_; // TODO?
-    std::unique_ptr<Frame> f2 = make_tail_array<Frame>(closure->nslots_,
+    std::unique_ptr<Frame> f2 = Frame::make(closure->nslots_,
         fm.sstate_, &fm, fm.func_, call_phrase);
     auto default_arg = record_pattern_default_value(*closure->pattern_,*f2);
     Value res = closure->call({default_arg}, Fail::hard, *f2);
     auto rec = res.to<Record>(cxbody);
     auto drec = make<DRecord>();
     rec->each_field(cxbody, [&](Symbol_Ref id, Value val) -> void {
-        drec->fields_[id] = val;
+        drec->set(id, val);
     });
-    // TODO: The `call` function should return another parametric record.
-    drec->fields_[make_symbol("call")] =
-        {make<Parametric_Ctor>(closure, default_arg)};
-    drec->fields_[make_symbol("argument")] = {default_arg};
+    drec->set(make_symbol("call"),
+        {make<Parametric_Ctor>(closure, default_arg)});
+    drec->set(make_symbol("argument"), {default_arg});
     return {drec};
 }
 
@@ -965,7 +1026,7 @@ Value TPath_Expr::eval(Frame& fm) const
 Value TSlice_Expr::eval(Frame& fm) const
 {
     Value ival = indexes_->eval(fm);
-    auto ilist = ival.to<List>(At_Phrase(*indexes_->syntax_, fm));
+    auto ilist = unpack_list(ival, At_Phrase(*indexes_->syntax_, fm));
     return make_tslice(ilist->begin(), ilist->end());
 }
 
@@ -5,8 +5,10 @@
 #ifndef LIBCURV_EXCEPTION_H
 #define LIBCURV_EXCEPTION_H
 
+#include <atomic>
 #include <exception>
 #include <list>
+#include <mutex>
 #include <ostream>
 #include <libcurv/location.h>
 #include <libcurv/string.h>
@@ -106,6 +108,40 @@ struct Exception : public Exception_Base
 
 Shared<const String> illegal_character_message(char ch);
 
+/// An exception must not propagate out of an OpenMP parallel region,
+/// or out of a worker thread. Thread_Exception captures the first exception
+/// thrown by the workers, so that it can be rethrown by the calling thread
+/// once the workers are finished.
+struct Thread_Exception
+{
+    std::mutex mutex_;
+    std::exception_ptr eptr_ = nullptr;
+    std::atomic<bool> thrown_{false};
+
+    // Call f(), capturing any exception that it throws.
+    // Once an exception has been captured, later calls do nothing.
+    template <class F> void guard(F f) noexcept
+    {
+        if (thrown_.load(std::memory_order_relaxed))
+            return;
+        try {
+            f();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (eptr_ == nullptr)
+                eptr_ = std::current_exception();
+            thrown_ = true;
+        }
+    }
+
+    // Rethrow the captured exception, if any.
+    void rethrow()
+    {
+        if (eptr_ != nullptr)
+            std::rethrow_exception(eptr_);
+    }
+};
+
 inline std::ostream& operator<<(std::ostream& out, const Exception& e)
 {
     e.write(out, false);
@@ -0,0 +1,33 @@
+// Copyright 2016-2021 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/filesystem.h>
+
+#include <cstdlib>
+
+namespace curv {
+
+Filesystem::path
+cache_dir(const char* name)
+{
+    Filesystem::path dir;
+    const char* XDG_CACHE_HOME = getenv("XDG_CACHE_HOME");
+    if (XDG_CACHE_HOME == nullptr || XDG_CACHE_HOME[0] == '\0') {
+        const char* HOME = getenv("HOME");
+        if (HOME == nullptr || HOME[0] == '\0')
+            return {};
+        dir = HOME;
+        dir /= ".cache";
+    } else {
+        dir = XDG_CACHE_HOME;
+    }
+    dir = dir / "curv" / name;
+    std::error_code err;
+    Filesystem::create_directories(dir, err);
+    if (err)
+        return {};
+    return dir;
+}
+
+} // namespace curv
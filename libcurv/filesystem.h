@@ -21,5 +21,10 @@ struct Path_Hash
     }
 };
 
+// Return the directory $XDG_CACHE_HOME/curv/<name> (or ~/.cache/curv/<name>),
+// creating it if necessary. Return an empty path if there is no cache
+// directory, or it can't be created.
+Filesystem::path cache_dir(const char* name);
+
 } // namespace curv
 #endif // header guard
@@ -6,9 +6,124 @@
 
 #include <libcurv/function.h>
 #include <libcurv/phrase.h>
+#include <cstddef>
 
 namespace curv {
 
+namespace {
+
+// Frames with more slots than this are allocated using malloc.
+constexpr slot_t max_pooled_slots = 64;
+
+// The maximum number of free frames of each size kept by a pool.
+// Frames freed beyond this limit, after a deep recursion, or by a thread
+// that frees frames allocated by other threads, are returned to malloc.
+constexpr unsigned max_pooled_frames = 256;
+
+// Each frame is preceded by a header, which records the size class
+// of the block, and links the block into a free list while it is free.
+struct alignas(std::max_align_t) Frame_Block
+{
+    slot_t nslots;
+    Frame_Block* next;
+};
+
+struct Frame_Pool
+{
+    Frame_Block* free_[max_pooled_slots + 1] = {};
+    unsigned count_[max_pooled_slots + 1] = {};
+    Frame_Pool_Stats stats_;
+
+    void* alloc(slot_t nslots)
+    {
+        ++stats_.allocs;
+        Frame_Block* b = nullptr;
+        if (nslots <= max_pooled_slots && free_[nslots] != nullptr) {
+            b = free_[nslots];
+            free_[nslots] = b->next;
+            --count_[nslots];
+            --stats_.cached;
+        } else {
+            ++stats_.mallocs;
+            b = (Frame_Block*)malloc(
+                sizeof(Frame_Block) + sizeof(Frame) + nslots*sizeof(Value));
+            if (b == nullptr)
+                throw std::bad_alloc();
+            b->nslots = nslots;
+        }
+        return b + 1;
+    }
+    void release(void* p) noexcept
+    {
+        ++stats_.frees;
+        Frame_Block* b = (Frame_Block*)p - 1;
+        if (b->nslots <= max_pooled_slots
+            && count_[b->nslots] < max_pooled_frames)
+        {
+            b->next = free_[b->nslots];
+            free_[b->nslots] = b;
+            ++count_[b->nslots];
+            ++stats_.cached;
+        } else
+            free(b);
+    }
+    ~Frame_Pool();
+};
+
+thread_local Frame_Pool frame_pool;
+
+// Frames that outlive the thread's pool (such as frames owned by static
+// objects, destroyed at exit) are freed directly.
+thread_local bool frame_pool_destroyed = false;
+
+Frame_Pool::~Frame_Pool()
+{
+    for (auto b : free_) {
+        while (b != nullptr) {
+            Frame_Block* next = b->next;
+            free(b);
+            b = next;
+        }
+    }
+    frame_pool_destroyed = true;
+}
+
+} // namespace
+
+std::unique_ptr<Frame>
+Frame::make(slot_t nslots, Source_State& sstate, Frame* parent,
+    Shared<const Function> caller, Shared<const Phrase> call_phrase)
+{
+    void* mem = frame_pool.alloc(nslots);
+    Frame* r = (Frame*)mem;
+    for (slot_t i = 0; i < nslots; ++i)
+        new((void*)&r->array_[i]) Value();
+    try {
+        new(mem) Frame(sstate, parent, move(caller), move(call_phrase));
+        r->size_ = nslots;
+    } catch (...) {
+        r->destroy_array(nslots);
+        frame_pool.release(mem);
+        throw;
+    }
+    return std::unique_ptr<Frame>(r);
+}
+
+void
+Frame::operator delete(void* p) noexcept
+{
+    if (frame_pool_destroyed)
+        free((Frame_Block*)p - 1);
+    else
+        frame_pool.release(p);
+}
+
+const Frame_Pool_Stats&
+frame_pool_stats()
+{
+    return frame_pool.stats_;
+}
+
 Frame_Base::Frame_Base(Source_State& sstate, Frame* parent,
     Shared<const Function> caller, Shared<const Phrase> src)
 :
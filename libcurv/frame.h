@@ -97,7 +97,37 @@ struct Frame_Base
 struct Frame final : public Tail_Array<Frame_Base>
 {
     using Tail_Array<Frame_Base>::Tail_Array;
+
+    /// Allocate a frame with `nslots` slots, from the current thread's
+    /// frame pool. All frames must be created using this function.
+    static std::unique_ptr<Frame> make(slot_t nslots, Source_State&,
+        Frame* parent, Shared<const Function> caller,
+        Shared<const Phrase> call_phrase);
+
+    /// Return the frame's storage to the current thread's frame pool,
+    /// which need not be the pool it was allocated from.
+    void operator delete(void*) noexcept;
+};
+
+/// Frame storage is recycled by a per-thread pool, which has a free list
+/// for each frame size. Frames are created and destroyed in stack order,
+/// so once the evaluator has warmed up, a function call reuses the storage
+/// of the last frame of the same size, and doesn't call malloc or free.
+/// Each free list holds a limited number of frames, so that the memory used
+/// by deep recursion is returned to malloc afterwards.
+/// A frame freed on a different thread from the one that allocated it goes
+/// to the freeing thread's pool. This is intended: pools aren't locked, and
+/// since each free list is bounded, a thread that frees more frames than it
+/// allocates holds at most 256 free frames of each size.
+/// These counters are for the current thread.
+struct Frame_Pool_Stats
+{
+    size_t allocs = 0;   // number of frames allocated
+    size_t mallocs = 0;  // number of allocations not satisfied by the pool
+    size_t frees = 0;    // number of frames freed
+    size_t cached = 0;   // number of free frames held by the pool
 };
+const Frame_Pool_Stats& frame_pool_stats();
 
 Value tail_eval_frame(std::unique_ptr<Frame>);
 
@@ -102,7 +102,7 @@ Partial_Application_Base::call(Value arg, Fail fl, Frame& fm) const
     if (fname_.argpos_ == nargs() - 1) {
         for (unsigned i = 0; i < fname_.argpos_; ++i)
             fm[i] = array_[i];
-        fm[fname_.argpos_] = arg;
+        fm[fname_.argpos_] = move(arg);
         return cfunc_->ccall(*this, fl, fm);
     } else {
         Shared<Partial_Application> pa = make_tail_array<Partial_Application>
@@ -211,10 +211,12 @@ Closure::sc_call_expr(Operation& arg, Shared<const Phrase> cp, SC_Frame& fm) con
     auto f2 = make_tail_array<SC_Frame>(nslots_, fm.sc_, nullptr, &fm,
         share(*this), cp);
     f2->nonlocals_ = &*nonlocals_;
+    for (slot_t i = 0; i < nslots_; ++i)
+        (*f2)[i].index = SC_Value::unset;
     // match pattern against argument, store formal parameters in frame
     pattern_->sc_exec(arg, fm, *f2);
-    // evaluation function body, return result.
-    return sc_eval_op(*f2, *expr_);
+    // evaluate function body (inline, or as a call to an outlined function)
+    return sc_eval_body(*f2, *expr_);
 }
 
 void
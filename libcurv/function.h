@@ -70,6 +70,7 @@ struct Function : public Ref_Value
 
     static const char name[];
 };
+template<> struct Ref_Tag<Function> : Ref_Type_Tag<Ref_Value::ty_function> {};
 
 // Convert a value to a function,
 // returning nullptr if the argument is not a function.
@@ -203,6 +204,7 @@ struct Lambda : public Ref_Value
     /// Print a value like a Curv expression.
     virtual void print_repr(std::ostream&, Prec) const;
 };
+template<> struct Ref_Tag<Lambda> : Ref_Type_Tag<Ref_Value::ty_lambda> {};
 
 /// A user-defined function value,
 /// represented by a closure over a lambda expression.
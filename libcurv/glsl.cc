@@ -8,7 +8,10 @@
 #include <libcurv/function.h>
 #include <libcurv/sc_compiler.h>
 #include <libcurv/shape.h>
+#include <libcurv/system.h>
 #include <libcurv/viewed_shape.h>
+#include <iostream>
+#include <sstream>
 
 namespace curv {
 
@@ -28,7 +31,14 @@ void glsl_function_export(const Shape_Program& shape, std::ostream& out)
         shape.dist_fun_, cx);
     sc.define_function("colour", SC_Type::Num(4), SC_Type::Num(3),
         shape.colour_fun_, cx);
-    sc.emit_objects(out);
+    std::stringstream code;
+    sc.emit_objects(code);
+    out << code.rdbuf();
+    if (shape.sstate_.system_.verbose_) {
+        std::cerr << "GLSL shape code: " << code.str().size() << " bytes, "
+                  << sc.outlined_functions_ << " outlined functions, "
+                  << sc.outlined_calls_ << " outlined calls\n";
+    }
 }
 
 } // namespace
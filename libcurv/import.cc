@@ -9,6 +9,7 @@
 #include <libcurv/exception.h>
 #include <libcurv/program.h>
 #include <libcurv/system.h>
+#include <algorithm>
 #include <cstdlib>
 
 namespace curv {
@@ -39,6 +40,35 @@ void import(const Filesystem::path& path, Program& prog, const Context& cx)
     }
 }
 
+bool File_Stamp::get(const Filesystem::path& path)
+{
+    std::error_code errcode;
+    path_ = path;
+    mtime_ = Filesystem::last_write_time(path, errcode);
+    if (errcode) return false;
+    if (Filesystem::is_directory(path, errcode)) {
+        size_ = 0;
+        return true;
+    }
+    size_ = Filesystem::file_size(path, errcode);
+    return !errcode;
+}
+
+bool File_Stamp::changed() const
+{
+    File_Stamp now;
+    return !now.get(path_) || now.mtime_ != mtime_ || now.size_ != size_;
+}
+
+void Import_Cache::add_deps(const std::vector<File_Stamp>& deps, bool cacheable)
+{
+    if (active_.empty())
+        return;
+    auto& a = active_.back();
+    a.deps_.insert(a.deps_.end(), deps.begin(), deps.end());
+    a.cacheable_ = a.cacheable_ && cacheable;
+}
+
 Value
 import_value(Importer imp, const Filesystem::path& path, const Context& cx)
 {
@@ -46,15 +76,55 @@ import_value(Importer imp, const Filesystem::path& path, const Context& cx)
     auto filekey = Filesystem::canonical(path, errcode);
     if (errcode)
         throw Exception(cx, stringify(path,": ",errcode.message()));
+    auto& cache = cx.system().import_cache_;
+    std::lock_guard<std::recursive_mutex> lock(cache.mutex_);
     auto& active_files = cx.system().active_files_;
     if (active_files.find(filekey) != active_files.end())
         throw Exception{cx,
             stringify("illegal recursive reference to file ",path)};
+
+    auto e = cache.entries_.find(filekey);
+    if (e != cache.entries_.end()) {
+        bool changed = false;
+        for (auto& dep : e->second.deps_) {
+            if (dep.changed()) {
+                changed = true;
+                break;
+            }
+        }
+        if (!changed) {
+            cache.add_deps(e->second.deps_, true);
+            return e->second.value_;
+        }
+        cache.entries_.erase(e);
+    }
+
     Active_File af(active_files, filekey);
+    Active_Import_Guard active(cache);
+    // The stamp is taken before the file is read, so that a change made
+    // during evaluation is noticed by the next import.
+    File_Stamp stamp;
+    if (stamp.get(filekey))
+        active.get().deps_.push_back(stamp);
+    else
+        active.get().cacheable_ = false;
+    if (Filesystem::is_directory(filekey, errcode))
+        active.get().cacheable_ = false;
 
     Program prog(cx.system(), cx.frame());
     imp(path, prog, cx);
-    return prog.eval();
+    Value val = prog.eval();
+    if (active.get().cacheable_) {
+        auto deps = active.get().deps_;
+        std::sort(deps.begin(), deps.end(),
+            [](const File_Stamp& a, const File_Stamp& b)
+                { return a.path_ < b.path_; });
+        deps.erase(std::unique(deps.begin(), deps.end(),
+            [](const File_Stamp& a, const File_Stamp& b)
+                { return a.path_ == b.path_; }), deps.end());
+        cache.entries_[filekey] = {val, std::move(deps)};
+    }
+    return val;
 }
 
 void curv_import(const Filesystem::path& path, Program& prog, const Context& cx)
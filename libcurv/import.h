@@ -7,6 +7,9 @@
 
 #include <libcurv/filesystem.h>
 #include <libcurv/value.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace curv {
 
@@ -21,8 +24,86 @@ struct Program;
 void import(const Filesystem::path&, Program&, const Context&);
 
 typedef void (*Importer)(const Filesystem::path&, Program&, const Context&);
+
+// Import a file and return its value. The value is cached in the
+// System's Import_Cache.
 Value import_value(Importer, const Filesystem::path&, const Context&);
 
+// The modification time and size of a file, used to detect that it changed.
+struct File_Stamp
+{
+    Filesystem::path path_;
+    Filesystem::file_time_type mtime_;
+    std::uintmax_t size_;
+
+    // Return false if the file can't be stat'ed. The size of a directory
+    // is 0: its mtime changes when a member is added, removed or renamed.
+    bool get(const Filesystem::path&);
+    bool changed() const;
+};
+
+// The import cache maps the canonical pathname of an imported file onto its
+// value, so that a file imported many times (eg, by each of the 200 part
+// files in a library) is evaluated once per process.
+//
+// Each entry records the dependencies of the value: the file itself, and
+// every file that it imported, transitively. The entry is reused until one of
+// them changes, so a livemode or REPL reload re-evaluates only the files that
+// changed, and the files that import them. Side effects such as `print` are
+// not repeated when a cached value is used.
+//
+// Directories aren't cached: a directory record imports its members lazily,
+// after the directory import is finished, and the set of members can change.
+// For the same reason, a file that imports a directory isn't cached.
+// Directories are still recorded as dependencies, for the use of livemode,
+// which watches the dependencies of the main program for changes.
+struct Import_Cache
+{
+    struct Entry
+    {
+        Value value_;
+        std::vector<File_Stamp> deps_;
+    };
+    std::unordered_map<Filesystem::path, Entry, Path_Hash> entries_;
+
+    // There is one Active_Import for each import_value call in progress,
+    // innermost last. It collects the dependencies of the file being imported.
+    struct Active_Import
+    {
+        std::vector<File_Stamp> deps_;
+        bool cacheable_ = true;
+    };
+    std::vector<Active_Import> active_;
+
+    // Files are imported lazily by directory records, and a shape may be
+    // evaluated by several threads at once (see atomic_refcounts), so
+    // imports are serialized.
+    std::recursive_mutex mutex_;
+
+    // Add dependencies to the innermost import in progress.
+    void add_deps(const std::vector<File_Stamp>&, bool cacheable);
+};
+
+// RAII helper class, for use with Import_Cache::active_. While it exists,
+// the dependencies of files imported by the current thread are collected
+// in get().deps_. When it is destroyed, they become dependencies of the
+// enclosing import, if there is one.
+struct Active_Import_Guard
+{
+    Import_Cache& cache_;
+    Active_Import_Guard(Import_Cache& cache) : cache_(cache)
+    {
+        cache_.active_.emplace_back();
+    }
+    ~Active_Import_Guard()
+    {
+        auto a = std::move(cache_.active_.back());
+        cache_.active_.pop_back();
+        cache_.add_deps(a.deps_, a.cacheable_);
+    }
+    Import_Cache::Active_Import& get() { return cache_.active_.back(); }
+};
+
 // Import a Curv language source file.
 void curv_import(const Filesystem::path& path, Program&, const Context& cx);
 
@@ -5,12 +5,15 @@
 #include <libcurv/io/compiled_shape.h>
 
 #include <libcurv/context.h>
+#include <libcurv/exception.h>
 #include <libcurv/function.h>
+#include <libcurv/picker.h>
 #include <libcurv/system.h>
 
 namespace curv { namespace io {
 
-Compiled_Shape::Compiled_Shape(Shape_Program& rshape)
+Compiled_Shape::Compiled_Shape(
+    const Shape_Program& rshape, bool interval, bool gradient)
 :
     cpp_{rshape.sstate_}
 {
@@ -20,13 +23,147 @@ Compiled_Shape::Compiled_Shape(Shape_Program& rshape)
 
     At_SState cx{rshape.sstate_};
 
-    cpp_.define_function("dist", SC_Type::Num(4), SC_Type::Num(),
-        rshape.dist_fun_, cx);
-    cpp_.define_function("colour", SC_Type::Num(4), SC_Type::Num(3),
-        rshape.colour_fun_, cx);
+    // If the shape is parametric, then compile the parametric version,
+    // whose picker parameters are read from the parameter block.
+    // If that fails (eg, because SubCurv requires a parameter to be a
+    // constant), then compile this instance of the shape, with the values
+    // of its parameters compiled into the code, and with no parameter block.
+    auto pshape = vshape_.parametric_shape(rshape);
+    if (pshape) {
+        try {
+            static Symbol_Ref argument_key = make_symbol("argument");
+            argument_ =
+                rshape.record_->getfield(argument_key, cx).to<Record>(cx);
+            for (auto& p : vshape_.param_) {
+                cpp_.define_parameter(p.second.identifier_.c_str(),
+                    p.second.pconfig_.sctype_, params_.size());
+                params_.resize(
+                    params_.size() + p.second.pconfig_.sctype_.count());
+            }
+            set_parameters(rshape);
+            cpp_.define_function("dist", SC_Type::Num(4), SC_Type::Num(),
+                pshape->dist_fun_, cx);
+            cpp_.define_function("colour", SC_Type::Num(4), SC_Type::Num(3),
+                pshape->colour_fun_, cx);
+        } catch (Exception& e) {
+            if (rshape.sstate_.system_.verbose_)
+                rshape.sstate_.system_.warning(e);
+            cpp_.clear_functions();
+            pshape = nullptr;
+            argument_ = nullptr;
+            params_.clear();
+            vshape_.param_.clear();
+        }
+    }
+    const Shape_Program& shape = pshape ? *pshape : rshape;
+    if (!pshape) {
+        cpp_.define_function("dist", SC_Type::Num(4), SC_Type::Num(),
+            shape.dist_fun_, cx);
+        cpp_.define_function("colour", SC_Type::Num(4), SC_Type::Num(3),
+            shape.colour_fun_, cx);
+    }
+    cpp_.define_dist_batch("dist_batch", "dist");
+    cpp_.define_colour_batch("colour_batch", "colour");
+    if (interval) {
+        // If the distance function uses an operation that isn't supported
+        // by interval arithmetic, then dist_interval falls back to
+        // Shape::dist_interval, instead of failing to compile the shape.
+        // Cpp_Program::compile() does the same if the C++ compiler rejects
+        // the interval code (or the dual number code, below).
+        try {
+            cpp_.define_interval_function("dist", SC_Type::Num(4),
+                SC_Type::Num(), shape.dist_fun_, cx);
+            cpp_.define_dist_interval("dist_interval", "dist");
+        } catch (Exception& e) {
+            if (rshape.sstate_.system_.verbose_)
+                rshape.sstate_.system_.warning(e);
+            cpp_.clear_interval_functions();
+        }
+    }
+    if (gradient) {
+        // Likewise, if the distance function can't be compiled to dual
+        // numbers, then dist_grad_batch returns false, and the caller
+        // computes gradients using finite differences.
+        try {
+            cpp_.define_dual_function("dist", SC_Type::Num(4),
+                SC_Type::Num(), shape.dist_fun_, cx);
+            cpp_.define_dist_grad_batch("dist_grad_batch", "dist");
+        } catch (Exception& e) {
+            if (rshape.sstate_.system_.verbose_)
+                rshape.sstate_.system_.warning(e);
+            cpp_.clear_dual_functions();
+        }
+    }
     cpp_.compile(cx);
-    dist_ = (Cpp_Dist_Func) cpp_.get_function("dist");
-    colour_ = (Cpp_Colour_Func) cpp_.get_function("colour");
+    dist_batch_ = (Cpp_Dist_Batch_Func) cpp_.get_function("dist_batch_params");
+    colour_batch_ =
+        (Cpp_Colour_Batch_Func) cpp_.get_function("colour_batch_params");
+    if (cpp_.has_interval_functions()) {
+        dist_interval_ =
+            (Cpp_Dist_Interval_Func) cpp_.get_function("dist_interval_params");
+    }
+    if (cpp_.has_dual_functions()) {
+        dist_grad_batch_ =
+            (Cpp_Dist_Grad_Batch_Func) cpp_.get_function("dist_grad_batch_params");
+    }
+}
+
+bool
+Compiled_Shape::set_parameters(const Shape_Program& shape)
+{
+    static Symbol_Ref argument_key = make_symbol("argument");
+    if (argument_ == nullptr)
+        return false;
+    At_Program cx{shape};
+    auto argument = shape.record_->getfield(argument_key, cx).to<Record>(cx);
+
+    // The parameters without pickers are compiled into the code.
+    bool same = true;
+    argument_->each_field(cx, [&](Symbol_Ref name, Value val) -> void {
+        if (vshape_.param_.find(name.c_str()) == vshape_.param_.end()
+            && (!argument->hasfield(name)
+                || argument->getfield(name, cx).equal(val, cx)
+                   != Ternary::True))
+        {
+            same = false;
+        }
+    });
+    if (!same)
+        return false;
+
+    // Build the new parameter block before replacing the old one, so that
+    // the shape is unchanged if a parameter value has the wrong type.
+    std::vector<float> block;
+    block.reserve(params_.size());
+    for (auto& p : vshape_.param_) {
+        Value val = argument->getfield(make_symbol(p.first), cx);
+        Picker::State state(p.second.pconfig_.type_, val, cx);
+        switch (p.second.pconfig_.type_) {
+        case Picker::Type::checkbox:
+            block.push_back(state.bool_);
+            break;
+        case Picker::Type::int_slider:
+            block.push_back(state.int_);
+            break;
+        case Picker::Type::slider:
+        case Picker::Type::scale_picker:
+            block.push_back(state.num_);
+            break;
+        case Picker::Type::colour_picker:
+            for (int i = 0; i < 3; ++i)
+                block.push_back(state.vec3_[i]);
+            break;
+        }
+    }
+    if (block.size() != params_.size()) {
+        throw Exception(cx, stringify("parameter block has ", block.size(),
+            " values, expected ", params_.size()));
+    }
+    params_.swap(block);
+    is_2d_ = shape.is_2d_;
+    is_3d_ = shape.is_3d_;
+    bbox_ = shape.bbox_;
+    return true;
 }
 
 void
@@ -40,6 +177,8 @@ export_cpp(Shape_Program& shape, std::ostream& out)
         shape.dist_fun_, cx);
     sc.define_function("colour", SC_Type::Num(4), SC_Type::Num(3),
         shape.colour_fun_, cx);
+    define_dist_batch(sc, "dist_batch", "dist");
+    define_colour_batch(sc, "colour_batch", "colour");
     sc.emit_objects(out);
 }
 
@@ -7,38 +7,108 @@
 
 #include <libcurv/io/cpp_program.h>
 #include <libcurv/shape.h>
+#include <libcurv/viewed_shape.h>
 #include <ostream>
-#include <glm/vec3.hpp>
-#include <glm/vec4.hpp>
+#include <vector>
 
 namespace curv { namespace io {
 
+// The `_params` entry points of a compiled shape (see define_dist_batch).
 extern "C" {
-    typedef void (*Cpp_Dist_Func)(const glm::vec4* in, float* out);
-    typedef void (*Cpp_Colour_Func)(const glm::vec4* in, glm::vec3* out);
+    typedef void (*Cpp_Dist_Batch_Func)(
+        const float* xs, const float* ys, const float* zs, float t,
+        const float* params, float* out, size_t n);
+    typedef void (*Cpp_Colour_Batch_Func)(
+        const float* xs, const float* ys, const float* zs, float t,
+        const float* params, float* out, size_t n);
+    typedef void (*Cpp_Dist_Interval_Func)(
+        const double* lo, const double* hi, double t,
+        const float* params, double* out);
+    typedef void (*Cpp_Dist_Grad_Batch_Func)(
+        const float* xs, const float* ys, const float* zs, float t,
+        const float* params, float* out, size_t n);
 }
 
+// A shape whose dist and colour functions are compiled to C++.
+//
+// If the shape is parametric (see Viewed_Shape), then the parameters that
+// have pickers are passed to the compiled code at run time, in a parameter
+// block. Use set_parameters() to evaluate a different instance of the shape,
+// without running the C++ compiler again. If the parametric version of the
+// shape can't be compiled, then the parameter values are compiled into the
+// code instead, and the parameter block is empty.
 struct Compiled_Shape final : public Shape
 {
     Cpp_Program cpp_;
-    Cpp_Dist_Func dist_;
-    Cpp_Colour_Func colour_;
+    Cpp_Dist_Batch_Func dist_batch_;
+    Cpp_Colour_Batch_Func colour_batch_;
+    Cpp_Dist_Interval_Func dist_interval_ = nullptr;
+    Cpp_Dist_Grad_Batch_Func dist_grad_batch_ = nullptr;
 
-    Compiled_Shape(Shape_Program&);
+    // The parameters of a parametric shape. The parameter block contains
+    // the values of the parameters in vshape_.param_, in order.
+    Viewed_Shape vshape_;
+    std::vector<float> params_;
+    Shared<const Record> argument_;
+
+    // If `interval` is true, then an interval arithmetic version of the
+    // distance function is also compiled, and used by dist_interval, if
+    // the distance function can be compiled to interval arithmetic.
+    // If `gradient` is true, then a dual number version of the distance
+    // function is also compiled, and used by dist_grad_batch, if the
+    // distance function can be compiled to dual numbers.
+    Compiled_Shape(const Shape_Program&,
+        bool interval = false, bool gradient = false);
+
+    // Switch to another instance of the same parametric shape, which was
+    // constructed by calling the shape's `call` function. Only the parameters
+    // with pickers are passed at run time. Return false if a parameter
+    // without a picker differs, in which case the shape must be recompiled.
+    // Throws if a parameter value has the wrong type, leaving the shape
+    // unchanged.
+    bool set_parameters(const Shape_Program&);
 
     virtual double dist(double x, double y, double z, double t) const override
     {
-        glm::vec4 in{x,y,z,t};
-        float out;
-        dist_(&in, &out);
+        float fx = x, fy = y, fz = z, out;
+        dist_batch_(&fx, &fy, &fz, t, params_.data(), &out, 1);
         return out;
     }
     virtual Vec3 colour(double x, double y, double z, double t) const override
     {
-        glm::vec4 in{x,y,z,t};
-        glm::vec3 out;
-        colour_(&in, &out);
-        return Vec3{out.x,out.y,out.z};
+        float fx = x, fy = y, fz = z, out[3];
+        colour_batch_(&fx, &fy, &fz, t, params_.data(), out, 1);
+        return Vec3{out[0],out[1],out[2]};
+    }
+    virtual void dist_batch(
+        const float* xs, const float* ys, const float* zs, float t,
+        float* out, size_t n) const override
+    {
+        dist_batch_(xs, ys, zs, t, params_.data(), out, n);
+    }
+    virtual void colour_batch(
+        const float* xs, const float* ys, const float* zs, float t,
+        float* out, size_t n) const override
+    {
+        colour_batch_(xs, ys, zs, t, params_.data(), out, n);
+    }
+    virtual void dist_interval(
+        const double* lo, const double* hi, double t, double* out)
+        const override
+    {
+        if (dist_interval_)
+            dist_interval_(lo, hi, t, params_.data(), out);
+        else
+            Shape::dist_interval(lo, hi, t, out);
+    }
+    virtual bool dist_grad_batch(
+        const float* xs, const float* ys, const float* zs, float t,
+        float* out, size_t n) const override
+    {
+        if (!dist_grad_batch_)
+            return false;
+        dist_grad_batch_(xs, ys, zs, t, params_.data(), out, n);
+        return true;
     }
 };
 
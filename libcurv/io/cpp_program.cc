@@ -17,13 +17,21 @@
     }
 #endif
 
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
 
 // TODO: Add Windows support by means of LoadLibrary() and friends
 
 namespace curv { namespace io {
 
 const char Cpp_Program::standard_header[] =
+    "#include <cstddef>\n"
     "#include <glm/common.hpp>\n"
     "#include <glm/matrix.hpp>\n"
     "#include <glm/geometric.hpp>\n"
@@ -31,15 +39,844 @@ const char Cpp_Program::standard_header[] =
     "#include <glm/exponential.hpp>\n"
     "\n"
     "using namespace glm;\n"
+    "\n"
+    "// The parameter block of a parametric shape, which is passed to each\n"
+    "// function (see SC_Uniform_Variable). The interval and dual number\n"
+    "// code redefines float, but the parameter block is still floats.\n"
+    "typedef const float* Curv_Params;\n"
     "\n";
 
+// The prelude for interval code (SC_Target::interval). It is followed by
+// vector_header, then by the interval functions, then by a '}' that closes
+// the namespace.
+//
+// An Ival is an interval of real numbers [lo,hi], computed in double
+// precision with outward rounding, so that the exact result of each
+// operation lies within the interval. An Ibool is a boolean that may be
+// ambiguous (both true and false are possible). Ival and Ibool replace
+// float and bool; vec2..4, bvec2..4 and mat2..4 are redefined to contain
+// them, and the GLSL functions used by SubCurv are redefined to bound
+// their results. An `if` expression or `select` with an ambiguous condition
+// returns the hull of both results. Control flow (if statements, loops,
+// array indexes) that depends on an ambiguous value throws Ambiguous.
+const char Cpp_Program::interval_header[] = R"CURV(
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace curv_interval {
+
+// Thrown when a branch or array index depends on an ambiguous value.
+// The entry point catches this and returns [-inf,inf].
+struct Ambiguous {};
+
+static const double PI = 3.14159265358979323846;
+inline double dn(double x) { return std::nextafter(x, -INFINITY); }
+inline double up(double x) { return std::nextafter(x, INFINITY); }
+
+// A boolean whose value may be unknown: t means "can be true",
+// f means "can be false".
+struct Ibool
+{
+    bool t, f;
+    Ibool() : t(false), f(true) {}
+    Ibool(bool b) : t(b), f(!b) {}
+    Ibool(bool t_, bool f_) : t(t_), f(f_) {}
+    explicit operator bool() const
+    {
+        if (t == f) throw Ambiguous{};
+        return t;
+    }
+    explicit operator int() const { return int(bool(*this)); }
+};
+inline Ibool operator!(Ibool a) { return {a.f, a.t}; }
+inline Ibool operator&&(Ibool a, Ibool b) { return {a.t&&b.t, a.f||b.f}; }
+inline Ibool operator||(Ibool a, Ibool b) { return {a.t||b.t, a.f&&b.f}; }
+inline Ibool operator==(Ibool a, Ibool b)
+  { return {(a.t&&b.t)||(a.f&&b.f), (a.t&&b.f)||(a.f&&b.t)}; }
+inline Ibool operator!=(Ibool a, Ibool b) { return !(a == b); }
+
+// A closed interval of real numbers [lo,hi], which replaces float.
+struct Ival
+{
+    double lo, hi;
+    Ival() : lo(0), hi(0) {}
+    Ival(double x) : lo(x), hi(x) {}
+    Ival(double l, double h) : lo(l), hi(h) {}
+    explicit Ival(Ibool b) : lo(b.f ? 0 : 1), hi(b.t ? 1 : 0) {}
+    explicit operator int() const
+    {
+        if (!(std::trunc(lo) == std::trunc(hi))) throw Ambiguous{};
+        return int(lo);
+    }
+};
+inline Ival full() { return {-INFINITY, INFINITY}; }
+inline Ival hull(Ival a, Ival b)
+  { return {std::min(a.lo,b.lo), std::max(a.hi,b.hi)}; }
+inline Ibool hull(Ibool a, Ibool b) { return {a.t||b.t, a.f||b.f}; }
+template <class T> T hull(const T& a, const T& b)
+{
+    if (a == b) return a;
+    throw Ambiguous{};
+}
+
+// Bounds of the exact result of a floating point operation, which is
+// computed from the rounded result and its rounding error.
+inline double lo_of(double r, double err) { return err < 0 ? dn(r) : r; }
+inline double hi_of(double r, double err) { return err > 0 ? up(r) : r; }
+inline double add_err(double a, double b, double s)
+{
+    if (!std::isfinite(s)) return 0;
+    double bb = s - a;
+    return (a - (s - bb)) + (b - bb);
+}
+inline double add_lo(double a, double b)
+  { double s = a + b; return lo_of(s, add_err(a, b, s)); }
+inline double add_hi(double a, double b)
+  { double s = a + b; return hi_of(s, add_err(a, b, s)); }
+inline double mul_err(double a, double b, double p)
+  { return std::isfinite(p) ? std::fma(a, b, -p) : 0; }
+// In interval arithmetic, 0 * inf is 0.
+inline double mul_lo(double a, double b)
+{
+    if (a == 0 || b == 0) return 0;
+    double p = a * b; return lo_of(p, mul_err(a, b, p));
+}
+inline double mul_hi(double a, double b)
+{
+    if (a == 0 || b == 0) return 0;
+    double p = a * b; return hi_of(p, mul_err(a, b, p));
+}
+inline double div_err(double a, double b, double q)
+{
+    if (!std::isfinite(q) || !std::isfinite(b)) return q == 0 ? 0 : NAN;
+    return std::fma(-q, b, a) * (b < 0 ? -1 : 1);
+}
+inline double div_lo(double a, double b)
+{
+    double q = a / b, e = div_err(a, b, q);
+    return e == e ? lo_of(q, e) : dn(q);
+}
+inline double div_hi(double a, double b)
+{
+    double q = a / b, e = div_err(a, b, q);
+    return e == e ? hi_of(q, e) : up(q);
+}
+
+inline Ival operator+(Ival a) { return a; }
+inline Ival operator-(Ival a) { return {-a.hi, -a.lo}; }
+inline Ival operator+(Ival a, Ival b)
+  { return {add_lo(a.lo, b.lo), add_hi(a.hi, b.hi)}; }
+inline Ival operator-(Ival a, Ival b)
+  { return {add_lo(a.lo, -b.hi), add_hi(a.hi, -b.lo)}; }
+inline Ival operator*(Ival a, Ival b)
+{
+    return {std::min({mul_lo(a.lo,b.lo), mul_lo(a.lo,b.hi),
+                      mul_lo(a.hi,b.lo), mul_lo(a.hi,b.hi)}),
+            std::max({mul_hi(a.lo,b.lo), mul_hi(a.lo,b.hi),
+                      mul_hi(a.hi,b.lo), mul_hi(a.hi,b.hi)})};
+}
+inline Ival operator/(Ival a, Ival b)
+{
+    if (b.lo <= 0 && b.hi >= 0) return full();
+    double l = std::min({div_lo(a.lo,b.lo), div_lo(a.lo,b.hi),
+                         div_lo(a.hi,b.lo), div_lo(a.hi,b.hi)});
+    double h = std::max({div_hi(a.lo,b.lo), div_hi(a.lo,b.hi),
+                         div_hi(a.hi,b.lo), div_hi(a.hi,b.hi)});
+    if (l != l || h != h) return full();
+    return {l, h};
+}
+inline Ival& operator+=(Ival& a, Ival b) { return a = a + b; }
+inline Ival& operator-=(Ival& a, Ival b) { return a = a - b; }
+inline Ival& operator*=(Ival& a, Ival b) { return a = a * b; }
+inline Ival& operator/=(Ival& a, Ival b) { return a = a / b; }
+
+inline Ibool operator<(Ival a, Ival b) { return {a.lo < b.hi, a.hi >= b.lo}; }
+inline Ibool operator<=(Ival a, Ival b) { return {a.lo <= b.hi, a.hi > b.lo}; }
+inline Ibool operator>(Ival a, Ival b) { return b < a; }
+inline Ibool operator>=(Ival a, Ival b) { return b <= a; }
+inline Ibool operator==(Ival a, Ival b)
+{
+    return {a.lo <= b.hi && b.lo <= a.hi,
+            !(a.lo == a.hi && b.lo == b.hi && a.lo == b.lo)};
+}
+inline Ibool operator!=(Ival a, Ival b) { return !(a == b); }
+
+// Monotonic functions, and functions that are widened by one ulp
+// to allow for the error in the C library.
+inline Ival incr(double (*f)(double), Ival a)
+  { return {dn(f(a.lo)), up(f(a.hi))}; }
+inline Ival decr(double (*f)(double), Ival a)
+  { return {dn(f(a.hi)), up(f(a.lo))}; }
+inline Ival clip(Ival a, double l, double h)
+  { return {std::max(a.lo, l), std::min(a.hi, h)}; }
+inline double sign_(double x) { return x > 0 ? 1 : x < 0 ? -1 : 0; }
+inline double fract_(double x) { return x - std::floor(x); }
+inline double roundEven_(double x) { return std::nearbyint(x); }
+
+inline Ival abs(Ival a)
+{
+    if (a.lo >= 0) return a;
+    if (a.hi <= 0) return -a;
+    return {0, std::max(-a.lo, a.hi)};
+}
+inline Ival sqr(Ival a)
+{
+    Ival b = abs(a);
+    return {mul_lo(b.lo, b.lo), mul_hi(b.hi, b.hi)};
+}
+inline Ival min(Ival a, Ival b)
+  { return {std::min(a.lo,b.lo), std::min(a.hi,b.hi)}; }
+inline Ival max(Ival a, Ival b)
+  { return {std::max(a.lo,b.lo), std::max(a.hi,b.hi)}; }
+inline Ival floor(Ival a) { return {std::floor(a.lo), std::floor(a.hi)}; }
+inline Ival ceil(Ival a) { return {std::ceil(a.lo), std::ceil(a.hi)}; }
+inline Ival trunc(Ival a) { return {std::trunc(a.lo), std::trunc(a.hi)}; }
+inline Ival roundEven(Ival a) { return {roundEven_(a.lo), roundEven_(a.hi)}; }
+inline Ival sign(Ival a) { return {sign_(a.lo), sign_(a.hi)}; }
+inline Ival fract(Ival a)
+{
+    if (std::floor(a.lo) == std::floor(a.hi))
+        return {fract_(a.lo), fract_(a.hi)};
+    return {0, 1};
+}
+inline Ival sqrt(Ival a)
+{
+    if (a.hi < 0) return {NAN, NAN};
+    double l = std::sqrt(std::max(a.lo, 0.0)), h = std::sqrt(a.hi);
+    return {lo_of(l, mul_err(l, l, std::max(a.lo, 0.0)) > 0 ? -1 : 0),
+            hi_of(h, mul_err(h, h, a.hi) < 0 ? 1 : 0)};
+}
+inline Ival exp(Ival a) { return clip(incr(std::exp, a), 0, INFINITY); }
+inline Ival exp2(Ival a) { return clip(incr(std::exp2, a), 0, INFINITY); }
+inline Ival log(Ival a)
+{
+    if (a.hi < 0) return {NAN, NAN};
+    return incr(std::log, clip(a, 0, INFINITY));
+}
+inline Ival log2(Ival a)
+{
+    if (a.hi < 0) return {NAN, NAN};
+    return incr(std::log2, clip(a, 0, INFINITY));
+}
+inline Ival pow(Ival a, Ival b)
+{
+    if (b.lo == b.hi && b.lo == std::floor(b.lo) && std::abs(b.lo) < 1e9) {
+        // integer exponent
+        double n = b.lo;
+        if (n == 0) return 1.0;
+        Ival base = n < 0 ? 1.0 / a : a;
+        double m = std::abs(n);
+        auto p = [&](double x) { return std::pow(x, m); };
+        if (std::fmod(m, 2) == 1)
+            return {dn(p(base.lo)), up(p(base.hi))};
+        Ival b2 = abs(base);
+        return {dn(p(b2.lo)), up(p(b2.hi))};
+    }
+    if (a.lo < 0) return full();
+    // For a >= 0, pow is monotonic in each argument,
+    // so the bounds are found at the corners.
+    double c[4] = {std::pow(a.lo,b.lo), std::pow(a.lo,b.hi),
+                   std::pow(a.hi,b.lo), std::pow(a.hi,b.hi)};
+    for (double x : c) if (x != x) return full();
+    return {dn(std::min({c[0],c[1],c[2],c[3]})),
+            up(std::max({c[0],c[1],c[2],c[3]}))};
+}
+
+// Does [a.lo,a.hi] contain phase + k*period for some integer k?
+inline bool contains_phase(Ival a, double phase, double period)
+{
+    double tol = 1e-12 * (1 + std::abs(a.lo) + std::abs(a.hi));
+    double k = std::ceil((a.lo - tol - phase) / period);
+    return phase + k * period <= a.hi + tol;
+}
+// sin or cos, which have maxima at max_phase + 2k*PI
+// and minima at max_phase + PI + 2k*PI.
+inline Ival periodic(double (*f)(double), Ival a, double max_phase)
+{
+    if (!(a.hi - a.lo < 2*PI)) return {-1, 1};
+    double x = f(a.lo), y = f(a.hi);
+    double l = dn(std::min(x, y)), h = up(std::max(x, y));
+    if (contains_phase(a, max_phase, 2*PI)) h = 1;
+    if (contains_phase(a, max_phase + PI, 2*PI)) l = -1;
+    return {std::max(l, -1.0), std::min(h, 1.0)};
+}
+inline Ival sin(Ival a) { return periodic(std::sin, a, PI/2); }
+inline Ival cos(Ival a) { return periodic(std::cos, a, 0); }
+inline Ival tan(Ival a)
+{
+    if (!(a.hi - a.lo < PI) || contains_phase(a, PI/2, PI)) return full();
+    return incr(std::tan, a);
+}
+inline Ival asin(Ival a)
+{
+    if (a.lo > 1 || a.hi < -1) return {NAN, NAN};
+    return clip(incr(std::asin, clip(a, -1, 1)), -PI/2, PI/2);
+}
+inline Ival acos(Ival a)
+{
+    if (a.lo > 1 || a.hi < -1) return {NAN, NAN};
+    return clip(decr(std::acos, clip(a, -1, 1)), 0, PI);
+}
+inline Ival atan(Ival a) { return clip(incr(std::atan, a), -PI/2, PI/2); }
+inline Ival atan(Ival y, Ival x)
+{
+    // The range is [-PI,PI], unless the box excludes the origin and
+    // the branch cut along the negative x axis. Then the extrema
+    // are found at the corners.
+    if (x.lo <= 0 && y.lo <= 0 && y.hi >= 0) return {-PI, PI};
+    double c[4] = {std::atan2(y.lo,x.lo), std::atan2(y.lo,x.hi),
+                   std::atan2(y.hi,x.lo), std::atan2(y.hi,x.hi)};
+    return clip({dn(std::min({c[0],c[1],c[2],c[3]})),
+                 up(std::max({c[0],c[1],c[2],c[3]}))}, -PI, PI);
+}
+inline Ival sinh(Ival a) { return incr(std::sinh, a); }
+inline Ival cosh(Ival a)
+  { return clip(incr(std::cosh, abs(a)), 1, INFINITY); }
+inline Ival tanh(Ival a) { return clip(incr(std::tanh, a), -1, 1); }
+inline Ival asinh(Ival a) { return incr(std::asinh, a); }
+inline Ival acosh(Ival a)
+{
+    if (a.hi < 1) return {NAN, NAN};
+    return clip(incr(std::acosh, clip(a, 1, INFINITY)), 0, INFINITY);
+}
+inline Ival atanh(Ival a)
+{
+    if (a.lo > 1 || a.hi < -1) return {NAN, NAN};
+    return incr(std::atanh, clip(a, -1, 1));
+}
+inline Ival uintBitsToFloat(unsigned u)
+{
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return double(f);
+}
+inline unsigned floatBitsToUint(Ival a)
+{
+    if (a.lo != a.hi) throw Ambiguous{};
+    float f = float(a.lo);
+    unsigned u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+// If the condition is ambiguous, the result is the hull of both values.
+template <class T> T select(Ibool c, const T& a, const T& b)
+{
+    if (c.t && !c.f) return a;
+    if (c.f && !c.t) return b;
+    return hull(a, b);
+}
+
+typedef Ival Real;
+typedef Ibool Boolean;
+)CURV";
+
+// The vector and matrix types used by interval code and dual number code.
+// This follows interval_header or dual_header, which define the scalar
+// types Real and Boolean (which replace float and bool), the GLSL functions
+// on Real, and the scalar versions of `select`, `hull` and `sqr`.
+const char Cpp_Program::vector_header[] = R"CURV(
+// Vectors of Real and Boolean, which replace vec2..vec4 and bvec2..bvec4.
+template <class T, int N> struct Vec;
+template <class T> struct Vec<T,2>
+{
+    T x, y;
+    Vec() {}
+    explicit Vec(T a) : x(a), y(a) {}
+    Vec(T a, T b) : x(a), y(b) {}
+    template <class U> explicit Vec(const Vec<U,2>& v) : x(T(v.x)), y(T(v.y))
+    {}
+    T& operator[](int i) { return i == 0 ? x : y; }
+    const T& operator[](int i) const { return i == 0 ? x : y; }
+};
+template <class T> struct Vec<T,3>
+{
+    T x, y, z;
+    Vec() {}
+    explicit Vec(T a) : x(a), y(a), z(a) {}
+    Vec(T a, T b, T c) : x(a), y(b), z(c) {}
+    template <class U> explicit Vec(const Vec<U,3>& v)
+      : x(T(v.x)), y(T(v.y)), z(T(v.z)) {}
+    T& operator[](int i) { return i == 0 ? x : i == 1 ? y : z; }
+    const T& operator[](int i) const { return i == 0 ? x : i == 1 ? y : z; }
+};
+template <class T> struct Vec<T,4>
+{
+    T x, y, z, w;
+    Vec() {}
+    explicit Vec(T a) : x(a), y(a), z(a), w(a) {}
+    Vec(T a, T b, T c, T d) : x(a), y(b), z(c), w(d) {}
+    template <class U> explicit Vec(const Vec<U,4>& v)
+      : x(T(v.x)), y(T(v.y)), z(T(v.z)), w(T(v.w)) {}
+    T& operator[](int i) { return i == 0 ? x : i == 1 ? y : i == 2 ? z : w; }
+    const T& operator[](int i) const
+      { return i == 0 ? x : i == 1 ? y : i == 2 ? z : w; }
+};
+typedef Vec<Real,2> vec2;
+typedef Vec<Real,3> vec3;
+typedef Vec<Real,4> vec4;
+typedef Vec<Boolean,2> bvec2;
+typedef Vec<Boolean,3> bvec3;
+typedef Vec<Boolean,4> bvec4;
+
+// Scalar versions of the vector relational functions. These are declared
+// before the elementwise templates, since Boolean may be bool, which
+// doesn't have an associated namespace.
+inline Boolean not_(Boolean a) { return !a; }
+inline Boolean lessThan(Real a, Real b) { return a < b; }
+inline Boolean lessThanEqual(Real a, Real b) { return a <= b; }
+inline Boolean greaterThan(Real a, Real b) { return a > b; }
+inline Boolean greaterThanEqual(Real a, Real b) { return a >= b; }
+inline Boolean notEqual(Real a, Real b) { return a != b; }
+inline Boolean notEqual(Boolean a, Boolean b) { return a != b; }
+
+#define CURV_VEC_UNARY(R, f) \
+template <class T, int N> Vec<R,N> f(const Vec<T,N>& a) \
+  { Vec<R,N> r; for (int i = 0; i < N; ++i) r[i] = f(a[i]); return r; }
+#define CURV_VEC_BINARY(R, f) \
+template <class T, int N> Vec<R,N> f(const Vec<T,N>& a, const Vec<T,N>& b) \
+  { Vec<R,N> r; for (int i = 0; i < N; ++i) r[i] = f(a[i],b[i]); return r; }
+#define CURV_VEC_OP(op) \
+template <int N> Vec<Real,N> operator op(const Vec<Real,N>& a, \
+    const Vec<Real,N>& b) \
+  { Vec<Real,N> r; for (int i = 0; i < N; ++i) r[i] = a[i] op b[i]; \
+    return r; } \
+template <int N> Vec<Real,N> operator op(const Vec<Real,N>& a, Real b) \
+  { return a op Vec<Real,N>(b); } \
+template <int N> Vec<Real,N> operator op(Real a, const Vec<Real,N>& b) \
+  { return Vec<Real,N>(a) op b; } \
+template <int N> Vec<Real,N>& operator op##=(Vec<Real,N>& a, \
+    const Vec<Real,N>& b) \
+  { return a = a op b; }
+CURV_VEC_OP(+)
+CURV_VEC_OP(-)
+CURV_VEC_OP(*)
+CURV_VEC_OP(/)
+CURV_VEC_UNARY(Real, operator-)
+CURV_VEC_UNARY(Real, operator+)
+CURV_VEC_UNARY(Real, abs)
+CURV_VEC_UNARY(Real, floor)
+CURV_VEC_UNARY(Real, ceil)
+CURV_VEC_UNARY(Real, trunc)
+CURV_VEC_UNARY(Real, roundEven)
+CURV_VEC_UNARY(Real, sign)
+CURV_VEC_UNARY(Real, fract)
+CURV_VEC_UNARY(Real, sqrt)
+CURV_VEC_UNARY(Real, exp)
+CURV_VEC_UNARY(Real, exp2)
+CURV_VEC_UNARY(Real, log)
+CURV_VEC_UNARY(Real, log2)
+CURV_VEC_UNARY(Real, sin)
+CURV_VEC_UNARY(Real, cos)
+CURV_VEC_UNARY(Real, tan)
+CURV_VEC_UNARY(Real, asin)
+CURV_VEC_UNARY(Real, acos)
+CURV_VEC_UNARY(Real, atan)
+CURV_VEC_UNARY(Real, sinh)
+CURV_VEC_UNARY(Real, cosh)
+CURV_VEC_UNARY(Real, tanh)
+CURV_VEC_UNARY(Real, asinh)
+CURV_VEC_UNARY(Real, acosh)
+CURV_VEC_UNARY(Real, atanh)
+CURV_VEC_UNARY(Boolean, not_)
+CURV_VEC_BINARY(Real, min)
+CURV_VEC_BINARY(Real, max)
+CURV_VEC_BINARY(Real, pow)
+CURV_VEC_BINARY(Real, atan)
+CURV_VEC_BINARY(Boolean, lessThan)
+CURV_VEC_BINARY(Boolean, lessThanEqual)
+CURV_VEC_BINARY(Boolean, greaterThan)
+CURV_VEC_BINARY(Boolean, greaterThanEqual)
+CURV_VEC_BINARY(Boolean, notEqual)
+CURV_VEC_BINARY(T, hull)
+template <class T, int N>
+Boolean operator==(const Vec<T,N>& a, const Vec<T,N>& b)
+{
+    Boolean r = true;
+    for (int i = 0; i < N; ++i) r = r && a[i] == b[i];
+    return r;
+}
+template <class T, int N>
+Boolean operator!=(const Vec<T,N>& a, const Vec<T,N>& b)
+  { return !(a == b); }
+template <class T, int N>
+Vec<T,N> select(const Vec<Boolean,N>& c, const Vec<T,N>& a, const Vec<T,N>& b)
+  { Vec<T,N> r; for (int i = 0; i < N; ++i) r[i] = select(c[i],a[i],b[i]);
+    return r; }
+template <int N> Real dot(const Vec<Real,N>& a, const Vec<Real,N>& b)
+{
+    Real r = 0.0;
+    for (int i = 0; i < N; ++i) r += &a == &b ? sqr(a[i]) : a[i] * b[i];
+    return r;
+}
+template <int N> Real length(const Vec<Real,N>& a) { return sqrt(dot(a, a)); }
+
+// Matrices, stored as N column vectors, which replace mat2..mat4.
+template <int N> struct Mat
+{
+    Vec<Real,N> c[N];
+    Mat() {}
+    template <class... A,
+        typename std::enable_if<sizeof...(A) == N*N, int>::type = 0>
+    Mat(A... a)
+    {
+        Real v[] = {Real(a)...};
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j) c[i][j] = v[i*N + j];
+    }
+    template <class... A,
+        typename std::enable_if<sizeof...(A) == N, int>::type = 0>
+    Mat(const A&... a)
+    {
+        Vec<Real,N> v[] = {a...};
+        for (int i = 0; i < N; ++i) c[i] = v[i];
+    }
+    Vec<Real,N>& operator[](int i) { return c[i]; }
+    const Vec<Real,N>& operator[](int i) const { return c[i]; }
+};
+typedef Mat<2> mat2;
+typedef Mat<3> mat3;
+typedef Mat<4> mat4;
+
+#define CURV_MAT_OP(op) \
+template <int N> Mat<N> operator op(const Mat<N>& a, const Mat<N>& b) \
+  { Mat<N> r; for (int i = 0; i < N; ++i) r[i] = a[i] op b[i]; return r; }
+CURV_MAT_OP(+)
+CURV_MAT_OP(-)
+CURV_MAT_OP(/)
+template <int N> Mat<N> matrixCompMult(const Mat<N>& a, const Mat<N>& b)
+  { Mat<N> r; for (int i = 0; i < N; ++i) r[i] = a[i] * b[i]; return r; }
+template <int N> Mat<N> operator-(const Mat<N>& a)
+  { Mat<N> r; for (int i = 0; i < N; ++i) r[i] = -a[i]; return r; }
+template <int N> Mat<N> operator+(const Mat<N>& a) { return a; }
+template <int N> Vec<Real,N> operator*(const Mat<N>& m, const Vec<Real,N>& v)
+{
+    Vec<Real,N> r(Real(0.0));
+    for (int j = 0; j < N; ++j) r = r + m[j] * v[j];
+    return r;
+}
+template <int N> Vec<Real,N> operator*(const Vec<Real,N>& v, const Mat<N>& m)
+  { Vec<Real,N> r; for (int i = 0; i < N; ++i) r[i] = dot(v, m[i]);
+    return r; }
+template <int N> Mat<N> operator*(const Mat<N>& a, const Mat<N>& b)
+  { Mat<N> r; for (int i = 0; i < N; ++i) r[i] = a * b[i]; return r; }
+template <int N> Boolean operator==(const Mat<N>& a, const Mat<N>& b)
+{
+    Boolean r = true;
+    for (int i = 0; i < N; ++i) r = r && a[i] == b[i];
+    return r;
+}
+template <int N> Boolean operator!=(const Mat<N>& a, const Mat<N>& b)
+  { return !(a == b); }
+template <int N> Mat<N> hull(const Mat<N>& a, const Mat<N>& b)
+  { Mat<N> r; for (int i = 0; i < N; ++i) r[i] = hull(a[i], b[i]);
+    return r; }
+template <int N, class U>
+Vec<Real,N> uintBitsToFloat(const glm::vec<N,U>& u)
+{
+    Vec<Real,N> r;
+    for (int i = 0; i < N; ++i) r[i] = uintBitsToFloat(u[i]);
+    return r;
+}
+template <int N>
+glm::vec<N,glm::uint> floatBitsToUint(const Vec<Real,N>& a)
+{
+    glm::vec<N,glm::uint> r;
+    for (int i = 0; i < N; ++i) r[i] = floatBitsToUint(a[i]);
+    return r;
+}
+)CURV";
+
+// The prelude for dual number code (SC_Target::dual). It is followed by
+// vector_header, then by the dual functions, then by a '}' that closes
+// the namespace.
+//
+// A Dual is a number together with its partial derivatives with respect
+// to x, y and z, which replaces float. Evaluating a distance function with
+// the point (Dual(x,1,0,0), Dual(y,0,1,0), Dual(z,0,0,1), t) computes the
+// distance and its gradient in one pass (forward mode automatic
+// differentiation). Comparisons, `select` and `if` use the value, and
+// ignore the derivatives, so the gradient of a piecewise function is the
+// gradient of the piece that is selected. Where a function is not
+// differentiable (eg, sqrt(0)), the derivative is 0.
+const char Cpp_Program::dual_header[] = R"CURV(
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace curv_dual {
+
+struct Dual
+{
+    float v, dx, dy, dz;
+    Dual() : v(0), dx(0), dy(0), dz(0) {}
+    Dual(double a) : v(float(a)), dx(0), dy(0), dz(0) {}
+    Dual(float a, float x, float y, float z) : v(a), dx(x), dy(y), dz(z) {}
+    explicit operator int() const { return int(v); }
+};
+
+// The result of a function f applied to a, where f(a.v) = v
+// and the derivative of f at a.v is k.
+inline Dual chain(float v, float k, Dual a)
+  { return {v, k*a.dx, k*a.dy, k*a.dz}; }
+
+inline Dual operator+(Dual a) { return a; }
+inline Dual operator-(Dual a) { return {-a.v, -a.dx, -a.dy, -a.dz}; }
+inline Dual operator+(Dual a, Dual b)
+  { return {a.v+b.v, a.dx+b.dx, a.dy+b.dy, a.dz+b.dz}; }
+inline Dual operator-(Dual a, Dual b)
+  { return {a.v-b.v, a.dx-b.dx, a.dy-b.dy, a.dz-b.dz}; }
+inline Dual operator*(Dual a, Dual b)
+{
+    return {a.v*b.v, a.dx*b.v + a.v*b.dx, a.dy*b.v + a.v*b.dy,
+            a.dz*b.v + a.v*b.dz};
+}
+inline Dual operator/(Dual a, Dual b)
+{
+    float q = a.v / b.v;
+    return {q, (a.dx - q*b.dx)/b.v, (a.dy - q*b.dy)/b.v, (a.dz - q*b.dz)/b.v};
+}
+inline Dual& operator+=(Dual& a, Dual b) { return a = a + b; }
+inline Dual& operator-=(Dual& a, Dual b) { return a = a - b; }
+inline Dual& operator*=(Dual& a, Dual b) { return a = a * b; }
+inline Dual& operator/=(Dual& a, Dual b) { return a = a / b; }
+
+inline bool operator<(Dual a, Dual b) { return a.v < b.v; }
+inline bool operator<=(Dual a, Dual b) { return a.v <= b.v; }
+inline bool operator>(Dual a, Dual b) { return a.v > b.v; }
+inline bool operator>=(Dual a, Dual b) { return a.v >= b.v; }
+inline bool operator==(Dual a, Dual b) { return a.v == b.v; }
+inline bool operator!=(Dual a, Dual b) { return a.v != b.v; }
+
+template <class T> T select(bool c, const T& a, const T& b)
+  { return c ? a : b; }
+inline Dual constant(float v) { return {v, 0, 0, 0}; }
+
+inline Dual abs(Dual a) { return a.v < 0 ? -a : a; }
+inline Dual sqr(Dual a) { return a * a; }
+inline Dual min(Dual a, Dual b) { return b.v < a.v ? b : a; }
+inline Dual max(Dual a, Dual b) { return a.v < b.v ? b : a; }
+inline Dual floor(Dual a) { return constant(std::floor(a.v)); }
+inline Dual ceil(Dual a) { return constant(std::ceil(a.v)); }
+inline Dual trunc(Dual a) { return constant(std::trunc(a.v)); }
+inline Dual roundEven(Dual a) { return constant(std::nearbyint(a.v)); }
+inline Dual sign(Dual a)
+  { return constant(a.v > 0 ? 1.0f : a.v < 0 ? -1.0f : 0.0f); }
+inline Dual fract(Dual a) { return a - floor(a); }
+inline Dual sqrt(Dual a)
+{
+    float r = std::sqrt(a.v);
+    return chain(r, r > 0 ? 0.5f / r : 0.0f, a);
+}
+inline Dual exp(Dual a) { float r = std::exp(a.v); return chain(r, r, a); }
+inline Dual exp2(Dual a)
+  { float r = std::exp2(a.v); return chain(r, r * 0.693147181f, a); }
+inline Dual log(Dual a) { return chain(std::log(a.v), 1 / a.v, a); }
+inline Dual log2(Dual a)
+  { return chain(std::log2(a.v), 1.442695041f / a.v, a); }
+inline Dual pow(Dual a, Dual b)
+{
+    float r = std::pow(a.v, b.v);
+    Dual d = chain(r, b.v == 0 ? 0.0f : b.v * std::pow(a.v, b.v - 1), a);
+    if (a.v > 0 && (b.dx != 0 || b.dy != 0 || b.dz != 0)) {
+        float k = r * std::log(a.v);
+        d.dx += k*b.dx; d.dy += k*b.dy; d.dz += k*b.dz;
+    }
+    return d;
+}
+inline Dual sin(Dual a) { return chain(std::sin(a.v), std::cos(a.v), a); }
+inline Dual cos(Dual a) { return chain(std::cos(a.v), -std::sin(a.v), a); }
+inline Dual tan(Dual a)
+  { float r = std::tan(a.v); return chain(r, 1 + r*r, a); }
+inline Dual asin(Dual a)
+  { return chain(std::asin(a.v), 1 / std::sqrt(1 - a.v*a.v), a); }
+inline Dual acos(Dual a)
+  { return chain(std::acos(a.v), -1 / std::sqrt(1 - a.v*a.v), a); }
+inline Dual atan(Dual a)
+  { return chain(std::atan(a.v), 1 / (1 + a.v*a.v), a); }
+inline Dual atan(Dual y, Dual x)
+{
+    float r2 = x.v*x.v + y.v*y.v;
+    if (r2 == 0) return constant(std::atan2(y.v, x.v));
+    return {std::atan2(y.v, x.v), (x.v*y.dx - y.v*x.dx) / r2,
+            (x.v*y.dy - y.v*x.dy) / r2, (x.v*y.dz - y.v*x.dz) / r2};
+}
+inline Dual sinh(Dual a) { return chain(std::sinh(a.v), std::cosh(a.v), a); }
+inline Dual cosh(Dual a) { return chain(std::cosh(a.v), std::sinh(a.v), a); }
+inline Dual tanh(Dual a)
+  { float r = std::tanh(a.v); return chain(r, 1 - r*r, a); }
+inline Dual asinh(Dual a)
+  { return chain(std::asinh(a.v), 1 / std::sqrt(a.v*a.v + 1), a); }
+inline Dual acosh(Dual a)
+  { return chain(std::acosh(a.v), 1 / std::sqrt(a.v*a.v - 1), a); }
+inline Dual atanh(Dual a)
+  { return chain(std::atanh(a.v), 1 / (1 - a.v*a.v), a); }
+inline Dual uintBitsToFloat(unsigned u)
+{
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return constant(f);
+}
+inline unsigned floatBitsToUint(Dual a)
+{
+    unsigned u;
+    std::memcpy(&u, &a.v, sizeof(u));
+    return u;
+}
+
+typedef Dual Real;
+typedef bool Boolean;
+)CURV";
+
+// A batched version of a function that maps a vec4 point to a float
+// (ncomponents=1) or to a vec3 (ncomponents=3). Results are stored
+// consecutively in `out`, ncomponents floats per point.
+struct Cpp_Batch_Function : public SC_Object
+{
+    Symbol_Ref func_name_;
+    int ncomponents_;
+    Cpp_Batch_Function(Symbol_Ref f, int n) : func_name_(f), ncomponents_(n) {}
+    virtual void emit(SC_Compiler&, Symbol_Ref name, std::ostream& out)
+        const override
+    {
+        out << "extern \"C\" void " << name << "_params(\n"
+            << "  const float* __restrict xs,\n"
+            << "  const float* __restrict ys,\n"
+            << "  const float* __restrict zs,\n"
+            << "  float t, Curv_Params curv_params,\n"
+            << "  float* __restrict out, size_t n)\n"
+            << "{\n"
+            << "  for (size_t i = 0; i < n; ++i) {\n"
+            << "    vec4 p(xs[i], ys[i], zs[i], t);\n";
+        if (ncomponents_ == 1) {
+            out << "    " << func_name_ << "_params(curv_params, &p, &out[i]);\n";
+        } else {
+            out << "    vec3 r;\n"
+                << "    " << func_name_ << "_params(curv_params, &p, &r);\n"
+                << "    out[3*i] = r.x;\n"
+                << "    out[3*i+1] = r.y;\n"
+                << "    out[3*i+2] = r.z;\n";
+        }
+        out << "  }\n"
+            << "}\n"
+            << "extern \"C\" void " << name << "(\n"
+            << "  const float* xs, const float* ys, const float* zs,\n"
+            << "  float t, float* out, size_t n)\n"
+            << "{\n"
+            << "  " << name << "_params(xs, ys, zs, t, nullptr, out, n);\n"
+            << "}\n";
+    }
+};
+
+// Evaluate an interval distance function over a box. This is emitted inside
+// the interval namespace, where vec4 is a vector of intervals.
+struct Cpp_Interval_Function : public SC_Object
+{
+    Symbol_Ref func_name_;
+    Cpp_Interval_Function(Symbol_Ref f) : func_name_(f) {}
+    virtual void emit(SC_Compiler&, Symbol_Ref name, std::ostream& out)
+        const override
+    {
+        out << "extern \"C\" void " << name << "_params(\n"
+            << "  const double* lo, const double* hi, double t,\n"
+            << "  Curv_Params curv_params, double* out)\n"
+            << "{\n"
+            << "  try {\n"
+            << "    vec4 p(Ival(lo[0],hi[0]), Ival(lo[1],hi[1]),"
+                       " Ival(lo[2],hi[2]), Ival(t));\n"
+            << "    Ival d = " << func_name_ << "(curv_params, p);\n"
+            << "    if (!(d.lo <= d.hi)) throw Ambiguous{};\n"
+            << "    out[0] = d.lo;\n"
+            << "    out[1] = d.hi;\n"
+            << "  } catch (Ambiguous&) {\n"
+            << "    out[0] = -INFINITY;\n"
+            << "    out[1] = INFINITY;\n"
+            << "  }\n"
+            << "}\n"
+            << "extern \"C\" void " << name << "(\n"
+            << "  const double* lo, const double* hi, double t, double* out)\n"
+            << "{\n"
+            << "  " << name << "_params(lo, hi, t, nullptr, out);\n"
+            << "}\n";
+    }
+};
+
+void
+define_dist_interval(SC_Compiler& sc, const char* name, const char* dist_name)
+{
+    sc.push_object(make_symbol(name),
+        make<Cpp_Interval_Function>(make_symbol(dist_name)));
+}
+
+// Evaluate a dual number distance function over a batch of points,
+// storing the distance and its gradient. This is emitted inside the
+// dual number namespace.
+struct Cpp_Grad_Batch_Function : public SC_Object
+{
+    Symbol_Ref func_name_;
+    Cpp_Grad_Batch_Function(Symbol_Ref f) : func_name_(f) {}
+    virtual void emit(SC_Compiler&, Symbol_Ref name, std::ostream& out)
+        const override
+    {
+        out << "extern \"C\" void " << name << "_params(\n"
+            << "  const float* __restrict xs,\n"
+            << "  const float* __restrict ys,\n"
+            << "  const float* __restrict zs,\n"
+            << "  float t, Curv_Params curv_params,\n"
+            << "  float* __restrict out, size_t n)\n"
+            << "{\n"
+            << "  for (size_t i = 0; i < n; ++i) {\n"
+            << "    vec4 p(Dual(xs[i],1,0,0), Dual(ys[i],0,1,0),"
+                       " Dual(zs[i],0,0,1), Dual(t));\n"
+            << "    Dual d = " << func_name_ << "(curv_params, p);\n"
+            << "    out[4*i] = d.v;\n"
+            << "    out[4*i+1] = d.dx;\n"
+            << "    out[4*i+2] = d.dy;\n"
+            << "    out[4*i+3] = d.dz;\n"
+            << "  }\n"
+            << "}\n"
+            << "extern \"C\" void " << name << "(\n"
+            << "  const float* xs, const float* ys, const float* zs,\n"
+            << "  float t, float* out, size_t n)\n"
+            << "{\n"
+            << "  " << name << "_params(xs, ys, zs, t, nullptr, out, n);\n"
+            << "}\n";
+    }
+};
+
+void
+define_dist_grad_batch(
+    SC_Compiler& sc, const char* name, const char* dist_name)
+{
+    sc.push_object(make_symbol(name),
+        make<Cpp_Grad_Batch_Function>(make_symbol(dist_name)));
+}
+
+void
+define_dist_batch(SC_Compiler& sc, const char* name, const char* dist_name)
+{
+    sc.push_object(make_symbol(name),
+        make<Cpp_Batch_Function>(make_symbol(dist_name), 1));
+}
+
+void
+define_colour_batch(SC_Compiler& sc, const char* name, const char* colour_name)
+{
+    sc.push_object(make_symbol(name),
+        make<Cpp_Batch_Function>(make_symbol(colour_name), 3));
+}
+
 Cpp_Program::Cpp_Program(Source_State& ss)
 :
     sstate_{ss},
     tempfile_id_{make_tempfile_id()},
     path_{register_tempfile(tempfile_id_,".cpp")},
     file_{path_.c_str()},
-    sc_{SC_Target::cpp, ss}
+    sc_{std::make_unique<SC_Compiler>(SC_Target::cpp, ss)},
+    isc_{std::make_unique<SC_Compiler>(SC_Target::interval, ss)},
+    dsc_{std::make_unique<SC_Compiler>(SC_Target::dual, ss)}
 {
     if (file_.fail()) {
         throw Exception{At_SState{ss},
@@ -57,34 +894,265 @@ Cpp_Program::~Cpp_Program()
     if (dll_ != nullptr)
         dlclose(dll_);
 #endif
+    // Don't wait for remove_all_tempfiles(), which isn't called if the
+    // process is killed. A preserved .cpp file is not removed.
+    remove_tempfiles(tempfile_id_);
+}
+
+// Command line options for compiling and linking generated C++ code.
+// -fno-math-errno lets sqrt() and friends be vectorized in dist_batch.
+static const char cc_flags[] = "-fpic -O3 -fno-math-errno";
+//static const char cc_flags[] = "-fpic -g";
+static const char link_flags[] = "-shared";
+#ifdef _WIN32
+static const char lib_suffix[] = ".dll";
+#else
+static const char lib_suffix[] = ".so";
+#endif
+
+// The JIT cache is a directory of shared objects compiled by Cpp_Program,
+// indexed by a hash of the C++ source code, the compiler identity and the
+// compiler flags. A copy of the source is stored next to each shared object,
+// and compared with the new source on lookup, so a hash collision is
+// treated as a cache miss. An empty path means the cache is disabled.
+// The cache location is $XDG_CACHE_HOME/curv/jit, or ~/.cache/curv/jit.
+// Set CURV_JIT_CACHE=0 to disable the cache.
+static Filesystem::path
+jit_cache_dir()
+{
+    const char* enable = getenv("CURV_JIT_CACHE");
+    if (enable != nullptr && strcmp(enable, "0") == 0)
+        return {};
+    return cache_dir("jit");
+}
+
+// The output of `c++ --version`, which identifies the compiler. If the
+// compiler is upgraded, we don't want to use stale cached objects.
+static const std::string&
+compiler_identity()
+{
+    static std::string id;
+    static bool initialized = false;
+    if (!initialized) {
+        initialized = true;
+        FILE* pipe = popen("c++ --version", "r");
+        if (pipe != nullptr) {
+            char buf[256];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0)
+                id.append(buf, n);
+            pclose(pipe);
+        }
+    }
+    return id;
+}
+
+// 128 bit hash (two 64 bit FNV-1a hashes with different offset bases),
+// formatted as 32 hex digits.
+static std::string
+jit_cache_key(const std::string& source)
+{
+    std::uint64_t h1 = 14695981039346656037ULL;
+    std::uint64_t h2 = 0x9E3779B97F4A7C15ULL;
+    auto mix = [&](const std::string& s) -> void {
+        for (unsigned char c : s) {
+            h1 = (h1 ^ c) * 1099511628211ULL;
+            h2 = (h2 ^ c) * 0x100000001B3ULL;
+            h2 ^= h2 >> 29;
+        }
+        // separator, so that ("ab","c") and ("a","bc") hash differently
+        h1 = (h1 ^ 0xFF) * 1099511628211ULL;
+        h2 = (h2 ^ 0xFF) * 0x100000001B3ULL;
+    };
+    mix(source);
+    mix(compiler_identity());
+    mix(cc_flags);
+    mix(link_flags);
+    char key[33];
+    snprintf(key, sizeof(key), "%016llx%016llx",
+        (unsigned long long)h1, (unsigned long long)h2);
+    return key;
+}
+
+static bool
+file_contents_equal(const Filesystem::path& path, const std::string& data)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::string contents{std::istreambuf_iterator<char>(in),
+                         std::istreambuf_iterator<char>()};
+    return contents == data;
+}
+
+// Atomically copy 'from' to 'to', so that concurrent curv processes
+// never see a partially written file in the cache.
+static void
+atomic_copy(const Filesystem::path& from, const Filesystem::path& to)
+{
+    auto tmp = to;
+    tmp += stringify(".", getpid(), ".tmp")->c_str();
+    std::error_code err;
+    Filesystem::copy_file(from, tmp,
+        Filesystem::copy_options::overwrite_existing, err);
+    if (!err)
+        Filesystem::rename(tmp, to, err);
+    if (err)
+        Filesystem::remove(tmp, err);
 }
 
 void
 Cpp_Program::compile(const Context& cx)
 {
-    sc_.emit_objects(file_);
+    std::stringstream objects, interval_objects, dual_objects;
+    emit_parameters(*sc_, objects);
+    sc_->emit_objects(objects);
+    bool has_interval = !isc_->objects_.empty();
+    if (has_interval) {
+        interval_objects << interval_header << vector_header;
+        emit_parameters(*isc_, interval_objects);
+        isc_->emit_objects(interval_objects);
+        interval_objects << "} // namespace curv_interval\n";
+    }
+    bool has_dual = !dsc_->objects_.empty();
+    if (has_dual) {
+        dual_objects << dual_header << vector_header;
+        emit_parameters(*dsc_, dual_objects);
+        dsc_->emit_objects(dual_objects);
+        dual_objects << "} // namespace curv_dual\n";
+    }
+
+    // The interval and dual number functions are optional: if the C++
+    // compiler rejects them, then compile the program again without the
+    // interval functions, then without the dual number functions, then
+    // without both.
+    for (int omit = 0; omit < 4; ++omit) {
+        has_interval_ = has_interval && !(omit & 1);
+        has_dual_ = has_dual && !(omit & 2);
+        if ((omit & 1 && !has_interval) || (omit & 2 && !has_dual))
+            continue;
+        if (omit > 0) {
+            if (sstate_.system_.verbose_) {
+                std::cerr << "WARNING: C++ compile failed; retrying without"
+                    << (omit & 1 ? " interval" : "")
+                    << (omit == 3 ? " and" : "")
+                    << (omit & 2 ? " dual number" : "") << " code\n";
+            }
+            file_.open(path_.c_str());
+            file_ << standard_header;
+        }
+        if (compile_code(objects.str()
+            + (has_interval_ ? interval_objects.str() : "")
+            + (has_dual_ ? dual_objects.str() : ""), cx))
+        {
+            return;
+        }
+    }
+    preserve_tempfile();
+    throw Exception(cx, stringify("c++ compile failed; see ", path_));
+}
+
+bool
+Cpp_Program::compile_code(const std::string& code, const Context& cx)
+{
+    file_ << code;
     file_.close();
+    bool verbose = sstate_.system_.verbose_;
+    if (verbose) {
+        std::cerr << "C++ shape code: " << code.size() << " bytes, "
+                  << sc_->outlined_functions_ << " outlined functions, "
+                  << sc_->outlined_calls_ << " outlined calls\n";
+    }
 
-    // compile C++ to optimized object code
-    auto cc_cmd = stringify("c++ -fpic -O3 -c ", path_.string());
-    //auto cc_cmd = stringify("c++ -fpic -c -g ", path_.c_str());
-    if (system(cc_cmd->c_str()) != 0) {
-        preserve_tempfile();
-        throw Exception(cx, stringify("c++ compile failed; see ", path_));
+    // If identical source code was compiled by an earlier run,
+    // load the shared object from the JIT cache.
+    Filesystem::path cache_dir = jit_cache_dir();
+    Filesystem::path cache_lib, cache_src;
+    std::string source = standard_header + code;
+    if (!cache_dir.empty()) {
+        auto key = jit_cache_key(source);
+        cache_lib = cache_dir / (key + lib_suffix);
+        cache_src = cache_dir / (key + ".cpp");
+        if (Filesystem::exists(cache_lib)
+            && file_contents_equal(cache_src, source))
+        {
+            load_library(cache_lib, cx);
+            if (verbose)
+                std::cerr << "C++ shape code loaded from JIT cache\n";
+            return true;
+        }
     }
 
+    // compile C++ to optimized object code
+    auto start_time = std::chrono::steady_clock::now();
+    auto cc_cmd = stringify("c++ ", cc_flags, " -c ", path_.string());
+    if (system(cc_cmd->c_str()) != 0)
+        return false;
+
     // create shared object
     auto obj_name = register_tempfile(tempfile_id_,".o");
-#ifdef _WIN32
-    auto lib_name = register_tempfile(tempfile_id_,".dll");
-#else
-    auto lib_name = register_tempfile(tempfile_id_,".so");
-#endif
-    auto link_cmd = stringify("c++ -shared -o ", lib_name.string(), " ", obj_name.string());
+    auto lib_name = register_tempfile(tempfile_id_,lib_suffix);
+    auto link_cmd = stringify("c++ ", link_flags, " -o ", lib_name.string(),
+        " ", obj_name.string());
     if (system(link_cmd->c_str()) != 0)
         throw Exception(cx, "c++ link failed");
+    if (verbose) {
+        std::chrono::duration<double> compile_time =
+            std::chrono::steady_clock::now() - start_time;
+        std::cerr << "C++ compile time: " << compile_time.count() << "s\n";
+    }
+
+    // Store the shared object in the JIT cache. The source is written last,
+    // since a cache entry is only valid once both files are present.
+    if (!cache_dir.empty()) {
+        atomic_copy(lib_name, cache_lib);
+        atomic_copy(path_, cache_src);
+    }
+
+    load_library(lib_name, cx);
+    return true;
+}
+
+void
+Cpp_Program::define_parameter(const char* name, SC_Type type, unsigned offset)
+{
+    params_.push_back({make_symbol(name),
+        make<SC_Uniform_Variable>(type, offset)});
+}
 
-    // load shared object
+void
+Cpp_Program::clear_functions()
+{
+    sc_ = std::make_unique<SC_Compiler>(SC_Target::cpp, sstate_);
+    clear_interval_functions();
+    clear_dual_functions();
+    params_.clear();
+}
+
+void
+Cpp_Program::clear_interval_functions()
+{
+    isc_ = std::make_unique<SC_Compiler>(SC_Target::interval, sstate_);
+}
+
+void
+Cpp_Program::clear_dual_functions()
+{
+    dsc_ = std::make_unique<SC_Compiler>(SC_Target::dual, sstate_);
+}
+
+// The parameters are emitted in each namespace, since their types
+// depend on the target.
+void
+Cpp_Program::emit_parameters(SC_Compiler& sc, std::ostream& out)
+{
+    for (auto& p : params_)
+        p.second->emit(sc, p.first, out);
+}
+
+void
+Cpp_Program::load_library(const Filesystem::path& lib_name, const Context& cx)
+{
 #ifdef _WIN32
     dll_ = LoadLibraryW(lib_name.c_str()); // use ANSI variant to avoid the need to convert char* to wchar_t*
     if (dll_ == NULL)
@@ -12,9 +12,49 @@
     #include <libcurv/win32.h>
 #endif
 #include <fstream>
+#include <memory>
+#include <vector>
 
 namespace curv { namespace io {
 
+// Define a C++ function that evaluates the previously defined distance
+// function `dist_name` (signature vec4 -> float) over a batch of points:
+//   void name(const float* xs, const float* ys, const float* zs, float t,
+//             float* out, size_t n)
+// The points are passed in structure-of-arrays layout, and the loop body
+// is a direct call to `dist_name`, which the C++ compiler inlines, so that
+// simple distance functions can be auto-vectorized.
+// A second function, `<name>_params`, takes the parameter block of a
+// parametric shape (see Cpp_Program::define_parameter) after the time
+// argument. The function without the suffix passes a null parameter block,
+// so it can only be used by a shape with no parameters. The other entry
+// points below are also defined in these two versions.
+void define_dist_batch(SC_Compiler&, const char* name, const char* dist_name);
+
+// Define a batched version of the previously defined colour function
+// `colour_name` (signature vec4 -> vec3), with the same parameters as a
+// batched distance function. The results are stored in `out` as 3*n floats,
+// with the red, green and blue components of each colour stored together.
+void define_colour_batch(
+    SC_Compiler&, const char* name, const char* colour_name);
+
+// Define a C++ function that evaluates the previously defined interval
+// distance function `dist_name` (see SC_Target::interval) over a box:
+//   void name(const double* lo, const double* hi, double t, double* out)
+// The box is [lo[0],hi[0]] x [lo[1],hi[1]] x [lo[2],hi[2]], and the bounds
+// of the distance field over the box are stored in out[0] and out[1].
+// If the bounds can't be computed (eg, an `if` statement or array index
+// depends on an ambiguous condition), the result is [-inf,inf].
+void define_dist_interval(
+    SC_Compiler&, const char* name, const char* dist_name);
+
+// Define a C++ function that evaluates the previously defined dual number
+// distance function `dist_name` (see SC_Target::dual) over a batch of points,
+// with the same parameters as a batched distance function. The distance and
+// its gradient are stored in `out` as 4*n floats: d, dd/dx, dd/dy, dd/dz.
+void define_dist_grad_batch(
+    SC_Compiler&, const char* name, const char* dist_name);
+
 // A structure for building a C++ source file, compiling it, and getting
 // the results. This holds the C++ source code and the compiled binary.
 struct Cpp_Program
@@ -23,7 +63,21 @@ struct Cpp_Program
     unsigned tempfile_id_;
     Filesystem::path path_;
     std::ofstream file_;
-    SC_Compiler sc_;
+    std::unique_ptr<SC_Compiler> sc_;
+    // Functions defined using interval arithmetic. They are emitted after
+    // the functions in sc_, in a separate namespace.
+    std::unique_ptr<SC_Compiler> isc_;
+    // True if the interval functions were compiled.
+    bool has_interval_ = false;
+    // Functions defined using dual numbers, which compute derivatives.
+    // They are emitted last, in a separate namespace.
+    std::unique_ptr<SC_Compiler> dsc_;
+    // True if the dual number functions were compiled.
+    bool has_dual_ = false;
+    // The parameters of a parametric shape, which are emitted as
+    // functions in each namespace.
+    std::vector<std::pair<Symbol_Ref, Shared<const SC_Uniform_Variable>>>
+        params_;
 
 #ifdef _WIN32
     // Store the handle to the loaded library via LoadLibrary
@@ -36,15 +90,75 @@ struct Cpp_Program
     Cpp_Program(Source_State&);
     ~Cpp_Program();
     static const char standard_header[];
+    static const char interval_header[];
+    static const char dual_header[];
+    static const char vector_header[];
     inline void define_function(
         const char* name, SC_Type param_type, SC_Type result_type,
         Shared<const Function> func, const Context& cx)
     {
-        sc_.define_function(name, param_type, result_type, func, cx);
+        sc_->define_function(name, param_type, result_type, func, cx);
+    }
+    inline void define_dist_batch(const char* name, const char* dist_name)
+    {
+        io::define_dist_batch(*sc_, name, dist_name);
+    }
+    inline void define_colour_batch(const char* name, const char* colour_name)
+    {
+        io::define_colour_batch(*sc_, name, colour_name);
+    }
+    inline void define_interval_function(
+        const char* name, SC_Type param_type, SC_Type result_type,
+        Shared<const Function> func, const Context& cx)
+    {
+        isc_->define_function(name, param_type, result_type, func, cx);
+    }
+    inline void define_dist_interval(const char* name, const char* dist_name)
+    {
+        io::define_dist_interval(*isc_, name, dist_name);
+    }
+    // Discard the interval functions, after one of them fails to compile
+    // because it uses an operation that interval arithmetic doesn't support.
+    void clear_interval_functions();
+    inline void define_dual_function(
+        const char* name, SC_Type param_type, SC_Type result_type,
+        Shared<const Function> func, const Context& cx)
+    {
+        dsc_->define_function(name, param_type, result_type, func, cx);
+    }
+    inline void define_dist_grad_batch(
+        const char* name, const char* dist_name)
+    {
+        io::define_dist_grad_batch(*dsc_, name, dist_name);
     }
+    // Discard the dual number functions, after one of them fails to compile
+    // because it uses an operation that dual numbers don't support.
+    void clear_dual_functions();
+    // Define a parameter of a parametric shape, which is stored in the
+    // parameter block as type.count() floats, starting at `offset`.
+    // Shape code refers to the parameter using a Uniform_Variable whose
+    // identifier is `name`. The parameter block is passed to each `_params`
+    // entry point at run time, and from there to each generated function,
+    // so one compiled program can evaluate every instance of a parametric
+    // shape. It must be defined before the functions.
+    void define_parameter(const char* name, SC_Type type, unsigned offset);
+    // Discard all of the functions and parameters defined so far, so that
+    // the program can be defined again, differently.
+    void clear_functions();
+    // Compile the C++ code and load the resulting shared object.
+    // Shared objects are cached on disk across runs: see jit_cache_dir().
+    // If the C++ compiler rejects the interval or dual number functions,
+    // they are discarded, and has_interval_functions() or
+    // has_dual_functions() is false.
     void compile(const Context& cx);
+    bool has_interval_functions() const { return has_interval_; }
+    bool has_dual_functions() const { return has_dual_; }
     void* get_function(const char* name);
     void preserve_tempfile();
+private:
+    bool compile_code(const std::string& code, const Context&);
+    void emit_parameters(SC_Compiler&, std::ostream&);
+    void load_library(const Filesystem::path&, const Context&);
 };
 
 }} // namespace
@@ -0,0 +1,342 @@
+// Copyright 2016-2021 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/io/cpu_render.h>
+
+#include <libcurv/exception.h>
+#include <libcurv/shape.h>
+#include <glm/common.hpp>
+#include <glm/exponential.hpp>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace curv { namespace io {
+
+// The rendering code mirrors the GLSL code generated by export_frag():
+// see mainImage(), castRay(), calcNormal(), calcAO() and render() in frag.cc.
+
+namespace {
+
+constexpr int tile_size = 16;
+
+// A batch of points, in structure-of-arrays layout, which are evaluated
+// using Shape::dist_batch and Shape::colour_batch.
+struct Points
+{
+    std::vector<float> xs_, ys_, zs_, dist_, rgb_;
+
+    void resize(size_t n)
+    {
+        xs_.resize(n); ys_.resize(n); zs_.resize(n);
+        dist_.resize(n); rgb_.resize(3*n);
+    }
+    void set(size_t i, glm::vec3 p)
+    {
+        xs_[i] = p.x; ys_[i] = p.y; zs_[i] = p.z;
+    }
+    void dist(const Shape& shape, float time, size_t n)
+    {
+        shape.dist_batch(
+            xs_.data(), ys_.data(), zs_.data(), time, dist_.data(), n);
+    }
+    void colour(const Shape& shape, float time, size_t n)
+    {
+        shape.colour_batch(
+            xs_.data(), ys_.data(), zs_.data(), time, rgb_.data(), n);
+    }
+    glm::vec3 rgb(size_t i) const
+    {
+        return {rgb_[3*i], rgb_[3*i+1], rgb_[3*i+2]};
+    }
+};
+
+// A rectangle of pixels. Each pixel has aa*aa samples.
+struct Tile
+{
+    int x0_, y0_, w_, h_;
+    int aa_;
+    std::vector<glm::vec3> sum_; // total colour of each pixel's samples
+
+    Tile(int x0, int y0, int w, int h, int aa)
+    : x0_(x0), y0_(y0), w_(w), h_(h), aa_(aa), sum_(size_t(w*h))
+    {}
+    size_t nsamples() const { return size_t(w_*h_*aa_*aa_); }
+    size_t pixel(size_t s) const { return s / size_t(aa_*aa_); }
+
+    // The window coordinates of sample s, like fragCoord+jitter in GLSL.
+    glm::vec2 coord(size_t s) const
+    {
+        size_t p = pixel(s);
+        int k = int(s % size_t(aa_*aa_));
+        glm::vec2 jitter{0.0f};
+        if (aa_ > 1)
+            jitter = glm::vec2(k / aa_, k % aa_) / float(aa_) - 0.5f;
+        return glm::vec2(x0_ + int(p) % w_, y0_ + int(p) / w_)
+            + 0.5f + jitter;
+    }
+};
+
+struct Renderer
+{
+    const Shape& shape_;
+    const Image_Export& opts_;
+    glm::vec2 res_;
+    glm::vec3 bg_;
+
+    // 2D: map window coordinates to shape coordinates.
+    glm::vec2 offset_;
+    float scale_;
+
+    // 3D: the camera.
+    glm::vec3 eye_, uu_, vv_, ww_;
+
+    Renderer(const Shape&, const Image_Export&);
+    void render_2d(Tile&, float time, Points&) const;
+    void render_3d(Tile&, float time, Points&) const;
+    glm::vec3 shade(glm::vec3 pos, glm::vec3 nor, glm::vec3 rd,
+        glm::vec3 col, float occ) const;
+};
+
+Renderer::Renderer(const Shape& shape, const Image_Export& opts)
+:
+    shape_(shape),
+    opts_(opts),
+    res_(opts.size),
+    bg_(opts.bg_)
+{
+    BBox bbox = shape.bbox_;
+    if (shape.is_2d_) {
+        if (bbox.empty2() || bbox.infinite2()) {
+            bbox.min = glm::dvec3(-10.0);
+            bbox.max = glm::dvec3(+10.0);
+        }
+        glm::vec2 size(bbox.max.x - bbox.min.x, bbox.max.y - bbox.min.y);
+        glm::vec2 scale2 = size / res_;
+        offset_ = glm::vec2(bbox.min.x, bbox.min.y);
+        if (scale2.x > scale2.y) {
+            scale_ = scale2.x;
+            offset_.y -= (res_.y*scale_ - size.y)/2.0f;
+        } else {
+            scale_ = scale2.y;
+            offset_.x -= (res_.x*scale_ - size.x)/2.0f;
+        }
+    } else {
+        if (bbox.empty3() || bbox.infinite3()) {
+            bbox.min = glm::dvec3(-10.0);
+            bbox.max = glm::dvec3(+10.0);
+        }
+        glm::vec3 origin = (bbox.min + bbox.max) / 2.0;
+        glm::vec3 radius = (bbox.max - bbox.min) / 2.0;
+        float r = std::max(radius.x, std::max(radius.y, radius.z)) / 1.3f;
+        // The default view of Viewer::reset_view, converted from the
+        // OpenGL coordinate system to the Curv coordinate system.
+        eye_ = glm::vec3(2.598076, -4.5, 3.0)*r + origin;
+        glm::vec3 up(-0.25, 0.433013, 0.866025);
+        ww_ = glm::normalize(origin - eye_);
+        uu_ = glm::normalize(glm::cross(ww_, up));
+        vv_ = glm::normalize(glm::cross(uu_, ww_));
+    }
+}
+
+void
+Renderer::render_2d(Tile& tile, float time, Points& pts) const
+{
+    size_t n = tile.nsamples();
+    pts.resize(n);
+    for (size_t s = 0; s < n; ++s)
+        pts.set(s, glm::vec3(tile.coord(s)*scale_ + offset_, 0.0f));
+    pts.dist(shape_, time, n);
+
+    // Evaluate the colour of the samples that are inside the shape.
+    std::vector<size_t> inside;
+    for (size_t s = 0; s < n; ++s) {
+        if (pts.dist_[s] > 0.0f)
+            tile.sum_[tile.pixel(s)] += bg_;
+        else {
+            pts.set(inside.size(), glm::vec3(pts.xs_[s], pts.ys_[s], 0.0f));
+            inside.push_back(s);
+        }
+    }
+    pts.colour(shape_, time, inside.size());
+    for (size_t i = 0; i < inside.size(); ++i)
+        tile.sum_[tile.pixel(inside[i])] += pts.rgb(i);
+}
+
+void
+Renderer::render_3d(Tile& tile, float time, Points& pts) const
+{
+    size_t n = tile.nsamples();
+    pts.resize(n);
+    std::vector<glm::vec3> rd(n);
+    std::vector<float> t(n, 0.0f);
+    for (size_t s = 0; s < n; ++s) {
+        glm::vec2 p = -1.0f + 2.0f * tile.coord(s) / res_;
+        p.x *= res_.x/res_.y;
+        rd[s] = glm::normalize(uu_*p.x + vv_*p.y + ww_*2.5f);
+    }
+
+    // March all of the rays together. `active` holds the rays that haven't
+    // yet hit the shape or gone past ray_max_depth.
+    std::vector<size_t> active(n), hits;
+    for (size_t s = 0; s < n; ++s)
+        active[s] = s;
+    bool limit_depth = !std::isinf(opts_.ray_max_depth_);
+    float tmax = float(opts_.ray_max_depth_);
+    for (int iter = 0; iter < opts_.ray_max_iter_ && !active.empty(); ++iter)
+    {
+        for (size_t i = 0; i < active.size(); ++i) {
+            size_t s = active[i];
+            pts.set(i, eye_ + rd[s]*t[s]);
+        }
+        pts.dist(shape_, time, active.size());
+        size_t nactive = 0;
+        for (size_t i = 0; i < active.size(); ++i) {
+            size_t s = active[i];
+            float d = pts.dist_[i];
+            if (std::abs(d) < std::abs(0.0005f*t[s])) {
+                hits.push_back(s);
+                continue;
+            }
+            t[s] += d;
+            if (limit_depth && t[s] > tmax)
+                continue;
+            active[nactive++] = s;
+        }
+        active.resize(nactive);
+    }
+    // Rays that are still active, or went past ray_max_depth, missed.
+    std::vector<bool> hit(n, false);
+    for (size_t s : hits)
+        hit[s] = true;
+    for (size_t s = 0; s < n; ++s)
+        if (!hit[s])
+            tile.sum_[tile.pixel(s)] += bg_;
+    if (hits.empty())
+        return;
+
+    size_t h = hits.size();
+    std::vector<glm::vec3> pos(h), nor(h, glm::vec3(0.0f)), col(h);
+    std::vector<float> occ(h, 0.0f);
+    for (size_t i = 0; i < h; ++i) {
+        pos[i] = eye_ + rd[hits[i]]*t[hits[i]];
+        pts.set(i, pos[i]);
+    }
+    pts.colour(shape_, time, h);
+    for (size_t i = 0; i < h; ++i)
+        col[i] = pts.rgb(i);
+
+    // calcNormal: the gradient, from 4 samples around each point.
+    const float e = 0.5773f*0.0005f;
+    const glm::vec3 ks[4] = {
+        {e, -e, -e}, {-e, -e, e}, {-e, e, -e}, {e, e, e}
+    };
+    for (auto& k : ks) {
+        for (size_t i = 0; i < h; ++i)
+            pts.set(i, pos[i] + k);
+        pts.dist(shape_, time, h);
+        for (size_t i = 0; i < h; ++i)
+            nor[i] += k*pts.dist_[i];
+    }
+    for (auto& v : nor)
+        v = glm::normalize(v);
+
+    // calcAO: ambient occlusion.
+    float sca = 1.0f;
+    for (int j = 0; j < 5; ++j) {
+        float hr = 0.01f + 0.12f*float(j)/4.0f;
+        for (size_t i = 0; i < h; ++i)
+            pts.set(i, nor[i]*hr + pos[i]);
+        pts.dist(shape_, time, h);
+        for (size_t i = 0; i < h; ++i)
+            occ[i] += -(pts.dist_[i] - hr)*sca;
+        sca *= 0.95f;
+    }
+
+    for (size_t i = 0; i < h; ++i) {
+        size_t s = hits[i];
+        float ao = glm::clamp(1.0f - 3.0f*occ[i], 0.0f, 1.0f);
+        tile.sum_[tile.pixel(s)] += shade(pos[i], nor[i], rd[s], col[i], ao);
+    }
+}
+
+// The lighting model of the standard shader.
+glm::vec3
+Renderer::shade(glm::vec3 pos, glm::vec3 nor, glm::vec3 rd,
+    glm::vec3 col, float occ) const
+{
+    glm::vec3 ref = glm::reflect(rd, nor);
+    glm::vec3 lig = glm::normalize(glm::vec3(-0.4, 0.6, 0.7));
+    float amb = glm::clamp(0.5f + 0.5f*nor.z, 0.0f, 1.0f);
+    float dif = glm::clamp(glm::dot(nor, lig), 0.0f, 1.0f);
+    float bac = glm::clamp(
+        glm::dot(nor, glm::normalize(glm::vec3(-lig.x, lig.y, 0.0f))),
+        0.0f, 1.0f) * glm::clamp(1.0f - pos.z, 0.0f, 1.0f);
+    float dom = glm::smoothstep(-0.1f, 0.1f, ref.z);
+    float fre = std::pow(glm::clamp(1.0f + glm::dot(nor, rd), 0.0f, 1.0f),
+        2.0f);
+    float spe = std::pow(glm::clamp(glm::dot(ref, lig), 0.0f, 1.0f), 16.0f);
+
+    glm::vec3 lin{0.0f};
+    lin += 1.30f*dif*glm::vec3(1.00, 0.80, 0.55);
+    lin += 2.00f*spe*glm::vec3(1.00, 0.90, 0.70)*dif;
+    lin += 0.40f*amb*glm::vec3(0.40, 0.60, 1.00)*occ;
+    lin += 0.50f*dom*glm::vec3(0.40, 0.60, 1.00)*occ;
+    lin += 0.50f*bac*glm::vec3(0.35, 0.35, 0.35)*occ;
+    lin += 0.25f*fre*glm::vec3(1.00, 1.00, 1.00)*occ;
+    glm::vec3 iqcol = col*lin;
+    col = glm::mix(col, iqcol, float(opts_.contrast_));
+    return glm::clamp(col, 0.0f, 1.0f);
+}
+
+} // namespace
+
+void
+cpu_render(
+    const Shape& shape, const Image_Export& opts, unsigned char* pixels,
+    bool multithreaded)
+{
+    Renderer r(shape, opts);
+    int aa = std::max(opts.aa_, 1);
+    int taa = std::max(opts.taa_, 1);
+    int xtiles = (opts.size.x + tile_size - 1) / tile_size;
+    int ytiles = (opts.size.y + tile_size - 1) / tile_size;
+    int ntiles = xtiles * ytiles;
+    Thread_Exception ex;
+    #pragma omp parallel for schedule(dynamic) if (multithreaded)
+    for (int i = 0; i < ntiles; ++i) ex.guard([&]{
+        int x0 = (i % xtiles) * tile_size;
+        int y0 = (i / xtiles) * tile_size;
+        Tile tile(x0, y0,
+            std::min(tile_size, opts.size.x - x0),
+            std::min(tile_size, opts.size.y - y0),
+            aa);
+        Points pts;
+        for (int j = 0; j < taa; ++j) {
+            float time = float(opts.fstart_ + double(j)/taa*opts.fdur_);
+            if (shape.is_2d_)
+                r.render_2d(tile, time, pts);
+            else
+                r.render_3d(tile, time, pts);
+        }
+        for (int y = 0; y < tile.h_; ++y) {
+            for (int x = 0; x < tile.w_; ++x) {
+                glm::vec3 col = tile.sum_[y*tile.w_ + x] / float(aa*aa*taa);
+                // convert linear RGB to sRGB
+                col = glm::pow(glm::max(col, 0.0f), glm::vec3(1.0f/2.2f));
+                col = glm::clamp(col, 0.0f, 1.0f);
+                unsigned char* pix =
+                    &pixels[((y0 + y)*opts.size.x + x0 + x) * 4];
+                pix[0] = (unsigned char)(col.r*255.0f + 0.5f);
+                pix[1] = (unsigned char)(col.g*255.0f + 0.5f);
+                pix[2] = (unsigned char)(col.b*255.0f + 0.5f);
+                pix[3] = 255;
+            }
+        }
+    });
+    ex.rethrow();
+}
+
+}} // namespace
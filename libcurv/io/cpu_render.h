@@ -0,0 +1,30 @@
+// Copyright 2016-2021 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef LIBCURV_IO_CPU_RENDER_H
+#define LIBCURV_IO_CPU_RENDER_H
+
+#include <libcurv/io/png.h>
+
+namespace curv {
+struct Shape;
+
+namespace io {
+
+// Render an image of a shape on the CPU, without OpenGL. This produces the
+// same image as the GPU viewer with the default camera and the standard
+// shader: 2D shapes are drawn to fit the bounding box, and 3D shapes are
+// ray-marched. The result is stored in `pixels` as 4 bytes per pixel (RGBA),
+// bottom row first, like glReadPixels, so it can be passed to write_png_rgb.
+//
+// The image is divided into tiles, which are rendered in parallel if
+// multithreaded is true. The rays in a tile are marched together, so that
+// each step is a single call to Shape::dist_batch. Only set multithreaded
+// if the shape is thread safe (eg, a Compiled_Shape).
+void cpu_render(
+    const Shape&, const Image_Export&, unsigned char* pixels,
+    bool multithreaded);
+
+}} // namespace
+#endif // header guard
@@ -0,0 +1,118 @@
+// Copyright 2016-2021 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/io/file_watcher.h>
+
+#ifdef __linux__
+extern "C" {
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+}
+#endif
+
+namespace curv::io {
+
+Watch_List::Watch_List(const char* filename)
+{
+    std::error_code errcode;
+    main_ = Filesystem::weakly_canonical(filename, errcode);
+    if (errcode) main_ = filename;
+    main_exists_ = main_stamp_.get(main_);
+}
+
+bool
+Watch_List::changed() const
+{
+    File_Stamp now;
+    if (now.get(main_) != main_exists_)
+        return true;
+    // Compare the size as well as the mtime, like File_Stamp::changed,
+    // since a quick edit may not change a coarse grained mtime.
+    if (main_exists_
+        && (now.mtime_ != main_stamp_.mtime_ || now.size_ != main_stamp_.size_))
+    {
+        return true;
+    }
+    for (auto& dep : deps_)
+        if (dep.changed()) return true;
+    return false;
+}
+
+#ifdef __linux__
+File_Watcher::File_Watcher(const Watch_List& wl)
+{
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) return;
+    files_.insert(wl.main_);
+    for (auto& dep : wl.deps_) {
+        std::error_code errcode;
+        if (Filesystem::is_directory(dep.path_, errcode))
+            dirs_.insert(dep.path_);
+        else
+            files_.insert(dep.path_);
+    }
+    std::set<Filesystem::path> watched = dirs_;
+    for (auto& f : files_)
+        watched.insert(f.parent_path());
+    for (auto& dir : watched) {
+        int wd = inotify_add_watch(fd_, dir.c_str(),
+            IN_CLOSE_WRITE | IN_CREATE | IN_DELETE
+            | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB);
+        if (wd < 0) {
+            close(fd_);
+            fd_ = -1;
+            return;
+        }
+        wds_[wd] = dir;
+    }
+}
+
+File_Watcher::~File_Watcher()
+{
+    if (fd_ >= 0) close(fd_);
+}
+
+bool
+File_Watcher::read_events()
+{
+    alignas(struct inotify_event) char buf[4096];
+    bool relevant = false;
+    for (;;) {
+        ssize_t n = read(fd_, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (char* p = buf; p < buf + n; ) {
+            auto ev = (struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            auto dir = wds_.find(ev->wd);
+            if (dir == wds_.end()) continue;
+            if (dirs_.count(dir->second)
+                || (ev->len > 0
+                    && files_.count(dir->second / ev->name)))
+            {
+                relevant = true;
+            }
+        }
+    }
+    return relevant;
+}
+
+// A save may consist of several events (eg, truncate then write, or
+// write a temporary file then rename), so after the first relevant
+// event, wait until the events stop before reporting the change.
+bool
+File_Watcher::wait(int timeout)
+{
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    if (poll(&pfd, 1, timeout) <= 0 || !read_events())
+        return false;
+    for (;;) {
+        if (poll(&pfd, 1, 20) <= 0)
+            return true;
+        read_events();
+    }
+}
+#endif
+
+} // namespace
@@ -0,0 +1,61 @@
+// Copyright 2016-2021 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef LIBCURV_IO_FILE_WATCHER_H
+#define LIBCURV_IO_FILE_WATCHER_H
+
+#include <libcurv/filesystem.h>
+#include <libcurv/import.h>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace curv::io {
+
+// The files that the main program depends on: the main file, and the files
+// and directories that it imported, transitively. The import cache ensures
+// that only the files that changed are re-evaluated on the next reload.
+struct Watch_List
+{
+    Filesystem::path main_;
+    bool main_exists_ = false;
+    File_Stamp main_stamp_;
+    std::vector<File_Stamp> deps_;
+
+    // The main file is stamped when the Watch_List is constructed,
+    // which is before it is evaluated.
+    Watch_List(const char* filename);
+
+    // Return true if a file has changed since it was stamped.
+    // Used when file change notifications aren't available, and to detect
+    // changes made before a File_Watcher was created.
+    bool changed() const;
+};
+
+#ifdef __linux__
+// Wait for a file in a Watch_List to change, using inotify.
+// The directories containing the files are watched, rather than the files
+// themselves, because many editors save a file by writing a new file, then
+// renaming it over the old one.
+struct File_Watcher
+{
+    int fd_ = -1;
+    std::map<int, Filesystem::path> wds_; // watch descriptor => dir
+    std::set<Filesystem::path> files_;    // changes to these files
+    std::set<Filesystem::path> dirs_;     // changes within these dirs
+
+    File_Watcher(const Watch_List&);
+    ~File_Watcher();
+    bool ok() const { return fd_ >= 0; }
+
+    // Read the pending events, return true if one of them is relevant.
+    bool read_events();
+
+    // Wait up to `timeout` ms for a change, and return true if one occurred.
+    bool wait(int timeout);
+};
+#endif
+
+} // namespace
+#endif // header guard
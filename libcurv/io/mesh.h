@@ -16,9 +16,12 @@ namespace curv { namespace io {
 // Mesh file formats
 enum class Mesh_Format {
     stl,
+    stl_binary,
     obj,
     x3d,
-    gltf
+    gltf,
+    glb,
+    ply
 };
 
 // Mesh generators
@@ -36,12 +39,21 @@ struct Mesh_Export
     Mesh_Gen mgen_ = Mesh_Gen::smooth;
     bool jit_ = false;
     double vsize_ = 0.0;
-    int vcount_ = 100'000;
+    double vcount_ = 100'000;
     // eps: epsilon value for computing normal vectors using the method of
     // partial differences. The default 0 means the system chooses an epsilon.
     double eps_ = 0.0;
     double adaptive_ = 0.0;
+    // narrowband: only evaluate voxels near the surface (#smooth and #tmc).
+    bool narrowband_ = false;
+    // chunk: mesh the voxel grid in slabs of this many voxels along the X
+    // axis (#tmc). 0 means only chunk grids that are too large to mesh in
+    // one piece.
+    int chunk_ = 0;
     enum {face_colour, vertex_colour} colouring_ = face_colour;
+    // glTF: include per-vertex normals and colours.
+    bool normals_ = false;
+    bool colours_ = false;
 };
 
 // Abstract interface for accessing an in-memory quad/triangle mesh,
@@ -64,8 +76,12 @@ struct Mesh_Stats
     unsigned nquad = 0;
 };
 
+// Write a mesh file. The shape is used to compute colours. If multithreaded
+// is true, then the shape is thread safe, and colours are computed in
+// parallel.
 Mesh_Stats write_mesh(
-    Mesh_Format, Mesh&, const Shape&, const Mesh_Export&, std::ostream& out);
+    Mesh_Format, Mesh&, const Shape&, bool multithreaded,
+    const Mesh_Export&, std::ostream& out);
 
 }} // namespace
 #endif // header guard
@@ -8,6 +8,8 @@
 #include <libcurv/viewer/viewer.h>
 #include <libcurv/context.h>
 #include <libcurv/exception.h>
+#include <libcurv/io/compiled_shape.h>
+#include <libcurv/io/cpu_render.h>
 #include <libcurv/io/output_file.h>
 
 #include <libcurv/viewer/texture.h>
@@ -54,12 +56,40 @@ write_png_rgb(
     }
 }
 
+void
+export_png_cpu(
+    const Shape& shape,
+    const Image_Export& p,
+    Output_File& ofile)
+{
+    if (shape.is_3d_ && p.shader_ != Render_Opts::Shader::standard) {
+        throw Exception(At_System(ofile.system_),
+            "the CPU renderer only supports the standard shader");
+    }
+    std::unique_ptr<unsigned char[]> pixels(new unsigned char[p.size.x*p.size.y*4]);
+    auto start_time = std::chrono::steady_clock::now();
+    cpu_render(shape, p, pixels.get(), true);
+    auto end_time = std::chrono::steady_clock::now();
+    if (p.verbose_) {
+        std::chrono::duration<double> render_time = end_time - start_time;
+        std::cerr << "image render time: " << render_time.count() << "s\n";
+    }
+    write_png_rgb(ofile.path().string(), pixels.get(), p.size.x, p.size.y,
+        ofile.system_);
+}
+
 void
 export_png(
     const Shape_Program& shape,
     const Image_Export& p,
     Output_File& ofile)
 {
+    if (p.renderer_ == Image_Export::Renderer::cpu) {
+        Compiled_Shape cshape(shape);
+        export_png_cpu(cshape, p, ofile);
+        return;
+    }
+
     glm::dvec2 shape_size = shape.bbox_.size2();
     glm::dvec2 image_coverage = glm::dvec2(p.size) * p.pixel_size;
     glm::dvec2 overpaint = image_coverage - shape_size;
@@ -9,6 +9,7 @@
 #include <glm/vec2.hpp>
 
 namespace curv {
+struct Shape;
 struct Shape_Program;
 
 namespace io {
@@ -17,7 +18,11 @@ struct Output_File;
 // Image export parameters
 struct Image_Export : public Render_Opts
 {
+    // gpu renders using OpenGL, cpu uses cpu_render() and a Compiled_Shape.
+    enum class Renderer { gpu, cpu };
+
     Image_Export() { aa_ = 4; }
+    Renderer renderer_ = Renderer::gpu;
     glm::ivec2 size;    // Size of exported image, in pixels.
     double pixel_size;  // Size of a square pixel, in shape space.
     double fstart_ = 0.0;  // Frame start time, in seconds, for animations.
@@ -26,5 +31,10 @@ struct Image_Export : public Render_Opts
 
 void export_png(const Shape_Program&, const Image_Export&, Output_File&);
 
+// Export a PNG rendered on the CPU, which doesn't need an OpenGL context.
+// The shape is evaluated by multiple threads, so it must be thread safe,
+// like a Compiled_Shape.
+void export_png_cpu(const Shape&, const Image_Export&, Output_File&);
+
 }} // namespace
 #endif // header guard
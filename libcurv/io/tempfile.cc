@@ -7,6 +7,7 @@
 #include <libcurv/context.h>
 #include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <vector>
 
 
@@ -22,12 +23,16 @@ namespace curv { namespace io {
 
 namespace fs = std::filesystem;
 
+// Cpp_Programs may be created and destroyed on different threads,
+// so the list of temporary files is guarded by a mutex.
+std::mutex tempfiles_mutex;
 std::vector<fs::path> tempfiles;
 unsigned tempfile_id = 0;
 
 unsigned
 make_tempfile_id()
 {
+    std::lock_guard<std::mutex> lock(tempfiles_mutex);
     return tempfile_id++;
 }
 
@@ -42,6 +47,7 @@ fs::path
 register_tempfile(unsigned id, const char* suffix)
 {
     auto filename = tempfile_name(id, suffix);
+    std::lock_guard<std::mutex> lock(tempfiles_mutex);
     tempfiles.push_back(filename);
     return filename;
 }
@@ -49,14 +55,33 @@ register_tempfile(unsigned id, const char* suffix)
 void
 deregister_tempfile(fs::path name)
 {
+    std::lock_guard<std::mutex> lock(tempfiles_mutex);
     auto p = std::find(tempfiles.begin(), tempfiles.end(), name);
     if (p != tempfiles.end())
         tempfiles.erase(p);
 }
 
+// Remove the registered temporary files created using `id`.
+void
+remove_tempfiles(unsigned id)
+{
+    auto stem = tempfile_name(id, "").filename();
+    std::lock_guard<std::mutex> lock(tempfiles_mutex);
+    auto p = std::remove_if(tempfiles.begin(), tempfiles.end(),
+        [&](const fs::path& file) -> bool {
+            if (file.stem() != stem)
+                return false;
+            std::error_code error;
+            fs::remove(file, error);
+            return true;
+        });
+    tempfiles.erase(p, tempfiles.end());
+}
+
 void
 remove_all_tempfiles()
 {
+    std::lock_guard<std::mutex> lock(tempfiles_mutex);
     for (auto& file : tempfiles)
     {
         std::error_code error;
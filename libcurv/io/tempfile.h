@@ -12,6 +12,7 @@ namespace curv { namespace io {
 unsigned make_tempfile_id();
 Filesystem::path register_tempfile(unsigned id, const char* suffix);
 void deregister_tempfile(Filesystem::path name);
+void remove_tempfiles(unsigned id);
 void remove_all_tempfiles();
 
 }} // namespace
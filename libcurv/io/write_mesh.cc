@@ -4,14 +4,97 @@
 
 #include <libcurv/io/mesh.h>
 #include <libcurv/die.h>
+#include <libcurv/exception.h>
 #include <libcurv/function.h>
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
 #include "encode.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <vector>
 
 namespace curv { namespace io {
 
+// Write binary data to an ostream through a large buffer.
+// Numbers are written in little-endian byte order.
+struct Binary_Writer
+{
+    static constexpr size_t buffer_size = 1 << 20;
+    std::ostream& out_;
+    std::vector<char> buf_;
+    size_t len_ = 0;
+
+    Binary_Writer(std::ostream& out) : out_(out), buf_(buffer_size) {}
+    ~Binary_Writer() { flush(); }
+
+    void flush()
+    {
+        out_.write(buf_.data(), len_);
+        len_ = 0;
+    }
+    void put_bytes(const void* data, size_t n)
+    {
+        if (len_ + n > buffer_size) {
+            flush();
+            // A large block is written directly, bypassing the buffer.
+            if (n > buffer_size) {
+                out_.write(static_cast<const char*>(data), n);
+                return;
+            }
+        }
+        std::memcpy(&buf_[len_], data, n);
+        len_ += n;
+    }
+    void put_u8(uint8_t n)
+    {
+        if (len_ == buffer_size) flush();
+        buf_[len_++] = char(n);
+    }
+    void put_u16(uint16_t n)
+    {
+        if (len_ + 2 > buffer_size) flush();
+        buf_[len_++] = char(n);
+        buf_[len_++] = char(n >> 8);
+    }
+    void put_u32(uint32_t n)
+    {
+        if (len_ + 4 > buffer_size) flush();
+        buf_[len_++] = char(n);
+        buf_[len_++] = char(n >> 8);
+        buf_[len_++] = char(n >> 16);
+        buf_[len_++] = char(n >> 24);
+    }
+    void put_float(float f)
+    {
+        uint32_t n;
+        std::memcpy(&n, &f, 4);
+        put_u32(n);
+    }
+    void put_vec3(glm::vec3 v)
+    {
+        put_float(v.x);
+        put_float(v.y);
+        put_float(v.z);
+    }
+};
+
+// Fetch all of the mesh vertices, which are referenced many times each
+// by the triangle list.
+std::vector<glm::vec3> get_vertices(Mesh& mesh)
+{
+    unsigned n = mesh.num_vertices();
+    std::vector<glm::vec3> verts(n);
+    for (unsigned i = 0; i < n; ++i)
+        verts[i] = mesh.vertex(i);
+    return verts;
+}
+
 void put_triangle(std::ostream& out, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
 {
     glm::vec3 n = glm::normalize(glm::cross(v1 - v0, v2 - v0));
@@ -30,64 +113,301 @@ curv::Vec3 linear_RGB_to_sRGB(curv::Vec3 c)
     return curv::Vec3{pow(c.x, k), pow(c.y, k), pow(c.z, k)};
 }
 
-void put_face_colour(std::ostream& out, const curv::Shape& shape,
-    glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+void put_colour(std::ostream& out, glm::vec3 linear_colour)
 {
-    glm::vec3 centroid = (v0 + v1 + v2) / 3.0f;
-    curv::Vec3 c = shape.colour(centroid.x, centroid.y, centroid.z, 0.0);
-    c = linear_RGB_to_sRGB(c);
+    curv::Vec3 c = linear_RGB_to_sRGB(curv::Vec3(linear_colour));
     out << " " << c.x << " " << c.y << " " << c.z;
 }
 
-void put_vertex_colour(std::ostream& out, const curv::Shape& shape, glm::vec3 v)
+// Evaluate the shape's colour function at each point, storing linear RGB
+// colours in a buffer. This is done as a separate stage, before the colours
+// are serialized, so that it can run in parallel. The points are divided
+// into blocks, and each block is passed to Shape::colour_batch.
+// Only set multithreaded if the shape is thread safe (eg, a Compiled_Shape,
+// or a Shape_Program while atomic_refcounts is true).
+std::vector<glm::vec3> get_colours(
+    const curv::Shape& shape, const std::vector<glm::vec3>& points,
+    bool multithreaded)
 {
-    curv::Vec3 c = shape.colour(v.x, v.y, v.z, 0.0);
-    c = linear_RGB_to_sRGB(c);
-    out << " " << c.x << " " << c.y << " " << c.z;
+    constexpr size_t block_size = 256;
+    std::vector<glm::vec3> colours(points.size());
+    int nblocks = int((points.size() + block_size - 1) / block_size);
+    curv::Thread_Exception ex;
+    #pragma omp parallel for schedule(dynamic) if (multithreaded)
+    for (int b = 0; b < nblocks; ++b) ex.guard([&]{
+        float xs[block_size], ys[block_size], zs[block_size];
+        size_t start = size_t(b) * block_size;
+        size_t n = std::min(block_size, points.size() - start);
+        for (size_t i = 0; i < n; ++i) {
+            xs[i] = points[start + i].x;
+            ys[i] = points[start + i].y;
+            zs[i] = points[start + i].z;
+        }
+        shape.colour_batch(xs, ys, zs, 0.0f, &colours[start][0], n);
+    });
+    ex.rethrow();
+    return colours;
 }
 
-inline size_t point_byte_size(Mesh& mesh)
+// Return the centroid of each triangle, in all_triangles order.
+std::vector<glm::vec3> get_centroids(
+    Mesh& mesh, const std::vector<glm::vec3>& verts)
 {
-    return mesh.num_vertices() * 3 * 4; // xyz (float) 4 bytes each
+    std::vector<glm::vec3> centroids;
+    mesh.all_triangles([&](const glm::ivec3& tri)->void {
+        centroids.push_back(
+            (verts[tri[0]] + verts[tri[1]] + verts[tri[2]]) / 3.0f);
+    });
+    return centroids;
 }
 
-// padded buffer length with a given stride
-inline size_t pad_buffer(size_t s, size_t stride)
+// Layout of the binary buffer of a glTF file: triangle indices, followed by
+// per-vertex positions, and optionally normals and colours. Each section
+// begins on a 4 byte boundary, as required by glTF.
+struct GLTF_Layout
 {
-    return (s/stride + 1) * stride;
+    unsigned ntri_;
+    unsigned nverts_;
+    bool normals_;
+    bool colours_;
+    // Use 32 bit indices if the vertex numbers don't fit in 16 bits.
+    // The index 0xFFFF is reserved by glTF for primitive restart.
+    bool uint_indices_;
+    // The smallest and largest vertex indexes (glTF requires exact
+    // accessor bounds).
+    unsigned min_index_ = UINT_MAX;
+    unsigned max_index_ = 0;
+    size_t index_bytes_ = 0;
+
+    GLTF_Layout(Mesh& mesh, const Mesh_Export& opts)
+    :
+        ntri_(0),
+        nverts_(mesh.num_vertices()),
+        normals_(opts.normals_),
+        colours_(opts.colours_),
+        uint_indices_(nverts_ >= 0xFFFF)
+    {
+        mesh.all_triangles([&](const glm::ivec3& tri)->void {
+            ++ntri_;
+            min_index_ = std::min(min_index_,
+                unsigned(std::min(tri[0], std::min(tri[1], tri[2]))));
+            max_index_ = std::max(max_index_,
+                unsigned(std::max(tri[0], std::max(tri[1], tri[2]))));
+        });
+        if (ntri_ == 0)
+            min_index_ = 0;
+        index_bytes_ = size_t(ntri_) * 3 * (uint_indices_ ? 4 : 2);
+        // The lengths in a GLB file are 32 bits, so the buffer is limited
+        // to 4GiB, which also bounds each bufferView's byteLength.
+        if (buffer_bytes() > UINT32_MAX) {
+            throw Exception_Base(stringify(
+                "glTF export: mesh is too large (", buffer_bytes(),
+                " bytes of vertex data, the limit is 4GiB)"));
+        }
+    }
+
+    size_t index_padding() const { return (4 - index_bytes_ % 4) % 4; }
+    size_t vec3_bytes() const { return size_t(nverts_) * 3 * 4; }
+    size_t position_offset() const { return index_bytes_ + index_padding(); }
+    size_t buffer_bytes() const
+    {
+        return position_offset()
+            + vec3_bytes() * (1 + int(normals_) + int(colours_));
+    }
+};
+
+// Evaluate the gradient of the shape's distance field at each point,
+// in blocks, like get_colours. Returns false if the shape can't compute
+// exact gradients (see Shape::dist_grad_batch).
+bool get_gradients(
+    const curv::Shape& shape, const std::vector<glm::vec3>& points,
+    std::vector<glm::vec3>& grads, bool multithreaded)
+{
+    // An empty batch tells us if gradients are supported.
+    if (!shape.dist_grad_batch(nullptr, nullptr, nullptr, 0.0f, nullptr, 0))
+        return false;
+    constexpr size_t block_size = 256;
+    int nblocks = int((points.size() + block_size - 1) / block_size);
+    curv::Thread_Exception ex;
+    #pragma omp parallel for schedule(dynamic) if (multithreaded)
+    for (int b = 0; b < nblocks; ++b) ex.guard([&]{
+        float xs[block_size]{}, ys[block_size]{}, zs[block_size]{};
+        float out[4 * block_size];
+        size_t start = size_t(b) * block_size;
+        size_t n = std::min(block_size, points.size() - start);
+        for (size_t i = 0; i < n; ++i) {
+            xs[i] = points[start + i].x;
+            ys[i] = points[start + i].y;
+            zs[i] = points[start + i].z;
+        }
+        shape.dist_grad_batch(xs, ys, zs, 0.0f, out, n);
+        for (size_t i = 0; i < n; ++i)
+            grads[start + i] = glm::vec3(out[4*i+1], out[4*i+2], out[4*i+3]);
+    });
+    ex.rethrow();
+    return true;
 }
 
-void put_buffer(std::ostream& out, unsigned vertex_byte_size, Mesh& mesh)
+// Compute per-vertex normals. If the shape has exact gradients, the normal
+// is the gradient of the distance field at the vertex. Otherwise, or where
+// the gradient is zero or not finite, the normal is the sum of the
+// area-weighted normals of the triangles that share the vertex.
+std::vector<glm::vec3> get_vertex_normals(
+    const curv::Shape& shape, Mesh& mesh, const std::vector<glm::vec3>& verts,
+    bool multithreaded)
 {
-    const size_t vs = pad_buffer(vertex_byte_size, 4);
-    const size_t bs = vs + point_byte_size(mesh);
-    auto buff = std::make_unique<unsigned char []>(bs);
-    int offset = 0;
+    auto usable = [](glm::vec3 n) -> bool {
+        float len = glm::length(n);
+        return len > 0.0f && std::isfinite(len);
+    };
+    std::vector<glm::vec3> normals(verts.size(), glm::vec3(0.0f));
+    bool exact = get_gradients(shape, verts, normals, multithreaded);
+    if (!exact || !std::all_of(normals.begin(), normals.end(), usable)) {
+        std::vector<glm::vec3> sums(verts.size(), glm::vec3(0.0f));
+        mesh.all_triangles([&](const glm::ivec3& tri) -> void {
+            glm::vec3 v0 = verts[tri[0]];
+            glm::vec3 n = glm::cross(verts[tri[1]] - v0, verts[tri[2]] - v0);
+            sums[tri[0]] += n;
+            sums[tri[1]] += n;
+            sums[tri[2]] += n;
+        });
+        for (size_t i = 0; i < normals.size(); ++i) {
+            if (!exact || !usable(normals[i]))
+                normals[i] = sums[i];
+        }
+    }
+    for (auto& n : normals) {
+        n = usable(n) ? glm::normalize(n) : glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+    return normals;
+}
 
-    unsigned short *vbuff = (unsigned short*)buff.get();
-    mesh.all_triangles([&](const glm::vec3& tri)->void {
-        vbuff[offset] = tri[0];
-        vbuff[offset + 1] = tri[1];
-        vbuff[offset + 2] = tri[2];
-        offset += 3;
+// Write the binary buffer of a glTF file.
+void put_gltf_buffer(
+    Binary_Writer& w, const GLTF_Layout& layout,
+    Mesh& mesh, const std::vector<glm::vec3>& verts,
+    const std::vector<glm::vec3>& normals,
+    const std::vector<glm::vec3>& colours)
+{
+    mesh.all_triangles([&](const glm::ivec3& tri) -> void {
+        for (int i = 0; i < 3; ++i) {
+            if (layout.uint_indices_)
+                w.put_u32(tri[i]);
+            else
+                w.put_u16(tri[i]);
+        }
     });
+    for (size_t i = 0; i < layout.index_padding(); ++i)
+        w.put_u8(0);
+    for (auto& v : verts)
+        w.put_vec3(v);
+    if (layout.normals_) {
+        for (auto& n : normals)
+            w.put_vec3(n);
+    }
+    if (layout.colours_) {
+        // glTF vertex colours are linear RGB, the same as Curv colours.
+        for (auto& c : colours)
+            w.put_vec3(glm::clamp(c, 0.0f, 1.0f));
+    }
+}
 
-    float *pbuff = (float*)(buff.get() + vs);
-    for (unsigned i = 0; i < mesh.num_vertices(); ++i) {
-        auto pt = mesh.vertex(i);
-        offset = i * 3;
-        pbuff[offset] = pt.x;
-        pbuff[offset + 1] = pt.y;
-        pbuff[offset + 2] = pt.z;
+// Write the JSON part of a glTF file. If `uri` is not null, then the
+// buffer is stored in that URI, otherwise it is the binary chunk of
+// a GLB file.
+void put_gltf_json(
+    std::ostream& out, const GLTF_Layout& layout,
+    const std::vector<glm::vec3>& verts, const char* uri)
+{
+    glm::vec3 vmin(std::numeric_limits<float>::max());
+    glm::vec3 vmax(std::numeric_limits<float>::lowest());
+    for (auto& v : verts) {
+        vmin = glm::min(vmin, v);
+        vmax = glm::max(vmax, v);
     }
+    // The vertex attributes, in buffer order, after the indices.
+    std::vector<const char*> attrs{"POSITION"};
+    if (layout.normals_) attrs.push_back("NORMAL");
+    if (layout.colours_) attrs.push_back("COLOR_0");
 
-    auto str = base64_encode(buff.get(), bs);
-    out << str;
+    out << std::setprecision(9) <<
+    "{\n"
+    "  \"asset\": { \"version\": \"2.0\", \"generator\": \"Curv\" },\n"
+    "  \"scenes\": [{ \"nodes\": [0] }],\n"
+    "  \"nodes\": [{ \"mesh\": 0 }],\n"
+    "  \"meshes\": [{ \"primitives\": [{ \"indices\": 0, \"attributes\": {";
+    for (size_t i = 0; i < attrs.size(); ++i) {
+        out << (i > 0 ? ", " : " ")
+            << "\"" << attrs[i] << "\": " << i + 1;
+    }
+    out << " } }] }],\n"
+    "  \"bufferViews\": [\n"
+    "    {\n"
+    "      \"buffer\": 0,\n"
+    "      \"byteOffset\": 0,\n"
+    "      \"byteLength\": " << layout.index_bytes_ << ",\n"
+    "      \"target\": 34963\n" // ELEMENT_ARRAY_BUFFER
+    "    }";
+    for (size_t i = 0; i < attrs.size(); ++i) {
+        out << ",\n"
+        "    {\n"
+        "      \"buffer\": 0,\n"
+        "      \"byteOffset\": "
+            << layout.position_offset() + i * layout.vec3_bytes() << ",\n"
+        "      \"byteLength\": " << layout.vec3_bytes() << ",\n"
+        "      \"target\": 34962\n" // ARRAY_BUFFER
+        "    }";
+    }
+    out << "\n"
+    "  ],\n"
+    "  \"accessors\": [\n"
+    "    {\n"
+    "      \"bufferView\": 0,\n"
+    "      \"byteOffset\": 0,\n"
+    "      \"componentType\": "
+        << (layout.uint_indices_
+            ? "5125,\n"     // UNSIGNED_INT
+            : "5123,\n") << // UNSIGNED_SHORT
+    "      \"count\": " << size_t(layout.ntri_) * 3 << ",\n"
+    "      \"type\": \"SCALAR\",\n"
+    "      \"max\": [" << layout.max_index_ << "],\n"
+    "      \"min\": [" << layout.min_index_ << "]\n"
+    "    }";
+    for (size_t i = 0; i < attrs.size(); ++i) {
+        out << ",\n"
+        "    {\n"
+        "      \"bufferView\": " << i + 1 << ",\n"
+        "      \"byteOffset\": 0,\n"
+        "      \"componentType\": 5126,\n" // FLOAT
+        "      \"count\": " << layout.nverts_ << ",\n"
+        "      \"type\": \"VEC3\"";
+        if (i == 0) {
+            // POSITION accessors must have bounds.
+            out << ",\n"
+            "      \"max\": ["
+                << vmax.x << ", " << vmax.y << ", " << vmax.z << "],\n"
+            "      \"min\": ["
+                << vmin.x << ", " << vmin.y << ", " << vmin.z << "]";
+        }
+        out << "\n"
+        "    }";
+    }
+    out << "\n"
+    "  ],\n"
+    "  \"buffers\": [\n"
+    "    {\n"
+    "      \"byteLength\": " << layout.buffer_bytes();
+    if (uri)
+        out << ",\n      \"uri\": \"" << uri << "\"";
+    out << "\n"
+    "    }\n"
+    "  ]\n"
+    "}";
 }
 
 Mesh_Stats write_mesh(
     Mesh_Format format, Mesh& mesh, const curv::Shape& shape,
-    const Mesh_Export& opts, std::ostream& out)
+    bool multithreaded, const Mesh_Export& opts, std::ostream& out)
 {
     Mesh_Stats stats;
     stats.ntri = 0;
@@ -104,6 +424,56 @@ Mesh_Stats write_mesh(
         });
         out << "endsolid curv\n";
         break;
+    case Mesh_Format::stl_binary:
+      {
+        // An 80 byte header (which must not begin with "solid"),
+        // the triangle count, then 50 bytes per triangle.
+        mesh.all_triangles([&](const glm::ivec3&)->void {
+            ++stats.ntri;
+        });
+        auto verts = get_vertices(mesh);
+        Binary_Writer w(out);
+        char header[80] = "binary STL file, generated by Curv";
+        w.put_bytes(header, sizeof(header));
+        w.put_u32(stats.ntri);
+        mesh.all_triangles([&](const glm::ivec3& tri) -> void {
+            glm::vec3 v0 = verts[tri[0]];
+            glm::vec3 v1 = verts[tri[1]];
+            glm::vec3 v2 = verts[tri[2]];
+            w.put_vec3(glm::normalize(glm::cross(v1 - v0, v2 - v0)));
+            w.put_vec3(v0);
+            w.put_vec3(v1);
+            w.put_vec3(v2);
+            w.put_u16(0); // attribute byte count
+        });
+        break;
+      }
+    case Mesh_Format::ply:
+      {
+        mesh.all_triangles([&](const glm::ivec3&)->void {
+            ++stats.ntri;
+        });
+        out << "ply\n"
+               "format binary_little_endian 1.0\n"
+               "comment generated by Curv\n"
+               "element vertex " << mesh.num_vertices() << "\n"
+               "property float x\n"
+               "property float y\n"
+               "property float z\n"
+               "element face " << stats.ntri << "\n"
+               "property list uchar uint vertex_indices\n"
+               "end_header\n";
+        Binary_Writer w(out);
+        for (unsigned i = 0; i < mesh.num_vertices(); ++i)
+            w.put_vec3(mesh.vertex(i));
+        mesh.all_triangles([&](const glm::ivec3& tri) -> void {
+            w.put_u8(3);
+            w.put_u32(tri[0]);
+            w.put_u32(tri[1]);
+            w.put_u32(tri[2]);
+        });
+        break;
+      }
     case Mesh_Format::obj:
         for (unsigned int i = 0; i < mesh.num_vertices(); ++i) {
             auto pt = mesh.vertex(i);
@@ -157,21 +527,19 @@ Mesh_Stats write_mesh(
         out <<
         "\"/>\n"
         "    <Color color=\"";
+        auto verts = get_vertices(mesh);
+        std::vector<glm::vec3> colours;
         switch (opts.colouring_) {
         case Mesh_Export::face_colour:
-            mesh.all_triangles([&](const glm::vec3& tri)->void {
-                put_face_colour(out, shape,
-                    mesh.vertex(tri[0]),
-                    mesh.vertex(tri[1]),
-                    mesh.vertex(tri[2]));
-            });
+            colours = get_colours(shape, get_centroids(mesh, verts),
+                multithreaded);
             break;
         case Mesh_Export::vertex_colour:
-            for (unsigned int i = 0; i < mesh.num_vertices(); ++i) {
-                put_vertex_colour(out, shape, mesh.vertex(i));
-            }
+            colours = get_colours(shape, verts, multithreaded);
             break;
         }
+        for (auto& c : colours)
+            put_colour(out, c);
         out <<
         "\"/>\n"
         "   </IndexedFaceSet>\n"
@@ -182,71 +550,62 @@ Mesh_Stats write_mesh(
       }
     case Mesh_Format::gltf:
       {
-        mesh.all_triangles([&](const glm::vec3)->void {
-            ++stats.ntri;
-        });
-        unsigned vertex_byte_size = stats.ntri*6; /*3 vertices, 2 bytes per index*/
-        float minx, miny, minz, maxx, maxy, maxz;
-        minx = miny = minz = std::numeric_limits<float>::max();
-        maxx = maxy = maxz = std::numeric_limits<float>::min();
-        for (unsigned i=0; i < mesh.num_vertices(); ++i) {
-            auto pt = mesh.vertex(i);
-            minx = std::min(pt.x, minx);
-            miny = std::min(pt.y, miny);
-            minz = std::min(pt.z, minz);
-            maxx = std::max(pt.x, maxx);
-            maxy = std::max(pt.y, maxy);
-            maxz = std::max(pt.z, maxz);
+        GLTF_Layout layout(mesh, opts);
+        stats.ntri = layout.ntri_;
+        auto verts = get_vertices(mesh);
+        std::vector<glm::vec3> normals;
+        if (layout.normals_)
+            normals = get_vertex_normals(shape, mesh, verts, multithreaded);
+        std::vector<glm::vec3> colours;
+        if (layout.colours_)
+            colours = get_colours(shape, verts, multithreaded);
+        std::ostringstream bin;
+        {
+            Binary_Writer w(bin);
+            put_gltf_buffer(w, layout, mesh, verts, normals, colours);
         }
-        out << std::setprecision(16) <<
-        "{\n"
-        "  \"asset\": { \"version\": \"2.0\" },\n"
-        "  \"scenes\": [{ \"nodes\": [0] }],\n"
-        "  \"nodes\": [{ \"mesh\": 0 }],\n"
-        "  \"meshes\": [{ \"primitives\": [{ \"indices\": 0, \"attributes\": { \"POSITION\": 1 } }] }],\n"
-        "  \"bufferViews\": [\n"
-        "    {\n"
-        "      \"buffer\": 0,\n"
-        "      \"byteOffset\": 0,\n"
-        "      \"byteLength\": " << vertex_byte_size << ",\n"
-        "      \"target\": 34963\n" // ELEMENT_ARRAY_BUFFER
-        "    },\n"
-        "    {\n"
-        "      \"buffer\": 0,\n"
-        "      \"byteOffset\": " << pad_buffer(vertex_byte_size, 4) << ",\n"
-        "      \"byteLength\": " << point_byte_size(mesh) << " ,\n"
-        "      \"target\": 34962\n" // ARRAY_BUFFER
-        "    }\n"
-        "  ],\n"
-        "  \"accessors\": [\n"
-        "    {\n"
-        "      \"bufferView\": 0,\n"
-        "      \"byteOffset\": 0,\n"
-        "      \"componentType\": 5123,\n" // UNSIGNED_SHORT
-        "      \"count\": " << stats.ntri * 3 << ",\n"
-        "      \"type\": \"SCALAR\",\n"
-        "      \"max\": [" << mesh.num_vertices() - 1 << "],\n"
-        "      \"min\": [0]\n"
-        "    },\n"
-        "    {\n"
-        "      \"bufferView\": 1,\n"
-        "      \"byteOffset\": 0,\n"
-        "      \"componentType\": 5126,\n" // FLOAT
-        "      \"count\": " << mesh.num_vertices() << ",\n"
-        "      \"type\": \"VEC3\",\n"
-        "      \"max\": [" << maxx << ", " << maxy << ", " << maxz << "],\n"
-        "      \"min\": [" << minx << ", " << miny << ", " << minz << "]\n"
-        "    }\n"
-        "  ],\n"
-        "  \"buffers\": [\n"
-        "    {\n"
-        "      \"byteLength\": " << pad_buffer(vertex_byte_size, 4) + point_byte_size(mesh) << ",\n"
-        "      \"uri\": \"data:application/octet-stream;base64,";
-        put_buffer(out, vertex_byte_size, mesh);
-        out << "\"\n"
-        "    }\n"
-        "  ]\n"
-        "}";
+        std::string data = bin.str();
+        std::string uri = "data:application/octet-stream;base64,"
+            + base64_encode((const unsigned char*)data.data(), data.size());
+        put_gltf_json(out, layout, verts, uri.c_str());
+        break;
+      }
+    case Mesh_Format::glb:
+      {
+        // A GLB file is a 12 byte header followed by a JSON chunk and
+        // a binary chunk. The binary chunk is written directly from the
+        // mesh, without an intermediate copy.
+        GLTF_Layout layout(mesh, opts);
+        stats.ntri = layout.ntri_;
+        auto verts = get_vertices(mesh);
+        std::vector<glm::vec3> normals;
+        if (layout.normals_)
+            normals = get_vertex_normals(shape, mesh, verts, multithreaded);
+        std::vector<glm::vec3> colours;
+        if (layout.colours_)
+            colours = get_colours(shape, verts, multithreaded);
+        std::ostringstream json_out;
+        put_gltf_json(json_out, layout, verts, nullptr);
+        std::string json = json_out.str();
+        // Chunks must be 4 byte aligned: pad the JSON with spaces.
+        json.append((4 - json.size() % 4) % 4, ' ');
+        size_t bin_bytes = layout.buffer_bytes(); // a multiple of 4
+        size_t glb_bytes = 12 + 8 + json.size() + 8 + bin_bytes;
+        if (glb_bytes > UINT32_MAX) {
+            throw Exception_Base(stringify(
+                "GLB export: mesh is too large (", glb_bytes,
+                " bytes, the limit is 4GiB)"));
+        }
+        Binary_Writer w(out);
+        w.put_u32(0x46546C67); // magic: "glTF"
+        w.put_u32(2); // version
+        w.put_u32(uint32_t(glb_bytes));
+        w.put_u32(uint32_t(json.size()));
+        w.put_u32(0x4E4F534A); // chunk type: "JSON"
+        w.put_bytes(json.data(), json.size());
+        w.put_u32(uint32_t(bin_bytes));
+        w.put_u32(0x004E4942); // chunk type: "BIN"
+        put_gltf_buffer(w, layout, mesh, verts, normals, colours);
         break;
       }
     default:
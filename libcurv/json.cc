@@ -81,6 +81,17 @@ void write_json_value(Value val, std::ostream& out)
             out << "]";
             return;
           }
+        case Ref_Value::sty_num_array:
+          {
+            auto& na = (Num_Array&)ref;
+            out << "[";
+            for (size_t i = 0; i < na.size(); ++i) {
+                if (i > 0) out << ",";
+                out << dfmt(na[i], dfmt::JSON);
+            }
+            out << "]";
+            return;
+          }
         }
     case Ref_Value::ty_record:
       {
@@ -0,0 +1,336 @@
+// Copyright 2016-2021 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/library.h>
+
+#include <libcurv/context.h>
+#include <libcurv/filesystem.h>
+#include <libcurv/meanings.h>
+#include <libcurv/module.h>
+#include <libcurv/parser.h>
+#include <libcurv/phrase.h>
+#include <libcurv/program.h>
+#include <libcurv/scanner.h>
+#include <libcurv/system.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#include <unistd.h>
+
+namespace curv {
+
+// Increment this when the format of the index, or the way it is computed,
+// changes, so that stale cached indexes are ignored.
+static const char index_magic[] = "curv-library-index 2";
+
+static bool is_ident_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+static bool is_ident_char(char c)
+{
+    return is_ident_start(c) || (c >= '0' && c <= '9');
+}
+
+bool
+Library_Index::build(const Source& src, System& sys)
+{
+    Source_State sstate{sys, nullptr};
+    Scanner scanner{share(src), sstate};
+    Shared<const Phrase> body = parse_program(scanner);
+    if (auto program = cast<const Program_Phrase>(body))
+        body = program->body_;
+    auto brace = cast<const Brace_Phrase>(body);
+    if (brace == nullptr)
+        return false;
+    std::vector<Shared<const Phrase>> items;
+    if (auto semis = cast<const Semicolon_Phrase>(brace->body_)) {
+        for (auto& arg : semis->args_)
+            items.push_back(arg.expr_);
+    } else
+        items.push_back(brace->body_);
+
+    std::unordered_map<std::string, unsigned> names;
+    for (auto& item : items) {
+        if (isa<const Empty_Phrase>(item))
+            continue;
+        // Only `name = ...` and `name args... = ...` are supported.
+        auto def = cast<const Recursive_Definition_Phrase>(item);
+        if (def == nullptr)
+            return false;
+        Shared<const Phrase> left = def->left_;
+        while (auto call = cast<const Call_Phrase>(left)) {
+            if (!call->is_juxta())
+                return false;
+            left = call->function_;
+        }
+        auto id = cast<const Identifier>(left);
+        if (id == nullptr)
+            return false;
+        std::string name = id->symbol_.c_str();
+        if (name.find('\n') != std::string::npos
+            || !names.emplace(name, unsigned(entries_.size())).second)
+        {
+            return false;
+        }
+        Token tok = item->location().token();
+        entries_.push_back({name, tok.first_, tok.last_, 0, 0, {}});
+    }
+
+    // The definitions are in source order, so their positions are found
+    // in one pass over the text.
+    unsigned pos = 0, line = 0, line_start = 0;
+    for (auto& e : entries_) {
+        for (; pos < e.first_; ++pos) {
+            if (src.first[pos] == '\n') {
+                ++line;
+                line_start = pos + 1;
+            }
+        }
+        e.line_ = line;
+        e.column_ = e.first_ - line_start;
+    }
+
+    // An entry depends on each top level name that occurs in its source
+    // text. Scanning the text (including strings and comments) finds a
+    // superset of the real dependencies, which is safe.
+    for (unsigned i = 0; i < entries_.size(); ++i) {
+        auto& e = entries_[i];
+        const char* p = src.first + e.first_;
+        const char* end = src.first + e.last_;
+        while (p < end) {
+            std::string word;
+            if (*p == '\'') {
+                // A quoted identifier. The quote may also be an apostrophe
+                // in a string, so keep scanning after it.
+                const char* q = (const char*)memchr(p+1, '\'', end-p-1);
+                if (q != nullptr)
+                    word.assign(p+1, q);
+                ++p;
+            } else if (is_ident_start(*p)) {
+                const char* q = p;
+                while (q < end && is_ident_char(*q))
+                    ++q;
+                word.assign(p, q);
+                p = q;
+            } else {
+                ++p;
+                continue;
+            }
+            auto n = names.find(word);
+            if (n != names.end() && n->second != i) {
+                bool dup = false;
+                for (auto d : e.deps_)
+                    if (d == n->second) dup = true;
+                if (!dup)
+                    e.deps_.push_back(n->second);
+            }
+        }
+    }
+    return true;
+}
+
+bool
+Library_Index::read(std::istream& in)
+{
+    std::string line;
+    if (!std::getline(in, line) || line != index_magic)
+        return false;
+    size_t n;
+    if (!(in >> n))
+        return false;
+    entries_.resize(n);
+    for (auto& e : entries_) {
+        size_t ndeps;
+        if (!(in >> e.first_ >> e.last_ >> e.line_ >> e.column_ >> ndeps))
+            return false;
+        e.deps_.resize(ndeps);
+        for (auto& d : e.deps_) {
+            if (!(in >> d) || d >= n)
+                return false;
+        }
+        in.get(); // space before the name
+        if (!std::getline(in, e.name_) || e.name_.empty())
+            return false;
+    }
+    return true;
+}
+
+void
+Library_Index::write(std::ostream& out) const
+{
+    out << index_magic << "\n" << entries_.size() << "\n";
+    for (auto& e : entries_) {
+        out << e.first_ << " " << e.last_ << " " << e.line_ << " "
+            << e.column_ << " " << e.deps_.size();
+        for (auto d : e.deps_)
+            out << " " << d;
+        out << " " << e.name_ << "\n";
+    }
+}
+
+// Cached indexes are named by a 64 bit FNV-1a hash of the source text.
+// The source text follows the index in the cache file, and the index is
+// only used if the text is identical, so a hash collision is harmless.
+static Filesystem::path
+index_cache_path(const Source& src)
+{
+    const char* enable = getenv("CURV_LIB_CACHE");
+    if (enable != nullptr && strcmp(enable, "0") == 0)
+        return {};
+    Filesystem::path dir = cache_dir("lib");
+    if (dir.empty())
+        return {};
+    std::uint64_t h = 14695981039346656037ULL;
+    for (char c : src)
+        h = (h ^ (unsigned char)c) * 1099511628211ULL;
+    char key[40];
+    snprintf(key, sizeof(key), "%016llx-%zu.idx",
+        (unsigned long long)h, src.size());
+    return dir / key;
+}
+
+static bool
+read_cached_index(std::istream& in, Library_Index& index, const Source& src)
+{
+    if (!index.read(in) || in.get() != '\n')
+        return false;
+    std::string text{std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>()};
+    return text.size() == src.size()
+        && memcmp(text.data(), src.first, src.size()) == 0;
+}
+
+Shared<Library>
+Library::make_lazy(Shared<const String_Source> source, System_Impl& sys)
+{
+    auto lib = make<Library>(source, sys);
+    auto& index = lib->index_;
+    auto cache = index_cache_path(*source);
+    bool cached = false;
+    if (!cache.empty()) {
+        std::ifstream in(cache, std::ios::binary);
+        cached = in && read_cached_index(in, index, *source);
+    }
+    if (!cached) {
+        index.entries_.clear();
+        if (!index.build(*source, sys))
+            return nullptr;
+        if (!cache.empty()) {
+            // Write a temporary file, then rename it, so that concurrent
+            // curv processes never read a partially written index.
+            auto tmp = cache;
+            tmp += stringify(".", getpid(), ".tmp")->c_str();
+            std::error_code err;
+            {
+                std::ofstream out(tmp, std::ios::binary);
+                index.write(out);
+                out << "\n";
+                out.write(source->first, source->size());
+                if (!out)
+                    err = std::make_error_code(std::errc::io_error);
+            }
+            if (!err)
+                Filesystem::rename(tmp, cache, err);
+            if (err)
+                Filesystem::remove(tmp, err);
+        }
+    }
+    lib->values_.resize(index.entries_.size());
+    lib->loaded_.resize(index.entries_.size());
+    return lib;
+}
+
+Value
+Library::get(unsigned i)
+{
+    if (!loaded_[i])
+        load(i);
+    return values_[i];
+}
+
+// True if the std_namespace still binds the name of entry i to this entry,
+// so that code compiled later can refer to entry i through the namespace.
+bool
+Library::is_bound(unsigned i) const
+{
+    auto& ns = system_.std_namespace_;
+    auto b = ns.find(make_symbol(index_.entries_[i].name_));
+    if (b == ns.end())
+        return false;
+    auto lb = dynamic_cast<const Library_Binding*>(&*b->second);
+    return lb != nullptr && lb->library_ == this && lb->index_ == i;
+}
+
+// Compile entry i, together with the entries it depends on, except for
+// those that are already loaded and can be referenced via the std_namespace.
+void
+Library::load(unsigned i)
+{
+    auto& entries = index_.entries_;
+    std::vector<bool> include(entries.size(), false);
+    std::vector<unsigned> todo{i};
+    include[i] = true;
+    while (!todo.empty()) {
+        unsigned j = todo.back();
+        todo.pop_back();
+        for (auto d : entries[j].deps_) {
+            if (!include[d] && !(loaded_[d] && is_bound(d))) {
+                include[d] = true;
+                todo.push_back(d);
+            }
+        }
+    }
+
+    // Build a module containing the included definitions. Each definition
+    // is padded out to its original line and column.
+    std::string text = "{";
+    unsigned line = 0, column = 1;
+    for (unsigned j = 0; j < entries.size(); ++j) {
+        if (!include[j]) continue;
+        auto& e = entries[j];
+        if (e.line_ > line) {
+            text.append(e.line_ - line, '\n');
+            line = e.line_;
+            column = 0;
+        }
+        if (e.column_ > column) {
+            text.append(e.column_ - column, ' ');
+            column = e.column_;
+        }
+        for (unsigned k = e.first_; k < e.last_; ++k) {
+            char c = source_->first[k];
+            text += c;
+            if (c == '\n') {
+                ++line;
+                column = 0;
+            } else
+                ++column;
+        }
+        text += ';';
+        ++column;
+    }
+    text += "\n}\n";
+    Program prog{system_};
+    prog.compile(make<String_Source>(source_->name_, make_string(text)));
+    At_Program cx(prog);
+    auto module = prog.eval().to<Module>(cx);
+    for (unsigned j = 0; j < entries.size(); ++j) {
+        if (include[j]) {
+            values_[j] = module->getfield(make_symbol(entries[j].name_), cx);
+            loaded_[j] = true;
+        }
+    }
+}
+
+Shared<Meaning>
+Library_Binding::to_meaning(const Identifier& id) const
+{
+    return make<Constant>(share(id), library_->get(index_));
+}
+
+} // namespace curv
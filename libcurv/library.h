@@ -0,0 +1,88 @@
+// Copyright 2016-2021 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef LIBCURV_LIBRARY_H
+#define LIBCURV_LIBRARY_H
+
+#include <libcurv/builtin.h>
+#include <libcurv/source.h>
+#include <string>
+#include <vector>
+
+namespace curv {
+
+struct System_Impl;
+
+// A library (like std.curv) is a source file containing a module of
+// definitions, whose fields are added to the std_namespace.
+//
+// A library is loaded lazily. Analysing and evaluating all of std.curv
+// dominates the startup time of a short curv command, and most programs
+// use a small fraction of it. Instead, a Library_Binding is added to the
+// std_namespace for each definition, and the first time it is referenced,
+// the definition is compiled together with the definitions it depends on.
+// Only the text of those definitions is compiled. Each one is placed at its
+// original line and column, so that source locations in error messages are
+// unchanged.
+//
+// The Library_Index records each definition's name, source range, position
+// and dependencies. Building it requires parsing the library, so it is cached
+// in $XDG_CACHE_HOME/curv/lib (or ~/.cache/curv/lib). The cache file is
+// named by a hash of the source text, and also contains a copy of the source,
+// so that a stale index is detected and rebuilt when the library changes.
+// Set CURV_LIB_CACHE=0 to disable the cache.
+struct Library_Index
+{
+    struct Entry
+    {
+        std::string name_;
+        unsigned first_, last_;     // source range of the definition
+        unsigned line_, column_;    // position of first_, counting from 0
+        std::vector<unsigned> deps_; // other entries that it refers to
+    };
+    std::vector<Entry> entries_;
+
+    // Build the index by parsing the library. Return false if the library
+    // isn't a module of simple definitions, and must be loaded eagerly.
+    bool build(const Source&, System&);
+
+    bool read(std::istream&);
+    void write(std::ostream&) const;
+};
+
+struct Library : public Shared_Base
+{
+    System_Impl& system_;
+    Shared<const String_Source> source_;
+    Library_Index index_;
+    std::vector<Value> values_;
+    std::vector<bool> loaded_;
+
+    // Return nullptr if the library can't be loaded lazily.
+    static Shared<Library> make_lazy(Shared<const String_Source>, System_Impl&);
+
+    Library(Shared<const String_Source> source, System_Impl& sys)
+    : system_(sys), source_(std::move(source))
+    {}
+
+    // Return the value of the i'th definition, compiling it if necessary.
+    Value get(unsigned i);
+private:
+    bool is_bound(unsigned i) const;
+    void load(unsigned i);
+};
+
+// The std_namespace entry for a lazily loaded library definition.
+struct Library_Binding : public Builtin
+{
+    Shared<Library> library_;
+    unsigned index_;
+    Library_Binding(Shared<Library> lib, unsigned i)
+    : library_(std::move(lib)), index_(i)
+    {}
+    virtual Shared<Meaning> to_meaning(const Identifier&) const override;
+};
+
+} // namespace curv
+#endif // header guard
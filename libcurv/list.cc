@@ -89,6 +89,20 @@ void Generic_List::amend_at(size_t i, Value newval, const At_Syntax& cx)
         }
         get_boxed_list().at(i) = newval;
     }
+    else if (this->is_num_array()) {
+        if (newval.is_num()) {
+            if (list_->use_count > 1) {
+                auto& na = get_num_array();
+                list_ = copy_tail_array<Num_Array>(na.begin(), na.size());
+            }
+            get_num_array().at(i) = newval.to_num_unsafe();
+        } else {
+            // The list now contains a non-number, so it must be boxed.
+            auto li = get_num_array().to_list();
+            li->at(i) = newval;
+            list_ = move(li);
+        }
+    }
     else if (this->is_string()) {
         if (newval.is_char()) {
             if (list_->use_count > 1) {
@@ -123,6 +137,62 @@ Ternary Abstract_List::aequal(Abstract_List& a, const Context& cx) const
 
 const char List_Base::name[] = "list";
 const char Abstract_List::name[] = "list";
+const char Num_Array_Base::name[] = "list";
+
+Shared<List>
+Num_Array_Base::to_list() const
+{
+    auto list = make_tail_array<List>(size_);
+    for (size_t i = 0; i < size_; ++i)
+        list->at(i) = Value{array_[i]};
+    return list;
+}
+
+Shared<const List>
+unpack_list(Value val, const Context& cx)
+{
+    return unpack_list(val, Fail::hard, cx);
+}
+Shared<const List>
+unpack_list(Value val, Fail fl, const Context& cx)
+{
+    if (auto na = val.maybe<const Num_Array>())
+        return na->to_list();
+    return val.to<const List>(fl, cx);
+}
+
+void
+Num_Array_Base::print_repr(std::ostream& out, Prec rprec) const
+{
+    // Same output as List_Base::print_repr.
+    open_paren(out, rprec, Prec::sum);
+    out << '[';
+    for (size_t i = 0; i < size_; ++i) {
+        if (i > 0) out << ',';
+        Value{array_[i]}.print_repr(out, Prec::item);
+    }
+    out << ']';
+    close_paren(out, rprec, Prec::sum);
+}
+
+void
+Num_Array_Base::print_string(std::ostream& out) const
+{
+    print_repr(out, Prec::item);
+}
+
+Shared<Num_Array> maybe_pack(const Value* elems, size_t n)
+{
+    if (n < Num_Array::min_packed)
+        return nullptr;
+    for (size_t i = 0; i < n; ++i)
+        if (!elems[i].is_num())
+            return nullptr;
+    auto na = make_tail_array<Num_Array>(n);
+    for (size_t i = 0; i < n; ++i)
+        na->at(i) = elems[i].to_num_unsafe();
+    return na;
+}
 
 void
 List_Base::assert_size(size_t sz, const Context& cx)
@@ -231,7 +301,7 @@ void List_Builder::push_back(Value val)
             list_.push_back({c});
         in_string_ = false;
     }
-    list_.push_back(val);
+    list_.push_back(move(val));
 }
 
 void List_Builder::concat(Value val, const Context& cx)
@@ -244,6 +314,14 @@ void List_Builder::concat(Value val, const Context& cx)
             for (auto c : *strval)
                 list_.push_back({c});
         }
+    } else if (auto na = val.maybe<Num_Array>()) {
+        if (in_string_) {
+            for (auto c : string_)
+                list_.push_back({c});
+            in_string_ = false;
+        }
+        for (double n : *na)
+            list_.push_back({n});
     } else if (auto listval = val.maybe<List>()) {
         if (listval->empty()) return;
         // A non-empty List is unlikely to contain only characters,
@@ -254,7 +332,14 @@ void List_Builder::concat(Value val, const Context& cx)
                 list_.push_back({c});
             in_string_ = false;
         }
-        list_.insert(list_.end(), listval->begin(), listval->end());
+        if (listval->use_count == 2) {
+            // val and listval are the only references, so the elements
+            // can be moved instead of copied.
+            list_.insert(list_.end(),
+                std::make_move_iterator(listval->begin()),
+                std::make_move_iterator(listval->end()));
+        } else
+            list_.insert(list_.end(), listval->begin(), listval->end());
     } else {
         throw Exception(cx, stringify(val, "is not a list"));
     }
@@ -267,6 +352,8 @@ Value List_Builder::get_value()
             return {make_tail_array<List>(0)};
         return {make_string(string_)};
     }
+    if (auto na = maybe_pack(list_.data(), list_.size()))
+        return {na};
     Shared<List> result = move_tail_array<List>(list_);
     return {result};
 }
@@ -46,6 +46,7 @@ struct List : public Tail_Array<List_Base>
 {
     using Tail_Array<List_Base>::Tail_Array;
 };
+template<> struct Ref_Tag<List> : Ref_Subtype_Tag<Ref_Value::sty_list> {};
 
 inline std::ostream&
 operator<<(std::ostream& out, const List_Base& list)
@@ -60,6 +61,60 @@ inline Shared<List> make_list(size_t size)
     return {move(list)};
 }
 
+// Packed list of numbers, stored as a contiguous array of doubles.
+//
+// List_Builder and the array operations in prim.h construct a Num_Array for
+// a list of at least `min_packed` numbers. Array operations on a Num_Array
+// run tight loops over the doubles, instead of unboxing each element.
+// A Num_Array is converted to a List when a non-number is stored into it,
+// or when it is passed to code that requires a List (see unpack_list).
+struct Num_Array;
+struct Num_Array_Base : public Abstract_List
+{
+    Num_Array_Base() : Abstract_List(sty_num_array) {}
+    virtual Value val_at(size_t i) const override { return {array_[i]}; }
+    virtual void print_repr(std::ostream&, Prec) const override;
+    virtual void print_string(std::ostream&) const override;
+
+    // Copy the elements into a List.
+    Shared<List> to_list() const;
+
+    static constexpr size_t min_packed = 32;
+    static const char name[];
+    TAIL_ARRAY_MEMBERS_MOD_SIZE(double)
+};
+struct Num_Array : public Tail_Array<Num_Array_Base>
+{
+    using Tail_Array<Num_Array_Base>::Tail_Array;
+};
+template<> struct Ref_Tag<Num_Array>
+: Ref_Subtype_Tag<Ref_Value::sty_num_array> {};
+
+// If the elements are all numbers, and there are at least
+// Num_Array::min_packed of them, return them as a Num_Array.
+// Otherwise return nullptr.
+Shared<Num_Array> maybe_pack(const Value* elems, size_t n);
+
+// If `a` has a single owner (the caller's reference), return it, so that
+// the caller can overwrite its elements in place. Otherwise return a new
+// array of the same size. Used by array operations to reuse an argument
+// that is a temporary value, instead of allocating the result.
+template <class A>
+inline Shared<A> reuse_tail_array(A& a)
+{
+    if (a.use_count == 1)
+        return share(a);
+    return make_tail_array<A>(a.size());
+}
+
+// Value::maybe<List> and Value::to<List> only match a boxed List. Code that
+// requires a List (because it iterates over array_) and isn't performance
+// critical calls unpack_list instead, which also accepts a Num_Array by
+// copying its elements into a new List. Hot paths (indexing, iteration,
+// amend) handle a Num_Array directly, or use Generic_List.
+Shared<const List> unpack_list(Value, const Context&);
+Shared<const List> unpack_list(Value, Fail, const Context&);
+
 // A Generic_List is any Curv value that denotes a sequence of values.
 // Lists have multiple representations, and Generic_List abstracts over
 // all of those representations.
@@ -86,6 +141,9 @@ private:
     bool is_string() const {
         return list_->subtype_ == Ref_Value::sty_string;
     }
+    bool is_num_array() const {
+        return list_->subtype_ == Ref_Value::sty_num_array;
+    }
     bool is_reactive_value() const {
         return list_->type_ == Ref_Value::ty_reactive;
     }
@@ -98,6 +156,9 @@ private:
     String& get_string() {
         return *(String*)(&*list_);
     }
+    Num_Array& get_num_array() {
+        return *(Num_Array*)(&*list_);
+    }
     Reactive_Value& get_reactive_value() const {
         return *(Reactive_Value*)(&*list_);
     }
@@ -123,10 +184,11 @@ public:
 };
 
 // Factory class for making a Curv Abstract_List value,
-// constructing a curv::List or curv::String depending on data.
+// constructing a curv::List, curv::String or curv::Num_Array depending on data.
 // Each Curv list value has a single canonical representation:
 //  * an empty list is a curv::List
 //  * a non-empty list containing only characters is a curv::String
+//  * a list of Num_Array::min_packed or more numbers is a curv::Num_Array
 //  * otherwise, a curv::List
 //
 // TODO: reserve_next(n) specifies how many elements are about to be added
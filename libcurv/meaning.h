@@ -151,10 +151,10 @@ operator<<(std::ostream& out, const Operation& op)
 
 // A Locative is the phrase on the left side of an assignment statement.
 //
-// TODO: Efficient indexed update using "linear logic".
+// Efficient indexed update using "linear logic":
 // For indexed update, we move the value out of the location (without changing
-// its reference count), use COW to amend the moved value, then store().
-// We need a 'steal' or 'fetch_move' operation.
+// its reference count) using fetch_move(), use COW to amend the moved value
+// (which is done in place if the use_count is 1), then store().
 struct Locative
 {
     Locative(Shared<const Phrase> syntax)
@@ -165,6 +165,9 @@ struct Locative
     Shared<const Phrase> syntax_;
 
     virtual Value fetch(Frame&) const = 0;
+    // Like fetch(), but the location may be left empty, to be followed by
+    // a store().
+    virtual Value fetch_move(Frame& fm) const { return fetch(fm); }
     virtual void store(Frame&, Value, const At_Syntax&) const = 0;
     virtual SC_Type sc_print(SC_Frame&) const;
 };
@@ -802,6 +802,14 @@ struct Dot_Expr : public Just_Expression
     Shared<Operation> base_;
     Symbol_Expr selector_;
 
+    // A monomorphic inline cache. If the record has the layout (for a DRecord)
+    // or the dictionary (for a Module) that was seen last time, and the field
+    // name is the same, then the field's slot index is ic_slot_.
+    // The cache isn't updated during a parallel evaluation.
+    mutable Shared<const Shared_Base> ic_layout_;
+    mutable Symbol_Ref ic_name_;
+    mutable slot_t ic_slot_ = 0;
+
     Dot_Expr(
         Shared<const Phrase> syntax,
         Shared<Operation> base,
@@ -861,6 +869,7 @@ struct Local_Locative : public Locative
     slot_t slot_;
 
     virtual Value fetch(Frame&) const override;
+    virtual Value fetch_move(Frame&) const override;
     virtual void store(Frame&, Value, const At_Syntax&) const override;
     virtual SC_Type sc_print(SC_Frame&) const override;
 };
@@ -147,6 +147,7 @@ struct Module : public Tail_Array<Module_Base>
 {
     using Tail_Array<Module_Base>::Tail_Array;
 };
+template<> struct Ref_Tag<Module> : Ref_Subtype_Tag<Ref_Value::sty_module> {};
 
 } // namespace curv
 #endif // header guard
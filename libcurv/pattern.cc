@@ -169,7 +169,7 @@ struct Predicate_Pattern : public Pattern
             return type->contains(arg, cx);
         }
         if (auto fun = maybe_function(val, cx)) {
-            std::unique_ptr<Frame> f2 = make_tail_array<Frame>(fun->nslots_,
+            std::unique_ptr<Frame> f2 = Frame::make(fun->nslots_,
                 fm.sstate_, &fm, fm.func_, call_phrase());
             auto result = fun->call(arg, Fail::hard, *f2);
             return result.to_bool(At_Phrase(*call_phrase(), fm));
@@ -604,7 +604,7 @@ record_pattern_default_value(const Pattern& pat, Frame& fm)
     auto drec = make<DRecord>();
     for (auto& i : rpat->fields_) {
         if (i.second.dexpr_)
-            drec->fields_[i.first] = i.second.dexpr_->eval(fm);
+            drec->set(i.first, i.second.dexpr_->eval(fm));
         else
             throw Exception(At_Phrase(*i.second.syntax_,fm),
                 "field pattern has no default value");
@@ -617,7 +617,7 @@ record_pattern_each_parameter(
     const Closure& call, Source_State& sstate,
     std::function<void(Symbol_Ref, Value, Value, Shared<const Phrase>)> f)
 {
-    auto frame = make_tail_array<Frame>(call.nslots_,
+    auto frame = Frame::make(call.nslots_,
         sstate, nullptr, nullptr, nullptr);
     auto rpat = dynamic_cast<const Record_Pattern*>(&*call.pattern_);
     if (rpat == nullptr)
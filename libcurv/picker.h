@@ -66,6 +66,8 @@ struct Uniform_Variable : public Reactive_Value
     virtual void print_repr(std::ostream&, Prec) const override;
     virtual Shared<Operation> expr() const override;
 };
+template<> struct Ref_Tag<Uniform_Variable>
+: Ref_Subtype_Tag<Ref_Value::sty_uniform_variable> {};
 
 } // namespace curv
 #endif // header guard
@@ -23,6 +23,7 @@
 #include <libcurv/sc_compiler.h>
 #include <libcurv/sc_context.h>
 #include <libcurv/vec.h>
+#include <type_traits>
 
 namespace curv {
 
@@ -104,10 +105,30 @@ struct Binary_Op_Expr : public Infix_Expr_Base
 // Templates for converting a Prim to a unary or binary Array_Op //
 //---------------------------------------------------------------//
 
+// An array operation on packed lists has computed the numbers done[0..i),
+// then found a result that isn't a number. Return a List containing those
+// numbers, followed by the elements [i..size) computed by `f` using the
+// general case. `done` may be one of the arguments, updated in place, so
+// only its elements [i..size) are still argument values.
+template <class F>
+Value finish_boxed(const Num_Array& done, size_t i, F f)
+{
+    size_t n = done.size();
+    Shared<List> list = make_tail_array<List>(n);
+    for (size_t j = 0; j < i; ++j)
+        (*list)[j] = {done[j]};
+    for (; i < n; ++i) {
+        TRY_DEF(r, f(i));
+        (*list)[i] = r;
+    }
+    return {list};
+}
+
 template <class PRIM>
 struct Unary_Array_Op
 {
-    // TODO: optimize: move semantics. unique object reuse.
+    // If the list argument is a temporary (use_count==1), the results are
+    // stored in place, instead of allocating a new list.
 
     using Prim = PRIM;
 
@@ -124,6 +145,8 @@ struct Unary_Array_Op
             case Ref_Value::ty_abstract_list:
                 if (rx.subtype_ == Ref_Value::sty_list)
                     return element_wise_op(fl, cx, (List&)rx);
+                else if (rx.subtype_ == Ref_Value::sty_num_array)
+                    return element_wise_op(fl, cx, (Num_Array&)rx);
                 else
                     break; // TODO strings are lists?
             case Ref_Value::ty_reactive:
@@ -144,14 +167,41 @@ struct Unary_Array_Op
     static Value
     element_wise_op(Fail fl, const At_Syntax& cx, List& xs)
     {
-        Shared<List> result = make_tail_array<List>(xs.size());
+        Shared<List> result = reuse_tail_array(xs);
+        bool in_place = (&*result == &xs);
         for (unsigned i = 0; i < xs.size(); ++i) {
-            TRY_DEF(r, call(fl, cx, xs[i]));
+            // When updating in place, xs[i] is about to be overwritten,
+            // so move it, which lets a nested list be reused as well.
+            TRY_DEF(r, call(fl, cx, in_place ? move(xs[i]) : xs[i]));
             (*result)[i] = r;
         }
+        if (auto packed = maybe_pack(result->begin(), result->size()))
+            return {packed};
         return {result};
     }
 
+    // Fast path for a packed list, if Prim maps numbers to numbers.
+    // Otherwise, or if a result is not a number, the remaining elements
+    // are computed by the general case, and the result is a List.
+    static Value
+    element_wise_op(Fail fl, const At_Syntax& cx, Num_Array& xs)
+    {
+        if constexpr (std::is_same<typename Prim::scalar_t, double>::value) {
+            size_t n = xs.size();
+            Shared<Num_Array> result = reuse_tail_array(xs);
+            size_t i = 0;
+            for (; i < n; ++i) {
+                Value r = Prim::call(xs[i], cx);
+                if (!r.is_num()) break;
+                (*result)[i] = r.to_num_unsafe();
+            }
+            if (i == n) return {result};
+            return finish_boxed(*result, i,
+                [&](size_t j) { return call(fl, cx, Value{xs[j]}); });
+        }
+        return element_wise_op(fl, cx, *xs.to_list());
+    }
+
     // Argument x is reactive. Construct a Reactive_Expression.
     static Value
     reactive_op(Fail fl, const At_Syntax& cx, Reactive_Value &rx)
@@ -177,11 +227,18 @@ struct Unary_Array_Op
 template <class PRIM>
 struct Binary_Array_Op
 {
-    // TODO: optimize: move semantics. unique object reuse.
+    // If a list argument is a temporary (use_count==1), the results are
+    // stored in place, instead of allocating a new list.
     // TODO: optimize: faster fast path in `op` for number case.
 
     using Prim = PRIM;
 
+    // True if Prim maps a pair of numbers to a number, enabling the fast
+    // paths for packed lists (Num_Array).
+    static constexpr bool num_prim =
+        std::is_same<typename Prim::left_t, double>::value
+        && std::is_same<typename Prim::right_t, double>::value;
+
     static Exception domain_error(
         const At_Syntax& cx, Value x, Value y)
     {
@@ -197,7 +254,21 @@ struct Binary_Array_Op
     static Value
     reduce(Fail fl, const At_Syntax& cx, Value zero, Value arg)
     {
-        auto list = arg.to<List>(fl, cx);
+        if constexpr (num_prim) {
+            // Fast path for a packed list: fold the numbers directly.
+            auto na = arg.maybe<Num_Array>();
+            if (na && !na->empty()) {
+                double result = na->front();
+                size_t i = 1;
+                for (; i < na->size(); ++i) {
+                    Value r = Prim::call(result, na->at(i), cx);
+                    if (!r.is_num()) break;
+                    result = r.to_num_unsafe();
+                }
+                if (i == na->size()) return {result};
+            }
+        }
+        auto list = unpack_list(arg, fl, cx);
         if (list == nullptr) return missing;
         unsigned n = list->size();
         if (n == 0)
@@ -272,6 +343,8 @@ struct Binary_Array_Op
                 case Ref_Value::ty_abstract_list:
                     if (ry.subtype_ == Ref_Value::sty_list)
                         return broadcast_right(fl, cx, x, (List&)ry);
+                    else if (ry.subtype_ == Ref_Value::sty_num_array)
+                        return broadcast_right(fl, cx, x, (Num_Array&)ry);
                     else
                         break; // TODO: strings are lists
                 case Ref_Value::ty_reactive:
@@ -283,6 +356,19 @@ struct Binary_Array_Op
             Ref_Value& rx(x.to_ref_unsafe());
             switch (rx.type_) {
             case Ref_Value::ty_abstract_list:
+                if (rx.subtype_ == Ref_Value::sty_num_array) {
+                    if (Prim::unbox_right(y, sy, cx))
+                        return broadcast_left(fl, cx, (Num_Array&)rx, y);
+                    if (y.is_ref()
+                        && y.to_ref_unsafe().subtype_
+                           == Ref_Value::sty_num_array)
+                    {
+                        return element_wise_op(fl, cx,
+                            (Num_Array&)rx, (Num_Array&)y.to_ref_unsafe());
+                    }
+                    // Unpack, then use the general case below.
+                    return call(fl, cx, Value{((Num_Array&)rx).to_list()}, y);
+                }
                 if (Prim::unbox_right(y, sy, cx))
                     return broadcast_left(fl, cx, (List&)rx, y);
                 else if (rx.subtype_ == Ref_Value::sty_list && y.is_ref()) {
@@ -291,6 +377,10 @@ struct Binary_Array_Op
                     case Ref_Value::ty_abstract_list:
                         if (ry.subtype_ == Ref_Value::sty_list)
                             return element_wise_op(fl, cx, (List&)rx, (List&)ry);
+                        else if (ry.subtype_ == Ref_Value::sty_num_array) {
+                            auto ys = ((Num_Array&)ry).to_list();
+                            return element_wise_op(fl, cx, (List&)rx, *ys);
+                        }
                         else
                             break; // TODO: strings are lists
                     case Ref_Value::ty_reactive:
@@ -329,23 +419,25 @@ struct Binary_Array_Op
     static Value
     broadcast_left(Fail fl, const At_Syntax& cx, List& xlist, Value y)
     {
-        Shared<List> result = make_tail_array<List>(xlist.size());
+        Shared<List> result = reuse_tail_array(xlist);
+        bool in_place = (&*result == &xlist);
         for (unsigned i = 0; i < xlist.size(); ++i) {
-            TRY_DEF(r, call(fl, cx, xlist[i], y));
+            TRY_DEF(r, call(fl, cx, in_place ? move(xlist[i]) : xlist[i], y));
             (*result)[i] = r;
         }
-        return {result};
+        return pack(result);
     }
 
     static Value
     broadcast_right(Fail fl, const At_Syntax& cx, Value x, List& ylist)
     {
-        Shared<List> result = make_tail_array<List>(ylist.size());
+        Shared<List> result = reuse_tail_array(ylist);
+        bool in_place = (&*result == &ylist);
         for (unsigned i = 0; i < ylist.size(); ++i) {
-            TRY_DEF(r, call(fl, cx, x, ylist[i]));
+            TRY_DEF(r, call(fl, cx, x, in_place ? move(ylist[i]) : ylist[i]));
             (*result)[i] = r;
         }
-        return {result};
+        return pack(result);
     }
 
     static Value
@@ -356,14 +448,104 @@ struct Binary_Array_Op
                 "mismatched list sizes (",
                 xs.size(),",",ys.size(),") in array operation"));
         }
-        Shared<List> result = make_tail_array<List>(xs.size());
+        Shared<List> result = reuse_either(xs, ys);
+        bool x_in_place = (&*result == &xs);
+        bool y_in_place = (&*result == &ys);
         for (unsigned i = 0; i < xs.size(); ++i) {
-            TRY_DEF(r, call(fl, cx, xs[i], ys[i]));
+            TRY_DEF(r, call(fl, cx,
+                x_in_place ? move(xs[i]) : xs[i],
+                y_in_place ? move(ys[i]) : ys[i]));
             (*result)[i] = r;
         }
+        return pack(result);
+    }
+
+    static Value pack(Shared<List>& result)
+    {
+        if (auto packed = maybe_pack(result->begin(), result->size()))
+            return {packed};
         return {result};
     }
 
+    // Reuse whichever of two same-sized arguments is a temporary.
+    template <class A>
+    static Shared<A> reuse_either(A& xs, A& ys)
+    {
+        if (ys.use_count == 1 && xs.use_count != 1)
+            return share(ys);
+        return reuse_tail_array(xs);
+    }
+
+    // Fast paths for packed lists, if Prim maps numbers to numbers.
+    // Each element is computed by calling Prim::call on two doubles. If a
+    // result is not a number (eg, a domain error), the remaining elements
+    // are computed by the general case, which reports the error.
+    static Value
+    broadcast_left(Fail fl, const At_Syntax& cx, Num_Array& xs, Value y)
+    {
+        if constexpr (num_prim) {
+            if (y.is_num()) {
+                double sy = y.to_num_unsafe();
+                size_t n = xs.size();
+                Shared<Num_Array> result = reuse_tail_array(xs);
+                size_t i = 0;
+                for (; i < n; ++i) {
+                    Value r = Prim::call(xs[i], sy, cx);
+                    if (!r.is_num()) break;
+                    (*result)[i] = r.to_num_unsafe();
+                }
+                if (i == n) return {result};
+                return finish_boxed(*result, i,
+                    [&](size_t j) { return call(fl, cx, Value{xs[j]}, y); });
+            }
+        }
+        return broadcast_left(fl, cx, *xs.to_list(), y);
+    }
+
+    static Value
+    broadcast_right(Fail fl, const At_Syntax& cx, Value x, Num_Array& ys)
+    {
+        if constexpr (num_prim) {
+            if (x.is_num()) {
+                double sx = x.to_num_unsafe();
+                size_t n = ys.size();
+                Shared<Num_Array> result = reuse_tail_array(ys);
+                size_t i = 0;
+                for (; i < n; ++i) {
+                    Value r = Prim::call(sx, ys[i], cx);
+                    if (!r.is_num()) break;
+                    (*result)[i] = r.to_num_unsafe();
+                }
+                if (i == n) return {result};
+                return finish_boxed(*result, i,
+                    [&](size_t j) { return call(fl, cx, x, Value{ys[j]}); });
+            }
+        }
+        return broadcast_right(fl, cx, x, *ys.to_list());
+    }
+
+    static Value
+    element_wise_op(Fail fl, const At_Syntax& cx, Num_Array& xs, Num_Array& ys)
+    {
+        if constexpr (num_prim) {
+            size_t n = xs.size();
+            if (n == ys.size()) {
+                Shared<Num_Array> result = reuse_either(xs, ys);
+                size_t i = 0;
+                for (; i < n; ++i) {
+                    Value r = Prim::call(xs[i], ys[i], cx);
+                    if (!r.is_num()) break;
+                    (*result)[i] = r.to_num_unsafe();
+                }
+                if (i == n) return {result};
+                return finish_boxed(*result, i, [&](size_t j) {
+                    return call(fl, cx, Value{xs[j]}, Value{ys[j]});
+                });
+            }
+        }
+        return element_wise_op(fl, cx, *xs.to_list(), *ys.to_list());
+    }
+
     // At least one of x and y is reactive. Construct a Reactive_Expression.
     static Value
     reactive_op(const At_Syntax& cx, Value x, Value y)
@@ -40,7 +40,7 @@ struct Not_Prim : public Unary_Bool_Prim
         if (x.type.is_bool())
             return sc_unary_call(fm, x.type, "!", x);
         if (x.type.is_bool_or_vec()) {
-            if (fm.sc_.target_ == SC_Target::cpp)
+            if (fm.sc_.target_ != SC_Target::glsl)
                 return sc_unary_call(fm, x.type, "not_", x);
             else
                 return sc_unary_call(fm, x.type, "not", x);
@@ -58,8 +58,8 @@ struct Cat_Op : public Binary_Op
     {
         (void)fl; // TODO
         List_Builder lb;
-        lb.concat(a, cx);
-        lb.concat(b, cx);
+        lb.concat(move(a), cx);
+        lb.concat(move(b), cx);
         return lb.get_value();
     }
     struct Prim {
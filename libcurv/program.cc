@@ -42,7 +42,7 @@ Program::compile(Shared<const Source> source, Scanner_Opts scopts,
     } else {
         meaning_ = phrase_->analyse(env, terp);
     }
-    frame_ = {make_tail_array<Frame>(env.frame_maxslots_,
+    frame_ = {Frame::make(env.frame_maxslots_,
         sstate_, sstate_.file_frame_, nullptr, nullptr)};
 }
 
@@ -28,6 +28,8 @@ struct Reactive_Value : public Ref_Value
     Ternary equal(Value) const;
     virtual void print_help(std::ostream&) const override;
 };
+template<> struct Ref_Tag<Reactive_Value>
+: Ref_Type_Tag<Ref_Value::ty_reactive> {};
 
 // An expression over one or more reactive variables. Essentially, this is a
 // lazy evaluation thunk. Reactive expressions can only be evaluated in a
@@ -52,6 +54,8 @@ struct Reactive_Expression : public Reactive_Value
         return expr_->hash_eq(*re.expr_);
     }
 };
+template<> struct Ref_Tag<Reactive_Expression>
+: Ref_Subtype_Tag<Ref_Value::sty_reactive_expression> {};
 
 Shared<Operation> to_expr(Value, const Phrase&);
 
@@ -4,6 +4,10 @@
 
 #include <libcurv/record.h>
 #include <libcurv/exception.h>
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 namespace curv {
 
@@ -70,16 +74,169 @@ value_to_variant(Value val, const Context& cx)
     throw Exception(cx, stringify(val, " is not a variant"));
 }
 
+int
+Record_Layout::find(Symbol_Ref name) const
+{
+    // Symbols are interned, so a linear search only compares pointers,
+    // and it beats a binary search (which uses strcmp) for small records.
+    if (names_.size() <= 16) {
+        for (size_t i = 0; i < names_.size(); ++i)
+            if (names_[i] == name)
+                return int(i);
+        return -1;
+    }
+    auto p = std::lower_bound(names_.begin(), names_.end(), name);
+    if (p != names_.end() && *p == name)
+        return int(p - names_.begin());
+    return -1;
+}
+
+namespace {
+struct Layout_Names_Hash
+{
+    size_t operator()(const std::vector<Symbol_Ref>& names) const noexcept
+    {
+        size_t result = 0;
+        for (auto& name : names)
+            boost::hash_combine(result, name.hash());
+        return result;
+    }
+};
+struct Transition_Hash
+{
+    size_t operator()(const std::pair<const Record_Layout*, Symbol_Ref>& t)
+    const noexcept
+    {
+        size_t result = std::hash<const Record_Layout*>()(t.first);
+        boost::hash_combine(result, t.second.hash());
+        return result;
+    }
+};
+
+// The interned layouts, and the transitions made by Record_Layout::add.
+// A transition holds a reference to its source layout, so that the address
+// in the key isn't reused while the entry exists.
+struct Layout_Table
+{
+    static constexpr size_t max_entries = 4096;
+
+    // The table is shared between threads during a parallel evaluation
+    // (see atomic_refcounts).
+    std::mutex mutex_;
+    std::unordered_map<std::vector<Symbol_Ref>, Shared<const Record_Layout>,
+        Layout_Names_Hash> layouts_;
+    std::unordered_map<std::pair<const Record_Layout*, Symbol_Ref>,
+        std::pair<Shared<const Record_Layout>, Shared<const Record_Layout>>,
+        Transition_Hash> transitions_;
+
+    static Layout_Table& get()
+    {
+        // Never destroyed, so that the layouts outlive static DRecord values.
+        static auto* table = new Layout_Table();
+        return *table;
+    }
+
+    // The mutex must be locked.
+    Shared<const Record_Layout> intern(std::vector<Symbol_Ref> names)
+    {
+        if (names.empty())
+            return Record_Layout::empty();
+        auto i = layouts_.find(names);
+        if (i != layouts_.end())
+            return i->second;
+        if (layouts_.size() >= max_entries
+            || transitions_.size() >= max_entries)
+        {
+            // Layouts that are in use stay alive, but they are no longer
+            // shared with new records.
+            layouts_.clear();
+            transitions_.clear();
+        }
+        auto layout = make<Record_Layout>();
+        layout->names_ = names;
+        layouts_.emplace(std::move(names), layout);
+        return layout;
+    }
+};
+} // namespace
+
+Shared<const Record_Layout>
+Record_Layout::intern(std::vector<Symbol_Ref> names)
+{
+    auto& table = Layout_Table::get();
+    std::unique_lock<std::mutex> lock(table.mutex_, std::defer_lock);
+    if (atomic_refcounts) lock.lock();
+    return table.intern(std::move(names));
+}
+
+Shared<const Record_Layout>
+Record_Layout::add(Symbol_Ref name, slot_t& slot) const
+{
+    auto& table = Layout_Table::get();
+    std::unique_lock<std::mutex> lock(table.mutex_, std::defer_lock);
+    if (atomic_refcounts) lock.lock();
+
+    slot = slot_t(std::lower_bound(names_.begin(), names_.end(), name)
+        - names_.begin());
+    auto t = table.transitions_.find({this, name});
+    if (t != table.transitions_.end())
+        return t->second.second;
+    std::vector<Symbol_Ref> names;
+    names.reserve(names_.size() + 1);
+    names.insert(names.end(), names_.begin(), names_.begin() + slot);
+    names.push_back(name);
+    names.insert(names.end(), names_.begin() + slot, names_.end());
+    auto layout = table.intern(std::move(names));
+    table.transitions_.emplace(std::make_pair(this, name),
+        std::make_pair(share(*this), layout));
+    return layout;
+}
+
+const Shared<const Record_Layout>&
+Record_Layout::empty()
+{
+    // Never destroyed, so that the layouts outlive static DRecord values.
+    static auto* layout =
+        new Shared<const Record_Layout>(make<Record_Layout>());
+    return *layout;
+}
+
+DRecord::DRecord(const Symbol_Map<Value>& fields)
+:
+    Record(sty_drecord)
+{
+    // The map is already sorted, so the layout is built in one step.
+    std::vector<Symbol_Ref> names;
+    names.reserve(fields.size());
+    values_.reserve(fields.size());
+    for (auto& f : fields) {
+        names.push_back(f.first);
+        values_.push_back(f.second);
+    }
+    layout_ = Record_Layout::intern(std::move(names));
+}
+
+void
+DRecord::set(Symbol_Ref name, Value val)
+{
+    int i = layout_->find(name);
+    if (i >= 0) {
+        values_[i] = std::move(val);
+        return;
+    }
+    slot_t slot;
+    layout_ = layout_->add(name, slot);
+    values_.insert(values_.begin() + slot, std::move(val));
+}
+
 void
 DRecord::print_repr(std::ostream& out, Prec) const
 {
     out << "{";
-    bool first = true;
-    for (auto i : fields_) {
-        if (!first) out << ",";
-        first = false;
-        out << i.first << ":";
-        i.second.print_repr(out, Prec::item);
+    for (size_t i = 0; i < values_.size(); ++i) {
+        if (i > 0) out << ",";
+        out << layout_->names_[i] << ":";
+        values_[i].print_repr(out, Prec::item);
     }
     out << "}";
 }
@@ -87,42 +244,49 @@ DRecord::print_repr(std::ostream& out, Prec) const
 Value
 DRecord::find_field(Symbol_Ref name, const Context& cx) const
 {
-    auto fp = fields_.find(name);
-    if (fp != fields_.end())
-        return fp->second;
+    if (auto fp = find(name))
+        return *fp;
     return missing;
 }
 
 bool
 DRecord::hasfield(Symbol_Ref name) const
 {
-    auto fp = fields_.find(name);
-    return (fp != fields_.end());
+    return layout_->find(name) >= 0;
 }
 
 Shared<Record>
 DRecord::clone() const
 {
-    return make<DRecord>(fields_);
+    return make<DRecord>(layout_, values_);
 }
 
 Value*
 DRecord::ref_field(Symbol_Ref name, bool need_value, const Context& cx)
 {
-    auto fp = fields_.find(name);
-    if (fp != fields_.end())
-        return &fp->second;
+    if (auto fp = find(name))
+        return fp;
     throw Exception(cx, stringify(Value{share(*this)},
         " has no field named ", name));
 }
 
-Shared<DRecord> update_drecord(Value arg, const Context& cx)
+Shared<DRecord> update_drecord(Value& arg, const Context& cx)
 {
-    // TODO: optimize: if arg is a drecord with usecount==1, make no copy
     auto arec = arg.to<Record>(cx);
+    if (arec->subtype_ == Ref_Value::sty_drecord) {
+        auto& d = (DRecord&)*arec;
+        if (d.use_count == 2) {
+            // arec and arg are the only references.
+            arg = Value{};
+            return share(d);
+        }
+        // Copying the layout and the values is cheaper than adding
+        // the fields one at a time.
+        return make<DRecord>(d.layout_, d.values_);
+    }
     auto drec = make<DRecord>();
     arec->each_field(cx, [&](Symbol_Ref id, Value val) -> void {
-        drec->fields_[id] = val;
+        drec->set(id, val);
     });
     return drec;
 }
@@ -6,6 +6,7 @@
 #define LIBCURV_RECORD_H
 
 #include <libcurv/list.h>
+#include <libcurv/slot.h>
 #include <libcurv/symbol.h>
 
 namespace curv {
@@ -71,6 +72,7 @@ struct Record : public Ref_Value
     };
     virtual std::unique_ptr<Iter> iter() const = 0;
 };
+template<> struct Ref_Tag<Record> : Ref_Type_Tag<Ref_Value::ty_record> {};
 
 std::pair<Symbol_Ref, Value> value_to_variant(Value, const Context& cx);
 
@@ -81,25 +83,72 @@ operator<<(std::ostream& out, const Record& rec)
     return out;
 }
 
+/// A Record_Layout is the set of field names of a DRecord (its "hidden class").
+/// The names are stored in the global symbol order, and the index of a name
+/// is the index of the field value in DRecord::values_.
+///
+/// Layouts are shared. They are interned in a hash table keyed by the list
+/// of names, and adding a field to a record follows a cached transition from
+/// the old layout to the new one. So records with the same fields normally
+/// have the same layout, which is used as the key of the inline cache in
+/// Dot_Expr. The table is bounded: when it fills up, it is cleared, and
+/// layouts are freed once no record refers to them.
+struct Record_Layout : public Shared_Base
+{
+    std::vector<Symbol_Ref> names_;
+
+    size_t size() const { return names_.size(); }
+
+    /// Return the slot index of a field name, or -1 if not found.
+    int find(Symbol_Ref) const;
+
+    /// Return the layout with an additional field, and its slot index.
+    Shared<const Record_Layout> add(Symbol_Ref, slot_t& slot) const;
+
+    /// Return the shared layout for a list of names in symbol order.
+    static Shared<const Record_Layout> intern(std::vector<Symbol_Ref> names);
+
+    /// The layout with no fields.
+    static const Shared<const Record_Layout>& empty();
+};
+
 /// A DRecord is a dynamic record. It's a concrete implementation of the
 /// Record protocol for which it is possible to dynamically add new fields
 /// at run-time. Constrast this with Module, which is a static record.
 struct DRecord : public Record
 {
-    Symbol_Map<Value> fields_;
+    Shared<const Record_Layout> layout_;
+    std::vector<Value> values_;
 
-    DRecord() : Record(sty_drecord) {}
-    DRecord(Symbol_Map<Value> fields)
+    DRecord() : Record(sty_drecord), layout_(Record_Layout::empty()) {}
+    DRecord(const Symbol_Map<Value>& fields);
+    DRecord(Shared<const Record_Layout> layout, std::vector<Value> values)
     :
         Record(sty_drecord),
-        fields_(move(fields))
+        layout_(std::move(layout)),
+        values_(std::move(values))
+    {
+    }
+
+    /// Return a pointer to the value of a field, or nullptr if not found.
+    Value* find(Symbol_Ref name)
     {
+        int i = layout_->find(name);
+        return i < 0 ? nullptr : &values_[i];
     }
+    const Value* find(Symbol_Ref name) const
+    {
+        int i = layout_->find(name);
+        return i < 0 ? nullptr : &values_[i];
+    }
+
+    /// Set the value of a field, adding the field if it doesn't exist.
+    void set(Symbol_Ref, Value);
 
     virtual void print_repr(std::ostream&, Prec) const override;
     virtual Value find_field(Symbol_Ref, const Context&) const override;
     virtual bool hasfield(Symbol_Ref) const override;
-    virtual size_t size() const override { return fields_.size(); }
+    virtual size_t size() const override { return values_.size(); }
     virtual Shared<Record> clone() const override;
     virtual Value* ref_field(Symbol_Ref, bool need_value, const Context&)
         override;
@@ -110,23 +159,23 @@ struct DRecord : public Record
         Iter(const DRecord& rec)
         :
             rec_(rec),
-            i_(rec.fields_.begin())
+            i_(0)
         {
-            if (i_ != rec_.fields_.end()) {
-                key_ = i_->first;
-                value_ = i_->second;
+            if (i_ < rec_.values_.size()) {
+                key_ = rec_.layout_->names_[i_];
+                value_ = rec_.values_[i_];
             }
         }
     protected:
         const DRecord& rec_;
-        Symbol_Map<Value>::const_iterator i_;
+        size_t i_;
         virtual void load_value(const Context&) override {}
         virtual void next() override
         {
             ++i_;
-            if (i_ != rec_.fields_.end()) {
-                key_ = i_->first;
-                value_ = i_->second;
+            if (i_ < rec_.values_.size()) {
+                key_ = rec_.layout_->names_[i_];
+                value_ = rec_.values_[i_];
             } else
                 key_ = Symbol_Ref();
         }
@@ -136,13 +185,14 @@ struct DRecord : public Record
         return std::make_unique<Iter>(*this);
     }
 };
+template<> struct Ref_Tag<DRecord> : Ref_Subtype_Tag<Ref_Value::sty_drecord> {};
 
 // Efficiently convert a Value to a mutable DRecord.
 // Abort if the Value is not a record.
-// If the Value is a DRecord with use_count==1, return the DRecord directly.
+// If the Value is a DRecord with use_count==1, move it out of the argument
+// (leaving it missing) and return the DRecord directly.
 // Otherwise, make a copy of the record and return that.
-// You should use 'move' to pass the Value argument.
-Shared<DRecord> update_drecord(Value, const Context&);
+Shared<DRecord> update_drecord(Value&, const Context&);
 
 } // namespace curv
 #endif // header guard
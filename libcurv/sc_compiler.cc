@@ -4,6 +4,7 @@
 
 #include <cctype>
 #include <iostream>
+#include <set>
 #include <typeinfo>
 #include <boost/core/demangle.hpp>
 
@@ -50,6 +51,15 @@ struct SC_Data_Ref : public Operation
     void exec(Frame&, Executor&) const override { }
 };
 
+SC_Compiler::SC_Compiler(SC_Target t, Source_State& ss)
+:
+    target_(t),
+    valcount_(0),
+    sstate_(ss),
+    inline_limit_(ss.system_.sc_inline_limit_)
+{
+}
+
 // This is the main entry point into the Shape Compiler.
 void
 SC_Compiler::define_function(
@@ -71,9 +81,24 @@ SC_Compiler::define_function(
     SC_Type result_type,
     Shared<const Function> func,
     const Context& cx)
+{
+    auto sym = make_symbol(name);
+    auto f = compile_function(sym, param_types, result_type, *func, cx);
+    entries_[sym] = {std::move(param_types), result_type, func};
+    push_object(sym, f);
+}
+
+Shared<const SC_Function>
+SC_Compiler::compile_function(
+    Symbol_Ref name,
+    const std::vector<SC_Type>& param_types,
+    SC_Type result_type,
+    const Function& func,
+    const Context& cx)
 {
     valcount_ = 0;
     valcache_.clear();
+    constdefs_.clear();
     opcaches_.clear();
     opcaches_.emplace_back(Op_Cache{});
     constants_.str("");
@@ -95,48 +120,111 @@ SC_Compiler::define_function(
         }
         arg_expr = move(param_list);
     }
-    auto result = func->sc_call_expr(*arg_expr, nullptr, *fm);
+    auto result = func.sc_call_expr(*arg_expr, nullptr, *fm);
     if (result.type != result_type) {
         throw Exception(cx, stringify(name," function returns ",result.type));
     }
 
-    auto f = make<SC_Function>(std::move(params), result,
+    return make<SC_Function>(std::move(params), result,
          std::move(constants_), std::move(body_));
-    push_object(make_symbol(name), f);
+}
+
+// In interval code, the scalar types float and bool are replaced by the
+// interval types Ival and Ibool, which are defined by the interval prelude
+// (along with vec3, bvec3, etc). In dual number code, float is replaced
+// by Dual. Only whole words are replaced, so that names like
+// floatBitsToUint are left alone.
+static std::string
+scalar_types(const std::string& code, SC_Target target)
+{
+    auto is_word = [](char c) -> bool { return isalnum(c) || c == '_'; };
+    std::string result;
+    result.reserve(code.size());
+    for (size_t i = 0; i < code.size();) {
+        if (!is_word(code[i])) {
+            result += code[i++];
+            continue;
+        }
+        size_t j = i;
+        while (j < code.size() && is_word(code[j]))
+            ++j;
+        auto word = code.substr(i, j - i);
+        if (word == "float")
+            result += target == SC_Target::dual ? "Dual" : "Ival";
+        else if (word == "bool" && target == SC_Target::interval)
+            result += "Ibool";
+        else
+            result += word;
+        i = j;
+    }
+    return result;
 }
 
 void
 SC_Uniform_Variable::emit(SC_Compiler& sc, Symbol_Ref name, std::ostream& out)
     const
 {
-    out << "uniform " << type_ << " " << name << ";\n";
+    if (sc.target_ == SC_Target::glsl) {
+        out << "uniform " << type_ << " " << name << ";\n";
+        return;
+    }
+    std::stringstream code;
+    code << "static " << type_ << " " << name
+         << "(Curv_Params curv_params) { return " << type_ << "(";
+    for (unsigned i = 0; i < type_.count(); ++i) {
+        if (i > 0) code << ",";
+        code << "curv_params[" << offset_ + i << "]";
+    }
+    code << "); }\n";
+    if (sc.target_ == SC_Target::interval || sc.target_ == SC_Target::dual)
+        out << scalar_types(code.str(), sc.target_);
+    else
+        out << code.str();
 }
+
 void
-SC_Function::emit(SC_Compiler& sc, Symbol_Ref name, std::ostream& out) const
+SC_Function::emit(SC_Compiler& sc, Symbol_Ref name, std::ostream& sink) const
 {
+    std::stringstream out;
+
+    // In C++, each function has an extra first parameter, `curv_params`,
+    // which is the parameter block of a parametric shape (see
+    // SC_Uniform_Variable). An entry point is a static function named
+    // `<name>_params`, plus a wrapper with a C calling convention, with the
+    // parameters and result passed by reference, and no parameter block.
+    bool cpp = sc.target_ != SC_Target::glsl;
+    bool wrapper = sc.target_ == SC_Target::cpp && !outlined_;
+
     // function prologue
-    if (sc.target_ == SC_Target::cpp)
-        out << "extern \"C\" void " << name << "(";
-    else
+    if (wrapper)
+        out << "static void " << name << "_params(";
+    else {
+        if (cpp)
+            out << "static ";
         out << result_.type << " " << name << "(";
+    }
     bool first = true;
+    if (cpp) {
+        out << "Curv_Params curv_params";
+        first = false;
+    }
+    int n = 0;
     for (auto& p : params_) {
-        int n = 0;
         if (!first) out << ", ";
         first = false;
-        if (sc.target_ == SC_Target::cpp)
+        if (wrapper)
             out << "const " << p.type << "* param" << n++;
         else
             out << p.type << " " << p;
     }
-    if (sc.target_ == SC_Target::cpp) {
+    if (wrapper) {
         if (!first) out << ", ";
         out << result_.type << "* result)\n";
     } else
         out << ")\n";
     out << "{\n";
-    if (sc.target_ == SC_Target::cpp) {
-        int n = 0;
+    if (wrapper) {
+        n = 0;
         for (auto p : params_) {
             out << "  " << p.type << " " << p << " = *param" << n++ << ";\n";
         }
@@ -144,24 +232,105 @@ SC_Function::emit(SC_Compiler& sc, Symbol_Ref name, std::ostream& out) const
 
     // function body
     out << "  /* constants */\n";
+    out << free_constants_;
     out << constants_.str();
     out << "  /* body */\n";
     out << body_.str();
 
     // function epilogue
-    if (sc.target_ == SC_Target::cpp) {
+    if (wrapper) {
         out << "  *result = " << result_ << ";\n";
     } else {
         out << "  return " << result_ << ";\n";
     }
     out << "}\n";
+    if (wrapper) {
+        out << "extern \"C\" void " << name << "(";
+        n = 0;
+        for (auto& p : params_)
+            out << "const " << p.type << "* param" << n++ << ", ";
+        out << result_.type << "* result)\n"
+            << "{\n"
+            << "  " << name << "_params(nullptr, ";
+        for (n = 0; n < int(params_.size()); ++n)
+            out << "param" << n << ", ";
+        out << "result);\n"
+            << "}\n";
+    }
+
+    if (sc.target_ == SC_Target::interval || sc.target_ == SC_Target::dual)
+        sink << scalar_types(out.str(), sc.target_);
+    else
+        sink << out.str();
 }
 void
 SC_Compiler::emit_objects(std::ostream& out)
 {
+    // The functions defined by define_function are compiled again if a
+    // closure that is outlined is only called once, or if a closure that
+    // would be outlined uses common subexpressions of its caller. The next
+    // time, the first is inlined, with the same code as if outlining was
+    // disabled, and the second is isolated. See sc_eval_body().
+    std::vector<SC_Outline> marks;
+    auto mark = [&](const SC_Outline& o, SC_Outline::State state) -> void {
+        for (auto& m : marks) {
+            if (m.func_ == o.func_ && m.param_types_ == o.param_types_) {
+                m.state_ = state;
+                return;
+            }
+        }
+        marks.push_back({o.func_, o.param_types_, state});
+    };
+    for (;;) {
+        bool again = !isolate_.empty();
+        for (auto& o : isolate_)
+            mark(o, SC_Outline::isolated);
+        for (auto& outlines : outlines_) {
+            for (auto& o : outlines.second) {
+                if (o.state_ == SC_Outline::outlined && o.calls_ == 1) {
+                    mark(o, SC_Outline::inlined);
+                    again = true;
+                }
+            }
+        }
+        if (!again)
+            break;
+        isolate_.clear();
+        outlines_.clear();
+        for (auto& m : marks)
+            outlines_[&*m.func_].push_back(m);
+        outlines_count_ = first_outline_;
+        At_SState cx(sstate_);
+        auto objects = std::move(objects_);
+        objects_.clear();
+        for (auto& obj : objects) {
+            auto e = entries_.find(obj.first);
+            if (e != entries_.end()) {
+                push_object(obj.first, compile_function(obj.first,
+                    e->second.param_types_, e->second.result_type_,
+                    *e->second.func_, cx));
+                continue;
+            }
+            auto f = dynamic_cast<const SC_Function*>(&*obj.second);
+            if (f == nullptr || !f->outlined_)
+                push_object(obj.first, obj.second);
+        }
+    }
+
+    for (auto& outlines : outlines_) {
+        for (auto& o : outlines.second) {
+            if (o.state_ == SC_Outline::outlined) {
+                ++outlined_functions_;
+                outlined_calls_ += o.calls_;
+            }
+        }
+    }
     for (auto& obj : objects_)
         obj.second->emit(*this, obj.first, out);
     objects_.clear();
+    outlines_.clear();
+    entries_.clear();
+    first_outline_ = outlines_count_;
 }
 
 struct Set_Purity
@@ -181,6 +350,105 @@ struct Set_Purity
     }
 };
 
+// While this exists, the code generated by the SC_Compiler is captured in
+// separate streams, as if for the body of a new function. The constants and
+// (unless isolated) the common subexpressions of the enclosing code are still
+// visible, and their use is recorded, since an outlined function can't refer
+// to them.
+struct SC_Capture
+{
+    SC_Compiler& sc_;
+    SC_Capture* parent_;
+    std::stringstream constants_{};
+    std::stringstream body_{};
+    Op_Cache opcache_{};
+    bool in_constants_;
+    // The op caches of the enclosing code are not visible.
+    bool isolated_;
+    // SSA values numbered below base_, and op caches below opcache_base_,
+    // belong to the enclosing code. See sc_use_value().
+    unsigned base_;
+    size_t opcache_base_;
+    // The constants of the enclosing code used by the captured code.
+    // An outlined function defines them again.
+    std::set<unsigned> free_constants_{};
+    // The captured code uses some other value computed by the enclosing
+    // code, so it can't be outlined.
+    bool uses_outer_values_ = false;
+    bool active_ = true;
+
+    SC_Capture(SC_Compiler& sc, bool isolated)
+    :
+        sc_(sc),
+        parent_(sc.capture_),
+        in_constants_(sc.in_constants_),
+        isolated_(isolated),
+        base_(sc.valcount_),
+        opcache_base_(sc.opcaches_.size())
+    {
+        swap();
+        sc_.opcaches_.emplace_back(Op_Cache{});
+        sc_.in_constants_ = false;
+        sc_.capture_ = this;
+    }
+    ~SC_Capture() { finish(); }
+    void finish()
+    {
+        if (active_) {
+            swap();
+            opcache_ = std::move(sc_.opcaches_[opcache_base_]);
+            sc_.opcaches_.resize(opcache_base_);
+            sc_.in_constants_ = in_constants_;
+            sc_.capture_ = parent_;
+            active_ = false;
+        }
+    }
+    void swap()
+    {
+        std::swap(constants_, sc_.constants_);
+        std::swap(body_, sc_.body_);
+    }
+    // Insert the captured code into the enclosing code, as if it had been
+    // generated there.
+    void insert()
+    {
+        sc_.constants_ << constants_.str();
+        sc_.body_ << body_.str();
+        sc_.opcaches_.back().insert(opcache_.begin(), opcache_.end());
+    }
+    // The captured code is an outlined function: its constants are not
+    // visible to the enclosing code.
+    std::string outline()
+    {
+        auto& vc = sc_.valcache_;
+        for (auto v = vc.begin(); v != vc.end(); ) {
+            if (v->second.index >= base_) {
+                sc_.constdefs_.erase(v->second.index);
+                v = vc.erase(v);
+            } else
+                ++v;
+        }
+        std::string free_constants;
+        for (auto i : free_constants_)
+            free_constants += sc_.constdefs_[i];
+        return free_constants;
+    }
+};
+
+// A value from the value cache or an op cache is used by the code being
+// compiled. If it belongs to the code enclosing a capture, then record it.
+static void
+sc_use_value(SC_Compiler& sc, SC_Value val)
+{
+    bool constant = sc.constdefs_.count(val.index) > 0;
+    for (auto c = sc.capture_; c && val.index < c->base_; c = c->parent_) {
+        if (constant)
+            c->free_constants_.insert(val.index);
+        else
+            c->uses_outer_values_ = true;
+    }
+}
+
 // Wrapper for Operation::sc_eval(fm), does common subexpression elimination.
 SC_Value sc_eval_op(SC_Frame& fm, const Operation& op)
 {
@@ -194,10 +462,20 @@ SC_Value sc_eval_op(SC_Frame& fm, const Operation& op)
     // (eg, no Local_Data_Ref ops), other than uniform variables in reactive values.
     // What follows is a limited form of common subexpression elimination
     // which reduces code size when reactive values are used.
-    for (Op_Cache& opcache : fm.sc_.opcaches_) {
-        auto cached = opcache.find(share(op));
-        if (cached != opcache.end())
+    auto& opcaches = fm.sc_.opcaches_;
+    size_t first = 0;
+    for (auto c = fm.sc_.capture_; c; c = c->parent_) {
+        if (c->isolated_) {
+            first = c->opcache_base_;
+            break;
+        }
+    }
+    for (size_t i = first; i < opcaches.size(); ++i) {
+        auto cached = opcaches[i].find(share(op));
+        if (cached != opcaches[i].end()) {
+            sc_use_value(fm.sc_, cached->second);
             return cached->second;
+        }
     }
     Set_Purity pu(fm.sc_, true);
     auto val = op.sc_eval(fm);
@@ -208,6 +486,108 @@ SC_Value sc_eval_op(SC_Frame& fm, const Operation& op)
 #endif
 }
 
+static SC_Value
+sc_call_outline(SC_Compiler& sc, SC_Outline& o,
+    const std::vector<SC_Value>& args)
+{
+    SC_Value result = sc.newvalue(o.result_type_);
+    sc.out() << "  " << result.type << " " << result << " = "
+             << o.name_ << "(";
+    // In C++, the parameter block is passed to each function.
+    bool first = true;
+    if (sc.target_ != SC_Target::glsl) {
+        sc.out() << "curv_params";
+        first = false;
+    }
+    for (auto& a : args) {
+        if (!first) sc.out() << ",";
+        first = false;
+        sc.out() << a;
+    }
+    sc.out() << ");\n";
+    ++o.calls_;
+    return result;
+}
+
+SC_Value
+sc_eval_body(SC_Frame& fm, const Operation& body)
+{
+    SC_Compiler& sc = fm.sc_;
+    if (sc.inline_limit_ < 0 || fm.func_ == nullptr)
+        return sc_eval_op(fm, body);
+    // The body of an entry point defined by define_function is not outlined.
+    if (fm.parent_frame_ && fm.parent_frame_->parent_frame_ == nullptr)
+        return sc_eval_op(fm, body);
+
+    // The parameters are the slots set by pattern matching. An outlined
+    // function can't have array parameters, or two parameters that are the
+    // same SSA variable.
+    std::vector<SC_Value> params;
+    std::vector<SC_Type> param_types;
+    for (size_t i = 0; i < fm.size_; ++i) {
+        if (fm[i].index == SC_Value::unset)
+            continue;
+        if (!fm[i].type.is_plex())
+            return sc_eval_op(fm, body);
+        for (auto& p : params) {
+            if (p.index == fm[i].index)
+                return sc_eval_op(fm, body);
+        }
+        params.push_back(fm[i]);
+        param_types.push_back(fm[i].type);
+    }
+
+    auto& outlines = sc.outlines_[&*fm.func_];
+    size_t index = 0;
+    for (; index < outlines.size(); ++index) {
+        auto& o = outlines[index];
+        if (o.param_types_ != param_types)
+            continue;
+        if (o.state_ == SC_Outline::outlined)
+            return sc_call_outline(sc, o, params);
+        if (o.state_ != SC_Outline::isolated) {
+            // Inline a small function, or a recursive call.
+            return sc_eval_op(fm, body);
+        }
+        o.state_ = SC_Outline::compiling;
+        break;
+    }
+
+    // This is the first call with these argument types. Compile the body
+    // separately, then either outline it, or insert it inline if it is small.
+    // The parameters of the outlined function have the same names as the
+    // arguments of this call, so the code is the same either way.
+    bool isolated = index < outlines.size();
+    if (!isolated)
+        outlines.push_back({fm.func_, param_types, SC_Outline::compiling});
+    SC_Capture cap(sc, isolated);
+    SC_Value result = sc_eval_op(fm, body);
+    cap.finish();
+    auto& o = sc.outlines_[&*fm.func_][index];
+    size_t size = size_t(cap.constants_.tellp()) + size_t(cap.body_.tellp());
+    if (size < size_t(sc.inline_limit_) || !result.type.is_plex()
+        || cap.uses_outer_values_)
+    {
+        if (size >= size_t(sc.inline_limit_) && result.type.is_plex()
+            && !isolated)
+        {
+            sc.isolate_.push_back(o);
+        }
+        o.state_ = SC_Outline::inlined;
+        cap.insert();
+        return result;
+    }
+    o.state_ = SC_Outline::outlined;
+    o.name_ = make_symbol(
+        stringify("sc_func", sc.outlines_count_++)->c_str());
+    o.result_type_ = result.type;
+    auto f = make<SC_Function>(params, result,
+        std::move(cap.constants_), std::move(cap.body_), true);
+    f->free_constants_ = cap.outline();
+    sc.push_object(o.name_, f);
+    return sc_call_outline(sc, o, params);
+}
+
 SC_Value sc_eval_expr(SC_Frame& fm, const Operation& op, SC_Type type)
 {
     SC_Value arg = sc_eval_op(fm, op);
@@ -234,9 +614,13 @@ sc_put_value(Value val, SC_Type ty, const At_SC_Phrase& cx, std::ostream& out)
             &cx.call_frame_, nullptr, &*cx.phrase_);
         auto result = sc_eval_op(*f2, *re->expr_);
         out << result;
+        ++cx.call_frame_.sc_.reactive_values_;
     }
     else if (auto uv = val.maybe<Uniform_Variable>()) {
         out << uv->identifier_;
+        // In C++, a uniform variable is a function: see SC_Uniform_Variable.
+        if (cx.call_frame_.sc_.target_ != SC_Target::glsl)
+            out << "(curv_params)";
     }
     else if (ty.is_num()) {
         double num = val.to_num(cx);
@@ -259,7 +643,7 @@ sc_put_value(Value val, SC_Type ty, const At_SC_Phrase& cx, std::ostream& out)
         out << ")";
     }
     else if (ty.plex_array_rank() > 0) {
-        auto list = val.to<List>(cx);
+        auto list = unpack_list(val, cx);
         list->assert_size(ty.plex_array_dim(0), cx);
         sc_put_list(*list, ty.elem_type(), cx, out);
     }
@@ -286,8 +670,10 @@ SC_Value sc_eval_const(SC_Frame& fm, Value val, const Phrase& syntax)
 {
 #if OPTIMIZE
     auto cached = fm.sc_.valcache_.find(val);
-    if (cached != fm.sc_.valcache_.end())
+    if (cached != fm.sc_.valcache_.end()) {
+        sc_use_value(fm.sc_, cached->second);
         return cached->second;
+    }
 #endif
     Set_Purity pu(fm.sc_, true);
     At_SC_Phrase cx(share(syntax), fm);
@@ -299,25 +685,28 @@ SC_Value sc_eval_const(SC_Frame& fm, Value val, const Phrase& syntax)
     }
 
     String_Builder init;
+    unsigned reactive_values = fm.sc_.reactive_values_;
     sc_put_value(val, ty, cx, init);
     auto initstr = init.get_string();
     SC_Value result = fm.sc_.newvalue(ty);
+    String_Builder def;
     if (ty.is_plex()) {
-        fm.sc_.out()
-            << "  " << ty << " " << result << " = "
-            << *initstr << ";\n";
+        def << "  " << ty << " " << result << " = " << *initstr << ";\n";
     } else {
         SC_Type ety = ty.plex_array_base();
-        if (fm.sc_.target_ == SC_Target::cpp) {
-            fm.sc_.out() << "  " << ety << " " << result << "[] = {"
+        if (fm.sc_.target_ != SC_Target::glsl) {
+            def << "  " << ety << " " << result << "[] = {"
                 << *initstr << "};\n";
         } else {
-            fm.sc_.out() << "  " << ty << " " << result << " = " << ty << "("
+            def << "  " << ty << " " << result << " = " << ty << "("
                 << *initstr << ");\n";
         }
     }
+    fm.sc_.out() << def.str();
 
     fm.sc_.valcache_[val] = result;
+    if (fm.sc_.reactive_values_ == reactive_values)
+        fm.sc_.constdefs_[result.index] = def.str();
     return result;
 }
 
@@ -901,8 +1290,14 @@ SC_Value If_Else_Op::sc_eval(SC_Frame& fm) const
             arg2.type, ",", arg3.type, ")"));
     }
     SC_Value result = fm.sc_.newvalue(arg2.type);
-    fm.sc_.out() <<"  "<<arg2.type<<" "<<result
-             <<" =("<<arg1<<" ? "<<arg2<<" : "<<arg3<<");\n";
+    if (fm.sc_.target_ == SC_Target::interval) {
+        // If the condition is ambiguous, the result is the hull of both arms.
+        fm.sc_.out() <<"  "<<arg2.type<<" "<<result
+                 <<" = select("<<arg1<<","<<arg2<<","<<arg3<<");\n";
+    } else {
+        fm.sc_.out() <<"  "<<arg2.type<<" "<<result
+                 <<" =("<<arg1<<" ? "<<arg2<<" : "<<arg3<<");\n";
+    }
     return result;
 }
 void If_Else_Op::sc_exec(SC_Frame& fm) const
@@ -9,6 +9,7 @@
 #include <libcurv/meaning.h>
 #include <libcurv/sc_frame.h>
 #include <tsl/ordered_map.h>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -32,11 +33,20 @@ struct Context;
 /// where different calls to the same function have different argument types.
 /// The generated code is statically typed, and uses SSA style, where each
 /// operation is represented by an assignment to an SSA variable.
+///
+/// Inline expansion makes the code for a deeply nested shape very large,
+/// since the distance function of a shape can be called many times by the
+/// shapes that contain it. So, a closure whose inline expansion is larger
+/// than inline_limit_ is "outlined": it is compiled once, as a separate
+/// function specialized for the argument types, and that function is called
+/// by each later call with the same closure and argument types.
 
 enum class SC_Target
 {
-    glsl,   // output GLSL code
-    cpp     // output C++ code using GLM library
+    glsl,       // output GLSL code
+    cpp,        // output C++ code using GLM library
+    interval,   // output C++ code using interval arithmetic (see Cpp_Program)
+    dual        // output C++ code using dual numbers (see Cpp_Program)
 };
 
 struct Op_Hash
@@ -63,6 +73,24 @@ struct SC_Object : public Shared_Base
     virtual void emit(SC_Compiler&, Symbol_Ref, std::ostream&) const = 0;
 };
 
+/// A closure that has been compiled as a separate function, or that is
+/// too small to be worth it. See sc_eval_body().
+struct SC_Outline
+{
+    Shared<const Function> func_;
+    std::vector<SC_Type> param_types_;
+    // An isolated closure has not been compiled yet. Its body is compiled
+    // without the common subexpressions of the calling code, so that it
+    // can be outlined.
+    enum State { compiling, inlined, outlined, isolated } state_;
+    Symbol_Ref name_{};
+    SC_Type result_type_{};
+    unsigned calls_ = 0;
+};
+
+struct SC_Capture;
+struct SC_Function;
+
 /// Global state for the GLSL/C++ code generator.
 struct SC_Compiler
 {
@@ -74,14 +102,47 @@ struct SC_Compiler
     Source_State &sstate_;
     std::unordered_map<Value, SC_Value, Value::Hash, Value::Hash_Eq>
         valcache_{};
+    // The definition of each constant in valcache_, by SSA variable index.
+    // An outlined function repeats the definitions of the constants that
+    // it shares with its callers.
+    std::unordered_map<unsigned, std::string> constdefs_{};
+    // The number of reactive values compiled by sc_put_value. A constant
+    // containing a reactive value depends on the code that computes it.
+    unsigned reactive_values_ = 0;
     std::vector<Op_Cache> opcaches_{};
     tsl::ordered_map<Symbol_Ref, Shared<const SC_Object>> objects_;
 
-    SC_Compiler(SC_Target t, Source_State& ss)
-    :
-        target_(t), valcount_(0), sstate_(ss)
+    // A closure call whose inline expansion is at least this many bytes of
+    // code is outlined. If negative, calls are always inlined.
+    // Set by the `--inline=N` command line argument.
+    int inline_limit_;
+    std::unordered_map<const Function*, std::vector<SC_Outline>> outlines_{};
+    unsigned outlines_count_ = 0;
+    // The value of outlines_count_ after the last call to emit_objects.
+    unsigned first_outline_ = 0;
+
+    // The code being compiled into a separate function, or nullptr.
+    SC_Capture* capture_ = nullptr;
+    // Closures that can't be outlined because they use the common
+    // subexpressions of the calling code. See emit_objects.
+    std::vector<SC_Outline> isolate_{};
+
+    // The functions defined by define_function, which emit_objects
+    // compiles again if the outlining decisions change.
+    struct Entry
     {
-    }
+        std::vector<SC_Type> param_types_;
+        SC_Type result_type_;
+        Shared<const Function> func_;
+    };
+    std::unordered_map<Symbol_Ref, Entry> entries_{};
+
+    // Statistics, computed by emit_objects and reported in verbose mode:
+    // the number of outlined functions, and the number of calls to them.
+    unsigned outlined_functions_ = 0;
+    unsigned outlined_calls_ = 0;
+
+    SC_Compiler(SC_Target t, Source_State& ss);
 
     std::ostream& out()
     {
@@ -101,6 +162,12 @@ struct SC_Compiler
         SC_Type result_type,
         Shared<const Function> func,
         const Context& cx);
+    Shared<const SC_Function> compile_function(
+        Symbol_Ref name,
+        const std::vector<SC_Type>& param_types,
+        SC_Type result_type,
+        const Function& func,
+        const Context& cx);
 
     inline void push_object(Symbol_Ref n, Shared<const SC_Object> o)
       { objects_.insert(std::pair<Symbol_Ref,Shared<const SC_Object>>{n,o}); }
@@ -112,10 +179,19 @@ struct SC_Compiler
     }
 };
 
+// In GLSL, a uniform variable. In C++, a parameter of a parametric shape,
+// which is a function that reads the parameter from the parameter block
+// `curv_params`, which is passed to each function (see SC_Function::emit).
+// The parameter occupies type_.count() floats, starting at index offset_.
 struct SC_Uniform_Variable : public SC_Object
 {
     SC_Type type_;
+    unsigned offset_ = 0;
     SC_Uniform_Variable(SC_Type t) : type_(t) {}
+    SC_Uniform_Variable(SC_Type t, unsigned offset)
+    :
+        type_(t), offset_(offset)
+    {}
     virtual void emit(SC_Compiler&, Symbol_Ref, std::ostream&) const override;
 };
 
@@ -125,14 +201,21 @@ struct SC_Function : public SC_Object
     SC_Value result_;
     std::stringstream constants_{};
     std::stringstream body_{};
+    // An outlined closure, rather than an entry point defined by
+    // define_function. In C++, it is a static function with no wrapper.
+    bool outlined_;
+    // For an outlined closure, the definitions of the constants that it
+    // shares with its callers.
+    std::string free_constants_{};
     SC_Function(
         std::vector<SC_Value> p, SC_Value r,
-        std::stringstream c, std::stringstream b)
+        std::stringstream c, std::stringstream b, bool outlined = false)
     :
         params_(p),
         result_(r),
         constants_(std::move(c)),
-        body_(std::move(b))
+        body_(std::move(b)),
+        outlined_(outlined)
     {}
     virtual void emit(SC_Compiler&, Symbol_Ref, std::ostream&) const override;
 };
@@ -154,6 +237,10 @@ struct SC_Value_Expr : public Operation
 };
 
 SC_Value sc_eval_op(SC_Frame&, const Operation& op);
+// Evaluate the body of a closure, in a call frame whose parameter slots have
+// been set by pattern matching, and whose other slots are SC_Value::unset.
+// The body is either inline expanded, or compiled as a separate function.
+SC_Value sc_eval_body(SC_Frame&, const Operation& body);
 SC_Value sc_eval_expr(SC_Frame&, const Operation& op, SC_Type);
 SC_Value sc_eval_const(SC_Frame&, Value val, const Phrase&);
 SC_Value sc_vec_element(SC_Frame&, SC_Value, int);
@@ -25,6 +25,9 @@ struct SC_Value
 
     SC_Value(unsigned i, SC_Type t) : index(i), type(t) {}
     SC_Value() noexcept {}
+
+    // The index of a slot that hasn't been set.
+    static constexpr unsigned unset = ~0u;
 };
 
 /// print the GLSL variable name
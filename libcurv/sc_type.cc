@@ -38,6 +38,8 @@ sc_type_of(Value v)
             if (t) return SC_Type::Array(t, n);
         }
     }
+    else if (auto na = v.maybe<Num_Array>())
+        return SC_Type::Array(SC_Type::Num(), na->size());
     else if (auto re = v.maybe<Reactive_Value>())
         return re->sctype_;
     return SC_Type::Error();
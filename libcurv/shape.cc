@@ -84,11 +84,11 @@ Shape_Program::recognize(Value val, Render_Opts* opts)
     bbox_ = BBox::from_value(bbox_val, At_Field("bbox", cx));
 
     dist_fun_ = value_to_function(dist_val, At_Field("dist", cx));
-    dist_frame_ = make_tail_array<Frame>(dist_fun_->nslots_,
+    dist_frame_ = Frame::make(dist_fun_->nslots_,
         sstate_, nullptr, nullptr, nullptr);
 
     colour_fun_ = value_to_function(colour_val, At_Field("colour", cx));
-    colour_frame_ = make_tail_array<Frame>(colour_fun_->nslots_,
+    colour_frame_ = Frame::make(colour_fun_->nslots_,
         sstate_, nullptr, nullptr, nullptr);
 
     Value render_val = r->find_field(render_key, cx);
@@ -137,12 +137,45 @@ Shape_Program::Shape_Program(
             "bad parametric shape: call result has no 'colour' field: ", r)};
 }
 
+// Reuse the argument list in 'cache' for the point [x,y,z,t], unless the
+// function called with it retained a reference.
+static Shared<List>
+reuse_point(Shared<List>& cache, double x, double y, double z, double t)
+{
+    if (cache == nullptr || cache->use_count != 1)
+        cache = make_tail_array<List>(4);
+    (*cache)[0] = Value{x};
+    (*cache)[1] = Value{y};
+    (*cache)[2] = Value{z};
+    (*cache)[3] = Value{t};
+    return cache;
+}
+
+Shared<List>
+Shape_Program::make_point(double x, double y, double z, double t) const
+{
+    if (atomic_refcounts) {
+        // We may be called concurrently: use a per-thread argument list.
+        thread_local Shared<List> point;
+        return reuse_point(point, x, y, z, t);
+    }
+    return reuse_point(point_, x, y, z, t);
+}
+
 double
 Shape_Program::dist(double x, double y, double z, double t) const
 {
     At_Program cx(*this);
-    Shared<List> point = make_tail_array<List>({Value{x}, Value{y}, Value{z}, Value{t}});
-    Value result = dist_fun_->call({point}, Fail::hard, *dist_frame_);
+    if (atomic_refcounts) {
+        // We may be called concurrently: use a private frame.
+        auto frame = Frame::make(dist_fun_->nslots_,
+            sstate_, nullptr, nullptr, nullptr);
+        Value result =
+            dist_fun_->call({make_point(x,y,z,t)}, Fail::hard, *frame);
+        return result.to_num(cx);
+    }
+    Value result =
+        dist_fun_->call({make_point(x,y,z,t)}, Fail::hard, *dist_frame_);
     return result.to_num(cx);
 }
 
@@ -150,8 +183,17 @@ Vec3
 Shape_Program::colour(double x, double y, double z, double t) const
 {
     At_Program cx(*this);
-    Shared<List> point = make_tail_array<List>({Value{x}, Value{y}, Value{z}, Value{t}});
-    Value result = colour_fun_->call({point}, Fail::hard, *colour_frame_);
+    Value result;
+    if (atomic_refcounts) {
+        // We may be called concurrently: use a private frame.
+        auto frame = Frame::make(colour_fun_->nslots_,
+            sstate_, nullptr, nullptr, nullptr);
+        result = colour_fun_->call(
+            {make_point(x,y,z,t)}, Fail::hard, *frame);
+    } else {
+        result = colour_fun_->call(
+            {make_point(x,y,z,t)}, Fail::hard, *colour_frame_);
+    }
     Shared<List> cval = result.to<List>(cx);
     cval->assert_size(3, cx);
     return Vec3{ cval->at(0).to_num(cx),
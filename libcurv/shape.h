@@ -7,6 +7,7 @@
 
 #include <libcurv/frame.h>
 #include <libcurv/function.h>
+#include <libcurv/list.h>
 #include <libcurv/location.h>
 #include <libcurv/vec.h>
 #include <cmath>
@@ -57,6 +58,55 @@ struct Shape
     BBox bbox_;
     virtual double dist(double x, double y, double z, double t) const = 0;
     virtual Vec3 colour(double x, double y, double z, double t) const = 0;
+
+    // Evaluate `dist` at `n` points, stored in structure-of-arrays layout,
+    // writing the results to `out`. Meshers pass a whole scanline per call.
+    // Shapes with a faster batched implementation override this.
+    virtual void dist_batch(
+        const float* xs, const float* ys, const float* zs, float t,
+        float* out, size_t n) const
+    {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = dist(xs[i], ys[i], zs[i], t);
+    }
+
+    // Compute bounds on `dist` over the box [lo,hi] at time t, storing
+    // the lower and upper bound in out[0] and out[1]. Used by meshers to
+    // skip regions that are entirely inside or outside of the shape.
+    // Shapes that support interval arithmetic override this.
+    virtual void dist_interval(
+        const double* lo, const double* hi, double t, double* out) const
+    {
+        out[0] = -INFINITY;
+        out[1] = INFINITY;
+    }
+
+    // Evaluate `dist` and its gradient at `n` points, like dist_batch.
+    // The results are stored in `out` as 4*n floats: the distance, then
+    // the partial derivatives with respect to x, y and z. Returns false
+    // if the shape can't compute an exact gradient, in which case `out` is
+    // not modified, and the caller should use finite differences instead.
+    // Shapes that support automatic differentiation override this.
+    virtual bool dist_grad_batch(
+        const float* xs, const float* ys, const float* zs, float t,
+        float* out, size_t n) const
+    {
+        return false;
+    }
+
+    // Evaluate `colour` at `n` points, like dist_batch. The results are
+    // stored in `out` as 3*n floats, one RGB triple per point.
+    virtual void colour_batch(
+        const float* xs, const float* ys, const float* zs, float t,
+        float* out, size_t n) const
+    {
+        for (size_t i = 0; i < n; ++i) {
+            Vec3 c = colour(xs[i], ys[i], zs[i], t);
+            out[3*i] = c.x;
+            out[3*i+1] = c.y;
+            out[3*i+2] = c.z;
+        }
+    }
 };
 
 struct Shape_Program final : public Shape
@@ -79,6 +129,11 @@ struct Shape_Program final : public Shape
 
     Viewed_Shape* viewed_shape_ = nullptr;
 
+    // The [x,y,z,t] argument list passed to dist and colour. It is reused
+    // by the next call, unless the function retained a reference to it.
+    mutable Shared<List> point_;
+    Shared<List> make_point(double x, double y, double z, double t) const;
+
     Shape_Program(Program&);
 
     Shape_Program(Source_State& sstate, Shared<const Phrase> nub)
@@ -97,6 +152,8 @@ struct Shape_Program final : public Shape
     Shape_Program(const Shape_Program&, Shared<Record>, Viewed_Shape*);
 
     // Invoke the shape's `dist` function.
+    // While atomic_refcounts is true, dist and colour may be called
+    // concurrently from multiple threads.
     double dist(double x, double y, double z, double t) const;
 
     // Invoke the shape's `colour` function.
@@ -99,6 +99,7 @@ struct String_Base : public Abstract_List
     }
     char data_[1];
 };
+template<> struct Ref_Tag<String> : Ref_Subtype_Tag<Ref_Value::sty_string> {};
 
 void write_curv_string(const char*, unsigned, std::ostream&);
 void write_curv_char(char c, char next, unsigned indent, std::ostream& out);
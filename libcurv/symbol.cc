@@ -8,6 +8,9 @@
 #include <libcurv/reactive.h>
 
 #include <cctype>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
 
 namespace curv {
 
@@ -21,15 +24,51 @@ bool is_symbol(Value a)
 
 const char Symbol_Base::name[] = "symbol";
 
+// The same hash function as strhash(), for a string that may not be
+// nul terminated.
+static size_t
+symbol_hash(std::string_view str) noexcept
+{
+    size_t hash = 5381;
+    for (unsigned char c : str)
+        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+    return hash;
+}
+
+// The global symbol table. It is locked, because symbols may be created by
+// multiple threads during a parallel evaluation (see atomic_refcounts).
+// The keys point into the symbols that they map to.
+struct Symbol_Table
+{
+    struct Hash
+    {
+        size_t operator()(std::string_view s) const noexcept
+          { return symbol_hash(s); }
+    };
+    std::mutex mutex_;
+    std::unordered_map<std::string_view, Symbol_Ref, Hash> map_;
+};
+
 Symbol_Ref
 make_symbol(const char* str, size_t len)
 {
-    return Symbol::make(str, len);
+    // The table is never destroyed, so that symbols stored in static
+    // variables remain valid during program exit.
+    static Symbol_Table* table = new Symbol_Table();
+    std::string_view key(str, len);
+    std::lock_guard<std::mutex> lock(table->mutex_);
+    auto i = table->map_.find(key);
+    if (i != table->map_.end())
+        return i->second;
+    Shared<Symbol> sym = Symbol::make(str, len);
+    sym->hash_ = symbol_hash(key);
+    table->map_.emplace(std::string_view(sym->data(), len), Symbol_Ref(sym));
+    return sym;
 }
 
 Symbol_Ref make_symbol(const char* s)
 {
-    return Symbol::make(s, strlen(s));
+    return make_symbol(s, strlen(s));
 }
 
 bool is_C_identifier(const char* p)
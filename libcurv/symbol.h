@@ -20,6 +20,7 @@ using Symbol = String_Mixin<Symbol_Base>;
 struct Symbol_Base : public Ref_Value
 {
     Symbol_Base() : Ref_Value(ty_symbol) {}
+    size_t hash_;
     size_t size_;
     char data_[1];
     size_t size() const noexcept { return size_; }
@@ -29,6 +30,7 @@ struct Symbol_Base : public Ref_Value
     virtual void print_repr(std::ostream&, Prec) const;
     static const char name[];
 };
+template<> struct Ref_Tag<Symbol> : Ref_Type_Tag<Ref_Value::ty_symbol> {};
 
 /// A Symbol_Ref is a short immutable string with an efficient representation.
 ///
@@ -38,12 +40,10 @@ struct Symbol_Base : public Ref_Value
 /// There is a guaranteed global ordering on symbols, which is relied on
 /// for efficiently merging two symbol maps.
 ///
-/// Possible changes in future revisions:
-/// * Add a hash code, so that we can use hash trees for Symbol_Map.
-/// * Use a global symbol table stored in the curv::System object to ensure that
-///   symbols are unique, so we can use pointer equality as symbol equality.
-///   This will also eliminate refcount manipulation, at a cost: the symbol
-///   table slowly grows, never shrinks.
+/// Symbols are interned by make_symbol() in a global symbol table, so each
+/// distinct symbol exists once, and symbol equality is pointer equality.
+/// The hash code is computed once, when the symbol is interned.
+/// The cost is that the symbol table slowly grows, and never shrinks.
 struct Symbol_Ref : private Shared<const Symbol>
 {
 private:
@@ -76,11 +76,12 @@ public:
 
     int cmp(Symbol_Ref a) const noexcept
     {
+        if (this->get() == a.get()) return 0;
         return strcmp((*this)->c_str(), a->c_str());
     }
     friend bool operator==(Symbol_Ref a1, Symbol_Ref a2) noexcept
     {
-        return *a1 == *a2;
+        return a1.get() == a2.get();
     }
     friend bool operator==(Symbol_Ref a1, const char* a2) noexcept
     {
@@ -88,11 +89,11 @@ public:
     }
     friend bool operator!=(Symbol_Ref a1, Symbol_Ref a2) noexcept
     {
-        return !(*a1 == *a2);
+        return a1.get() != a2.get();
     }
     friend bool operator<(Symbol_Ref a1, Symbol_Ref a2) noexcept
     {
-        return *a1 < *a2;
+        return a1.get() != a2.get() && *a1 < *a2;
     }
 
   #if 0
@@ -106,7 +107,7 @@ public:
     {
         a1.swap(a2);
     }
-    inline size_t hash() const noexcept { return strhash(c_str()); }
+    inline size_t hash() const noexcept { return (*this)->hash_; }
     friend std::ostream& operator<<(std::ostream& out, Symbol_Ref a);
     Value to_value() const;
     bool is_identifier() const;
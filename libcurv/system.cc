@@ -9,6 +9,7 @@
 #include <libcurv/exception.h>
 #include <libcurv/import.h>
 #include <libcurv/json.h>
+#include <libcurv/library.h>
 #include <libcurv/program.h>
 #include <libcurv/source.h>
 
@@ -92,6 +93,14 @@ System_Impl::System_Impl(std::ostream& console)
 void System_Impl::load_library(String_Ref path)
 {
     auto file = make<File_Source>(move(path), At_System{*this});
+    if (auto lib = Library::make_lazy(file, *this)) {
+        auto& entries = lib->index_.entries_;
+        for (unsigned i = 0; i < entries.size(); ++i) {
+            std_namespace_[make_symbol(entries[i].name_)] =
+                make<Library_Binding>(lib, i);
+        }
+        return;
+    }
     Program prog{*this};
     prog.compile(move(file));
     auto stdlib = prog.eval();
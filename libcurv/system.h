@@ -10,6 +10,7 @@
 #include <map>
 #include <libcurv/filesystem.h>
 #include <libcurv/builtin.h>
+#include <libcurv/import.h>
 
 namespace curv {
 
@@ -34,6 +35,11 @@ struct System
     // Set by the `--depr=N` command line argument.
     int depr_ = 1;
 
+    // The SubCurv compiler outlines a function call if its inline expansion
+    // is at least this many bytes of code; -1 means never. See SC_Compiler.
+    // Set by the `--inline=N` command line argument.
+    int sc_inline_limit_ = 1000;
+
     // Set to true if you want coloured text to be written on the console.
     bool use_colour_ = false;
 
@@ -59,10 +65,11 @@ struct System
 
     // This is non-empty while a `file` operation is being evaluated.
     // It is used to detect recursive file references.
-    // Later, this may change to a file cache.
-    // Or, it could move into the Program structure.
     std::unordered_set<Filesystem::path,Path_Hash> active_files_{};
 
+    // The values of imported files.
+    Import_Cache import_cache_{};
+
     // Used by `file` to import a file based on its extension.
     // The extension includes the leading '.', and "" means no extension.
     // The extension is converted to lowercase on all platforms.
@@ -96,6 +103,8 @@ struct System_Impl : public System
     Namespace std_namespace_;
     std::ostream& console_;
     System_Impl(std::ostream&);
+    // Add the definitions in a library source file to the std_namespace.
+    // They are compiled lazily, on first reference: see Library.
     void load_library(String_Ref path);
     virtual const Namespace& std_namespace() override;
     virtual std::ostream& console() override;
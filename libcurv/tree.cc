@@ -89,11 +89,13 @@ Value make_tslice(const Value* list, const Value* endlist)
     return b.build(list, endlist);
 }
 
+// The collection is held by reference, so that tree_amend can drop its own
+// reference and update a uniquely owned collection in place.
 struct While_Indexing : public At_Syntax_Wrapper
 {
-    Value collection_;
-    Value index_;
-    While_Indexing(Value c, Value i, const At_Syntax& cx)
+    const Value& collection_;
+    const Value& index_;
+    While_Indexing(const Value& c, const Value& i, const At_Syntax& cx)
       : At_Syntax_Wrapper(cx), collection_(c), index_(i) {}
     Shared<const String> rewrite_message(Shared<const String> s) const override
     {
@@ -116,6 +118,58 @@ struct Bad_Collection : public At_Syntax_Wrapper
             parent_.rewrite_message(s)); }
 };
 
+// `tree` is a list that is also referenced by a Generic_List. Drop this
+// reference, so that if it was the only other one, the Generic_List amends
+// the list in place. A reactive list can't be amended, so it is kept for the
+// error message.
+static void release_list(Value& tree)
+{
+    if (tree.to_ref_unsafe().type_ == Ref_Value::ty_abstract_list)
+        tree = Value{};
+}
+
+// A list of indexes is a List or a Num_Array. A Num_Array is indexed using
+// val_at, instead of being unpacked into a new List.
+static Shared<const Abstract_List> maybe_index_list(Value index)
+{
+    if (index.is_ref()) {
+        auto& r = index.to_ref_unsafe();
+        if (r.subtype_ == Ref_Value::sty_list
+            || r.subtype_ == Ref_Value::sty_num_array)
+        {
+            return share((const Abstract_List&)r);
+        }
+    }
+    return nullptr;
+}
+static void assert_index_count(
+    Value index, const Abstract_List& ilist, size_t sz, const Context& cx)
+{
+    if (ilist.size() != sz)
+        throw Exception(cx,
+            stringify("list ",index," does not have ",sz," elements"));
+}
+
+// Throw an exception if a record doesn't have the field, before the record
+// is moved out of `tree` by update_drecord.
+static void check_field(
+    const Value& tree, Symbol_Ref name, const At_Syntax& cx)
+{
+    if (!tree.to<Record>(Bad_Collection(cx))->hasfield(name))
+        throw Exception(cx, stringify(tree, " has no field named ", name));
+}
+
+// Undo the amendments made to `tree` by an index list, after an exception:
+// old[i] is the element that was replaced at ilist[i]. Each of these
+// amendments has already succeeded once, with the same index.
+static void restore_elements(
+    Value& tree, const Abstract_List& ilist, std::vector<Value>& old,
+    const At_Syntax& cx)
+{
+    for (size_t i = old.size(); i-- > 0; )
+        tree = tree_amend(move(tree), ilist.val_at(i), move(old[i]), cx);
+}
+
 const Phrase& index_value_phrase(const At_Syntax& cx)
 {
     // TODO: more precise
@@ -124,7 +178,7 @@ const Phrase& index_value_phrase(const At_Syntax& cx)
 
 Value get_value_at_boxed_slice(Value value, Value slice, const At_Syntax& cx)
 {
-    auto list = slice.to<const List>(cx);
+    auto list = unpack_list(slice, cx);
     return tree_fetch(value, make_tslice(list->begin(), list->end()), cx);
 }
 
@@ -143,10 +197,10 @@ Value tree_fetch(Value tree, Value index, const At_Syntax& gcx)
         auto rec = tree.to<Record>(Bad_Collection(lcx));
         return rec->getfield(sym, Bad_Index(lcx));
     }
-    else if (auto list = index.maybe<List>()) {
+    else if (auto list = maybe_index_list(index)) {
         List_Builder lb;
-        for (auto i : *list) {
-            auto r = tree_fetch(tree, i, gcx);
+        for (size_t i = 0; i < list->size(); ++i) {
+            auto r = tree_fetch(tree, list->val_at(i), gcx);
             lb.push_back(r);
         }
         return lb.get_value();
@@ -200,10 +254,10 @@ Value tree_fetch_slice(Value tree, Value index, Value index2,
         auto elem = rec->getfield(sym, Bad_Index(lcx));
         return tree_fetch(elem, index2, gcx);
     }
-    else if (auto list = index.maybe<List>()) {
+    else if (auto list = maybe_index_list(index)) {
         List_Builder lb;
-        for (auto i : *list) {
-            auto r = tree_fetch_slice(tree, i, index2, gcx);
+        for (size_t i = 0; i < list->size(); ++i) {
+            auto r = tree_fetch_slice(tree, list->val_at(i), index2, gcx);
             lb.push_back(r);
         }
         return lb.get_value();
@@ -247,7 +301,7 @@ Value tree_fetch_slice(Value tree, Value index, Value index2,
 #endif
     throw Exception(lcx, stringify("Bad index: ", index));
 }
-Value tree_amend(Value tree, Value index, Value elems, const At_Syntax& gcx)
+Value tree_amend(Value&& tree, Value index, Value elems, const At_Syntax& gcx)
 {
     While_Indexing lcx(tree, index, gcx);
     if (index.is_num()) {
@@ -255,32 +309,63 @@ Value tree_amend(Value tree, Value index, Value elems, const At_Syntax& gcx)
         if (num_is_int(num)) {
             Generic_List glist(tree, Fail::hard, Bad_Collection(lcx));
             int i = num_to_int(num, 0, int(glist.size())-1, Bad_Index(lcx));
+            // If glist now holds the only reference, amend it in place.
+            release_list(tree);
             glist.amend_at(i, elems, lcx);
             return glist.get_value();
         }
     }
     else if (auto sym = maybe_symbol(index)) {
-        auto rec = update_drecord(move(tree), Bad_Collection(lcx));
-        auto ref = rec->ref_field(sym, false, lcx);
-        *ref = elems;
+        check_field(tree, sym, lcx);
+        auto rec = update_drecord(tree, Bad_Collection(lcx));
+        *rec->ref_field(sym, false, lcx) = elems;
         return {rec};
     }
-    else if (auto ilist = index.maybe<List>()) {
+    else if (auto ilist = maybe_index_list(index)) {
         Generic_List elist(elems, Fail::hard, lcx);
-        ilist->assert_size(elist.size(), Bad_Index(lcx));
-        auto r = tree;
-        for (unsigned i = 0; i < elist.size(); ++i) {
-            r = tree_amend(r, ilist->at(i), elist.val_at(i,lcx), gcx);
+        assert_index_count(index, *ilist, elist.size(), Bad_Index(lcx));
+        // Amend `tree` in place. The replaced elements are kept, so that
+        // if an exception is thrown, they are restored (in reverse order,
+        // in case an index is repeated), and `tree` is left unchanged.
+        std::vector<Value> old;
+        old.reserve(elist.size());
+        try {
+            for (unsigned i = 0; i < elist.size(); ++i) {
+                Value ix = ilist->val_at(i);
+                Value e = tree_fetch(tree, ix, gcx);
+                tree = tree_amend(move(tree), ix, elist.val_at(i,lcx), gcx);
+                old.push_back(move(e));
+            }
+        } catch (...) {
+            restore_elements(tree, *ilist, old, gcx);
+            throw;
         }
-        return r;
+        return move(tree);
     }
     else if (auto path = index.maybe<TPath>()) {
         Value e = tree_fetch(tree, path->index1_, gcx);
-        Value ne = tree_amend(e, path->index2_, elems, gcx);
-        return tree_amend(tree, path->index1_, ne, gcx);
+        bool cleared = false;
+        if (e.is_ref()
+            && (path->index1_.is_num() || maybe_symbol(path->index1_)))
+        {
+            // Clear the element, so that if the tree and the element are
+            // both uniquely owned, both are amended in place.
+            tree = tree_amend(move(tree), path->index1_, Value{}, gcx);
+            cleared = true;
+        }
+        Value ne;
+        try {
+            ne = tree_amend(move(e), path->index2_, elems, gcx);
+        } catch (...) {
+            if (cleared)
+                tree = tree_amend(move(tree), path->index1_, move(e), gcx);
+            throw;
+        }
+        return tree_amend(move(tree), path->index1_, move(ne), gcx);
     }
     else if (auto sli = index.maybe<TSlice>()) {
-        return tree_amend_slice(tree, sli->index1_, sli->index2_, elems, gcx);
+        return tree_amend_slice(move(tree), sli->index1_, sli->index2_,
+            elems, gcx);
     }
     else if (index.maybe<This>()) {
         return elems;
@@ -288,7 +373,7 @@ Value tree_amend(Value tree, Value index, Value elems, const At_Syntax& gcx)
     // TODO: amend using a reactive index
     throw Exception(lcx, stringify("Bad index: ", index));
 }
-Value tree_amend_slice(Value tree, Value index, Value index2, Value elems,
+Value tree_amend_slice(Value&& tree, Value index, Value index2, Value elems,
     const At_Syntax& gcx)
 {
     While_Indexing lcx(tree, index, gcx);
@@ -297,46 +382,62 @@ Value tree_amend_slice(Value tree, Value index, Value index2, Value elems,
         if (num_is_int(num)) {
             Generic_List glist(tree, Fail::hard, Bad_Collection(lcx));
             int i = num_to_int(num, 0, int(glist.size())-1, Bad_Index(lcx));
-            Value e = glist.val_at(i,lcx);
-            Value ne = tree_amend(e, index2, elems, gcx);
+            Value ne = tree_amend(glist.val_at(i,lcx), index2, elems, gcx);
+            release_list(tree);
             glist.amend_at(i, ne, lcx);
             return glist.get_value();
         }
     }
     else if (auto sym = maybe_symbol(index)) {
-        auto rec = update_drecord(move(tree), Bad_Collection(lcx));
+        check_field(tree, sym, lcx);
+        auto rec = update_drecord(tree, Bad_Collection(lcx));
         auto ref = rec->ref_field(sym, false, lcx);
-        Value ne = tree_amend(*ref, index2, elems, gcx);
-        *ref = ne;
+        try {
+            *ref = tree_amend(move(*ref), index2, elems, gcx);
+        } catch (...) {
+            tree = {rec};
+            throw;
+        }
         return {rec};
     }
-    else if (auto ilist = index.maybe<List>()) {
+    else if (auto ilist = maybe_index_list(index)) {
         Generic_List elist(elems, Fail::hard, lcx);
-        ilist->assert_size(elist.size(), Bad_Index(lcx));
-        auto r = tree;
-        for (unsigned i = 0; i < elist.size(); ++i) {
-            auto e = tree_fetch(r, ilist->at(i), gcx);
-            auto ne = tree_amend(e, index2, elist.val_at(i,lcx), gcx);
-            r = tree_amend(r, ilist->at(i), ne, gcx);
+        assert_index_count(index, *ilist, elist.size(), Bad_Index(lcx));
+        // As in tree_amend, `tree` is amended in place, and restored if an
+        // exception is thrown.
+        std::vector<Value> old;
+        old.reserve(elist.size());
+        try {
+            for (unsigned i = 0; i < elist.size(); ++i) {
+                Value ix = ilist->val_at(i);
+                Value e = tree_fetch(tree, ix, gcx);
+                Value ne = tree_amend(Value{e}, index2, elist.val_at(i,lcx),
+                    gcx);
+                tree = tree_amend(move(tree), ix, move(ne), gcx);
+                old.push_back(move(e));
+            }
+        } catch (...) {
+            restore_elements(tree, *ilist, old, gcx);
+            throw;
         }
-        return r;
+        return move(tree);
     }
     else if (auto path = index.maybe<TPath>()) {
         Value e = tree_fetch(tree, path->index1_, gcx);
-        Value ne = tree_amend(e, path->index2_, elems, gcx);
-        return tree_amend_slice(tree, path->index1_, index2, ne, gcx);
+        Value ne = tree_amend(move(e), path->index2_, elems, gcx);
+        return tree_amend_slice(move(tree), path->index1_, index2, ne, gcx);
     }
     else if (auto slice = index.maybe<TSlice>()) {
         // Rewrite using the associative law of tslice[i,j].
         // This case is rare; only occurs with tslice[tslice[i,j],k].
         // Which usually doesn't happen since tslice[i,j,k]
         // is represented internally as tslice[i,tslice[j,k]].
-        return tree_amend_slice(tree, slice->index1_,
+        return tree_amend_slice(move(tree), slice->index1_,
             Value{make<TSlice>(slice->index2_, index2)},
             elems, gcx);
     }
     else if (index.maybe<This>()) {
-        return tree_amend(tree, index2, elems, gcx);
+        return tree_amend(move(tree), index2, elems, gcx);
     }
     // TODO: amend using a reactive index
     throw Exception(lcx, stringify("Bad index: ", index));
@@ -15,6 +15,7 @@ struct This : public Ref_Value
     This() : Ref_Value(Ref_Value::ty_index, Ref_Value::sty_this) {}
     virtual void print_repr(std::ostream&, Prec) const override;
 };
+template<> struct Ref_Tag<This> : Ref_Subtype_Tag<Ref_Value::sty_this> {};
 struct TPath : public Ref_Value
 {
     TPath(Value i1, Value i2)
@@ -30,6 +31,7 @@ struct TPath : public Ref_Value
              & index2_.equal(right.index2_, cx);
     }
 };
+template<> struct Ref_Tag<TPath> : Ref_Subtype_Tag<Ref_Value::sty_tpath> {};
 Value make_tpath(const Value* list, const Value* endlist);
 struct TSlice : public Ref_Value
 {
@@ -46,6 +48,7 @@ struct TSlice : public Ref_Value
              & index2_.equal(right.index2_, cx);
     }
 };
+template<> struct Ref_Tag<TSlice> : Ref_Subtype_Tag<Ref_Value::sty_tslice> {};
 Value make_tslice(const Value* list, const Value* endlist);
 
 // The 'slice' argument is unboxed to a list of index values.
@@ -53,8 +56,11 @@ Value get_value_at_boxed_slice(Value value, Value slice, const At_Syntax& cx);
 
 Value tree_fetch(Value tree, Value index, const At_Syntax& cx);
 Value tree_fetch_slice(Value tree, Value i1, Value i2, const At_Syntax& cx);
-Value tree_amend(Value tree, Value index, Value elems, const At_Syntax& cx);
-Value tree_amend_slice(Value tree, Value i1, Value i2, Value elems,
+// Return a copy of `tree` with the elements at `index` replaced by `elems`.
+// If `tree` holds the only reference to a list or record, it is moved out
+// and amended in place. If an exception is thrown, `tree` is left unchanged.
+Value tree_amend(Value&& tree, Value index, Value elems, const At_Syntax& cx);
+Value tree_amend_slice(Value&& tree, Value i1, Value i2, Value elems,
     const At_Syntax& cx);
 Value tree_over(Value tree, Value index,
     std::function<Value(Value, At_Syntax&)>, const At_Syntax& cx);
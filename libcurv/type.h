@@ -56,6 +56,7 @@ struct Type : public Ref_Value
 
     static const char name[];
 };
+template<> struct Ref_Tag<Type> : Ref_Type_Tag<Ref_Value::ty_type> {};
 
 inline std::ostream&
 operator<<(std::ostream& out, const Type& type)
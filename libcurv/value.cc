@@ -167,7 +167,8 @@ Ternary Value::equal(Value v, const Context& cx) const
     // Two reference values with the same type.
     switch (r1.type_) {
     case Ref_Value::ty_symbol:
-        return Ternary((Symbol&)r1 == (Symbol&)*r2);
+        // Symbols are interned.
+        return Ternary(&r1 == r2);
     case Ref_Value::ty_abstract_list:
         if (r1.subtype_ == r2->subtype_) {
             switch (r1.subtype_) {
@@ -175,6 +176,8 @@ Ternary Value::equal(Value v, const Context& cx) const
                 return Ternary((String&)r1 == (String&)*r2);
             case Ref_Value::sty_list:
                 return ((List&)r1).equal((List&)*r2, cx);
+            case Ref_Value::sty_num_array:
+                return ((Abstract_List&)r1).aequal((Abstract_List&)*r2, cx);
             }
         } else {
             return ((Abstract_List&)r1).aequal((Abstract_List&)*r2, cx);
@@ -10,6 +10,7 @@
 #include <libcurv/ternary.h>
 #include <cstdint>
 #include <ostream>
+#include <type_traits>
 
 namespace curv {
 
@@ -58,6 +59,7 @@ struct Ref_Value : public Shared_Base
         ty_abstract_list,
             sty_list,
             sty_string,
+            sty_num_array,
         ty_record,
             sty_drecord,
             sty_module,
@@ -101,6 +103,41 @@ struct Ref_Value : public Shared_Base
     virtual void print_help(std::ostream&) const;
 };
 
+/// Ref_Tag<T> maps a subclass T of Ref_Value onto the type or subtype code
+/// that identifies its instances, for use by `ref_cast`. It is specialized
+/// after the definition of each class T such that every Ref_Value with the
+/// given code is a T, and every T has that code. The default, used for open
+/// hierarchies like Closure, is -1, meaning there is no such code.
+template <class T> struct Ref_Tag
+{
+    static constexpr int type = -1;
+    static constexpr int subtype = -1;
+};
+template <int Ty> struct Ref_Type_Tag
+{
+    static constexpr int type = Ty;
+    static constexpr int subtype = -1;
+};
+template <int Sty> struct Ref_Subtype_Tag
+{
+    static constexpr int type = -1;
+    static constexpr int subtype = Sty;
+};
+
+/// Like dynamic_cast for a Ref_Value. If T has a Ref_Tag, this is a type code
+/// comparison and a static_cast, which avoids an RTTI lookup.
+template <class T>
+inline T* ref_cast(Ref_Value& r) noexcept
+{
+    using Tag = Ref_Tag<std::remove_const_t<T>>;
+    if constexpr (Tag::subtype >= 0)
+        return r.subtype_ == Tag::subtype ? static_cast<T*>(&r) : nullptr;
+    else if constexpr (Tag::type >= 0)
+        return r.type_ == Tag::type ? static_cast<T*>(&r) : nullptr;
+    else
+        return dynamic_cast<T*>(&r);
+}
+
 /// A boxed, dynamically typed value in the Curv runtime.
 ///
 /// A Value is 64 bits. 64 bit IEEE floats are represented as themselves
@@ -349,12 +386,12 @@ public:
         #endif
     }
 
-    /// Like dynamic_cast for a Value.
+    /// Like dynamic_cast for a Value. See ref_cast.
     template <class T>
     inline Shared<T> maybe() const noexcept
     {
         if (is_ref()) {
-            T* p = dynamic_cast<T*>(&to_ref_unsafe());
+            T* p = ref_cast<T>(to_ref_unsafe());
             if (p != nullptr)
                 return share(*p);
         }
@@ -364,7 +401,7 @@ public:
     inline Shared<T> to(const Context& cx) const
     {
         if (is_ref()) {
-            T* p = dynamic_cast<T*>(&to_ref_unsafe());
+            T* p = ref_cast<T>(to_ref_unsafe());
             if (p != nullptr)
                 return share(*p);
         }
@@ -375,7 +412,7 @@ public:
     inline Shared<T> to(Fail fl, const Context& cx) const
     {
         if (is_ref()) {
-            T* p = dynamic_cast<T*>(&to_ref_unsafe());
+            T* p = ref_cast<T>(to_ref_unsafe());
             if (p != nullptr)
                 return share(*p);
         }
@@ -58,6 +58,15 @@ Viewed_Shape::Viewed_Shape(const Shape_Program& shape, const Render_Opts& opts)
     //   If I use IMGUI, then I iterate over the parameter table and render
     //   each picker.
 
+    auto shape2 = parametric_shape(shape);
+    std::stringstream frag;
+    export_frag(shape2 ? *shape2 : shape, opts, frag);
+    frag_ = frag.str();
+}
+
+std::unique_ptr<Shape_Program>
+Viewed_Shape::parametric_shape(const Shape_Program& shape)
+{
     static Symbol_Ref argument_key = make_symbol("argument");
     static Symbol_Ref call_key = make_symbol("call");
     static Symbol_Ref picker_key = make_symbol("picker");
@@ -77,6 +86,10 @@ Viewed_Shape::Viewed_Shape(const Shape_Program& shape, const Render_Opts& opts)
             [&](Symbol_Ref name, Value pred, Value value,
                 Shared<const Phrase> nameph) -> void
             {
+                // Use the current value of the parameter, which differs
+                // from the default if the shape was constructed by `call`.
+                if (sh_argument->hasfield(name))
+                    value = sh_argument->getfield(name, cx);
                 auto pred_record = pred.maybe<Record>();
                 if (pred_record && pred_record->hasfield(picker_key)) {
                     auto picker = pred_record->getfield(picker_key,cx);
@@ -95,13 +108,13 @@ Viewed_Shape::Viewed_Shape(const Shape_Program& shape, const Render_Opts& opts)
                     param_.insert(std::pair<const std::string,Parameter>{
                         name.c_str(),
                         Parameter{id, config, state}});
-                    cparams->fields_[name] = {make<Uniform_Variable>(
-                        name, id, config.sctype_, nameph)};
+                    cparams->set(name, {make<Uniform_Variable>(
+                        name, id, config.sctype_, nameph)});
                 } else {
-                    cparams->fields_[name] = value;
+                    cparams->set(name, value);
                 }
             });
-        std::unique_ptr<Frame> f2 = make_tail_array<Frame>(
+        std::unique_ptr<Frame> f2 = Frame::make(
             sh_constructor->nslots_, shape.sstate_, nullptr,
             nullptr, nullptr);
         Value result = sh_constructor->call({cparams}, Fail::hard, *f2);
@@ -112,17 +125,9 @@ Viewed_Shape::Viewed_Shape(const Shape_Program& shape, const Render_Opts& opts)
             throw Exception{cx, stringify(
                 "bad parametric shape: call function returns non-record: ",
                 result)};
-        Shape_Program shape2(shape, r, this);
-
-        std::stringstream frag;
-        export_frag(shape2, opts, frag);
-        frag_ = frag.str();
-    } else {
-        // Non-parametric case.
-        std::stringstream frag;
-        export_frag(shape, opts, frag);
-        frag_ = frag.str();
+        return std::make_unique<Shape_Program>(shape, r, this);
     }
+    return nullptr;
 }
 
 void
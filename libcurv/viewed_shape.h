@@ -9,6 +9,7 @@
 #include <libcurv/render.h>
 #include <libcurv/shape.h>
 #include <tsl/ordered_map.h>
+#include <memory>
 
 namespace curv {
 
@@ -71,6 +72,14 @@ struct Viewed_Shape
 
     bool empty() const { return frag_.empty(); }
 
+    // Recognize a parametric shape. If `shape` is parametric, then add its
+    // parameters (the ones that have pickers) to param_, and return a
+    // version of the shape whose dist and colour functions reference them
+    // as uniform variables. Otherwise return nullptr. The result references
+    // this Viewed_Shape, and is used to compile the shape (see glsl.cc and
+    // Compiled_Shape), after which it can be discarded.
+    std::unique_ptr<Shape_Program> parametric_shape(const Shape_Program&);
+
     // Serialize as a sequence of JSON object fields,
     // without an enclosing '{...}'.
     void write_json(std::ostream&) const;
@@ -0,0 +1,39 @@
+#include "compiled_shape.h"
+#include <gtest/gtest.h>
+#undef FAIL
+#include <libcurv/shape.h>
+#include <libcurv/source.h>
+#include <iostream>
+
+using namespace curv;
+
+Compiled_Test_Shape::Compiled_Test_Shape(
+    const char* src, bool interval, bool gradient)
+:
+    sys_{std::cerr},
+    prog_{sys_}
+{
+    prog_.compile(make<String_Source>("", src));
+    Value val = prog_.eval();
+    Shape_Program shape(prog_);
+    EXPECT_TRUE(shape.recognize(val, nullptr));
+    cshape_ = std::make_unique<io::Compiled_Shape>(shape, interval, gradient);
+}
+
+std::pair<double,double>
+Compiled_Test_Shape::bounds(double lo, double hi)
+{
+    double blo[3] = {lo, lo, lo};
+    double bhi[3] = {hi, hi, hi};
+    double out[2];
+    cshape_->dist_interval(blo, bhi, 0.0, out);
+    return {out[0], out[1]};
+}
+
+std::array<float,4>
+Compiled_Test_Shape::gradient(float x, float y, float z)
+{
+    std::array<float,4> out;
+    EXPECT_TRUE(cshape_->dist_grad_batch(&x, &y, &z, 0.0f, &out[0], 1));
+    return out;
+}
@@ -0,0 +1,23 @@
+#include <libcurv/io/compiled_shape.h>
+#include <libcurv/program.h>
+#include <libcurv/system.h>
+#include <array>
+#include <memory>
+#include <utility>
+
+// Compile the shape `src` to C++, optionally with the interval arithmetic
+// and dual number versions of its distance function.
+struct Compiled_Test_Shape
+{
+    curv::System_Impl sys_;
+    curv::Program prog_;
+    std::unique_ptr<curv::io::Compiled_Shape> cshape_;
+
+    Compiled_Test_Shape(const char* src, bool interval, bool gradient);
+
+    // Bounds on the distance field over the box [lo,hi]^3.
+    std::pair<double,double> bounds(double lo, double hi);
+
+    // The distance and gradient at a point.
+    std::array<float,4> gradient(float x, float y, float z);
+};
@@ -263,6 +263,43 @@ TEST(curv, eval)
     SUCCESS("sqrt(2)", "1.4142135623730951");
     SUCCESS("max(1,2,)", "2"); // test syntax: trailing , after last argument
     SUCCESS("sqrt << sqrt 16", "2");
+
+    // packed lists of numbers (Num_Array)
+    SUCCESS("let a = [for (i in 1..40) i] in count(a * 2)", "40");
+    SUCCESS("let a = [for (i in 1..40) i] in (a + a)[39]", "80");
+    SUCCESS("let a = [for (i in 1..40) i] in (1 - a)[39]", "-39");
+    SUCCESS("let a = [for (i in 1..40) i] in sum(a)", "820");
+    SUCCESS("let a = [for (i in 1..40) i] in (sqrt a)[3]", "2");
+    SUCCESS("let a = [for (i in 1..40) i] in a == [for (i in 1..40) i]",
+        "#true");
+    SUCCESS("let a = [for (i in 1..40) i] in (a < 20)[18]", "#true");
+    SUCCESS("[for (i in 1..32) 0]",
+        "[0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0]");
+    SUCCESS("[...[for (i in 1..40) i], #x][40]", "#x");
+    SUCCESS("let a = [for (i in 1..40) i] in [...a][39]", "40");
+    FAILMSG("[for (i in 0..40) i] / 0", "0 / 0: illegal arguments");
+    SUCCESS("let a = [for (i in 1..40) i] in sum[for (x in a) x*2]", "1640");
+    SUCCESS("let a = [for (i in 1..40) i] in a[a - 1][39]", "40");
+    SUCCESS("let a = [for (i in 1..40) i] in dot(a, a)", "22140");
+    SUCCESS("mag[for (i in 1..36) 1]", "6");
+    SUCCESS("let a = [for (i in 1..40) i] in amend (a-1) (a*0) a == a*0",
+        "#true");
+
+    // in-place update of uniquely owned lists and records
+    SUCCESS("let a = [for (i in 1..40) i] in [((a + 0) < 20)[18], a[18]]",
+        "[#true,19]");
+    SUCCESS("let a = [[1,2],[3,4]] in [-(a + 1), a]",
+        "[[[-2,-3],[-4,-5]],[[1,2],[3,4]]]");
+    SUCCESS("let a = [1,2,3] in do local b = a; b.[0] := 9; in [a,b]",
+        "[[1,2,3],[9,2,3]]");
+    SUCCESS("do local a = [for (i in 1..40) 0];\n"
+            "for (i in 0..<40) a.[i] := i; in sum a", "780");
+    SUCCESS("do local m = [[1,2],[3,4]]; local n = m;\n"
+            "m.[1,0] := 9; in [m,n]", "[[[1,2],[9,4]],[[1,2],[3,4]]]");
+    SUCCESS("do local r = {a:1}; local s = r; r.a := 2; in [r.a, s.a]",
+        "[2,1]");
+    SUCCESS("let a = [1,2,3] in [amend 0 9 a, a]", "[[9,2,3],[1,2,3]]");
+    SUCCESS("let a = [1,2] in [...(a*2), ...a]", "[2,4,1,2]");
     FAILALL("let f=[]->sqrt(true);\nin f[]",
         "argument #1 of sqrt: #true: domain error\n"
         "at function f:\n"
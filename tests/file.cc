@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #undef FAIL
+#include <libcurv/io/file_watcher.h>
 #include <libcurv/io/output_file.h>
+#include <libcurv/program.h>
+#include <libcurv/source.h>
 #include <sstream>
 #include <fstream>
 #include <cstdio>
@@ -62,3 +65,78 @@ TEST(curv, output_file)
     ASSERT_EQ(readfile(p4), "foo");
     remove(",f4");
 }
+
+curv::Value evalstr(const char* expr)
+{
+    curv::Program prog{sys};
+    prog.compile(curv::make<curv::String_Source>("", expr));
+    return prog.eval();
+}
+
+TEST(curv, import_cache)
+{
+    writefile(",import_a.curv", "{b: file \",import_b.curv\", c: 1}");
+    writefile(",import_b.curv", "[1,2]");
+    writefile(",import_c.curv", "{a: file \",import_a.curv\"}");
+
+    // Each file is evaluated once, and the value is shared by its importers.
+    auto a1 = evalstr("file \",import_a.curv\"");
+    auto c1 = evalstr("file \",import_c.curv\"");
+    auto a2 = evalstr("file \",import_a.curv\"");
+    ASSERT_EQ(a1.maybe<curv::Record>(), a2.maybe<curv::Record>());
+    auto a3 = c1.to<curv::Record>(curv::At_System{sys})
+        ->getfield(curv::make_symbol("a"), curv::At_System{sys});
+    ASSERT_EQ(a1.maybe<curv::Record>(), a3.maybe<curv::Record>());
+    auto key = fs::canonical(",import_c.curv");
+    ASSERT_EQ(sys.import_cache_.entries_[key].deps_.size(), 3u);
+
+    // A change to a dependency re-evaluates the files that import it.
+    writefile(",import_b.curv", "[1,2,3]");
+    auto c2 = evalstr("file \",import_c.curv\"");
+    ASSERT_NE(c1.maybe<curv::Record>(), c2.maybe<curv::Record>());
+    ASSERT_EQ(curv::stringify(c2)->c_str(),
+        std::string("{a:{b:[1,2,3],c:1}}"));
+    ASSERT_EQ(curv::stringify(evalstr("file \",import_b.curv\""))->c_str(),
+        std::string("[1,2,3]"));
+
+    remove(",import_a.curv");
+    remove(",import_b.curv");
+    remove(",import_c.curv");
+}
+
+TEST(curv, file_watcher)
+{
+    using namespace std::chrono_literals;
+    writefile(",watch_main.curv", "1");
+
+    // A change made before the watcher is created, while the main file is
+    // being evaluated, is detected by comparing stamps.
+    Watch_List wl(",watch_main.curv");
+    ASSERT_TRUE(wl.main_exists_);
+    ASSERT_FALSE(wl.changed());
+    writefile(",watch_main.curv", "2");
+    fs::last_write_time(",watch_main.curv",
+        fs::last_write_time(",watch_main.curv") + 1s);
+    ASSERT_TRUE(wl.changed());
+
+    // A change to the size is detected, even if the mtime is unchanged.
+    Watch_List wl1(",watch_main.curv");
+    auto mtime = fs::last_write_time(",watch_main.curv");
+    writefile(",watch_main.curv", "22");
+    fs::last_write_time(",watch_main.curv", mtime);
+    ASSERT_TRUE(wl1.changed());
+
+#ifdef __linux__
+    Watch_List wl2(",watch_main.curv");
+    File_Watcher watcher(wl2);
+    ASSERT_TRUE(watcher.ok());
+    ASSERT_FALSE(watcher.wait(0));
+    // Changes to other files in the same directory are ignored.
+    writefile(",watch_other", "x");
+    ASSERT_FALSE(watcher.wait(100));
+    writefile(",watch_main.curv", "3");
+    ASSERT_TRUE(watcher.wait(1000));
+    remove(",watch_other");
+#endif
+    remove(",watch_main.curv");
+}
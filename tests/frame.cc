@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include <libcurv/frame.h>
+#include <libcurv/program.h>
+#include <libcurv/source.h>
+#include <libcurv/sstate.h>
+#include "sys.h"
+#include <thread>
+#include <vector>
+
+using namespace curv;
+
+Value
+eval_program(const char* src)
+{
+    auto source = make<String_Source>("", src);
+    Program prog{sys};
+    prog.compile(source);
+    return prog.eval();
+}
+
+TEST(curv, frame)
+{
+    const char* src =
+        "let count n = if (n <= 0) 0 else 1 + count(n - 1);\n"
+        "    loop n = if (n <= 0) 0 else loop(n - 1);\n"
+        "in count 100 + loop 1000";
+    ASSERT_EQ(eval_program(src).to_num_or_nan(), 100.0);
+
+    // Once the frame pool has warmed up, function calls don't call malloc.
+    Frame_Pool_Stats before = frame_pool_stats();
+    ASSERT_EQ(eval_program(src).to_num_or_nan(), 100.0);
+    Frame_Pool_Stats after = frame_pool_stats();
+    ASSERT_GT(after.allocs - before.allocs, 1100u);
+    ASSERT_EQ(after.mallocs, before.mallocs);
+    ASSERT_EQ(after.frees - before.frees, after.allocs - before.allocs);
+
+    // After a deep recursion, most of the frames are returned to malloc.
+    ASSERT_EQ(eval_program("let count n = if (n <= 0) 0 else 1 + count(n - 1);"
+        " in count 5000").to_num_or_nan(), 5000.0);
+    ASSERT_LT(frame_pool_stats().cached, 5000u);
+}
+
+TEST(curv, frame_other_thread)
+{
+    // Frames freed on another thread go to that thread's pool, which is
+    // bounded like any other pool.
+    Source_State sstate{sys, nullptr};
+    std::vector<std::unique_ptr<Frame>> frames;
+    for (int i = 0; i < 1000; ++i)
+        frames.push_back(Frame::make(3, sstate, nullptr, nullptr, nullptr));
+    size_t cached = 0, frees = 0;
+    std::thread t([&]{
+        frames.clear();
+        cached = frame_pool_stats().cached;
+        frees = frame_pool_stats().frees;
+    });
+    t.join();
+    ASSERT_EQ(frees, 1000u);
+    ASSERT_EQ(cached, 256u);
+}
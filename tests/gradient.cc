@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include "compiled_shape.h"
+
+using namespace curv;
+
+TEST(curv, dist_grad_batch)
+{
+    Compiled_Test_Shape sphere(
+        "{"
+        "  dist [x,y,z,_] = mag[x,y,z] - 1;"
+        "  colour _ = [1,0,0];"
+        "  bbox = [[-1,-1,-1],[1,1,1]];"
+        "  is_2d = false;"
+        "  is_3d = true;"
+        "}", false, true);
+    // The gradient of an exact sphere is the unit vector from the centre.
+    auto g = sphere.gradient(3, 0, 4);
+    EXPECT_FLOAT_EQ(g[0], 4);
+    EXPECT_FLOAT_EQ(g[1], 0.6f);
+    EXPECT_FLOAT_EQ(g[2], 0);
+    EXPECT_FLOAT_EQ(g[3], 0.8f);
+    // At the centre, sqrt is not differentiable, and the gradient is 0.
+    g = sphere.gradient(0, 0, 0);
+    EXPECT_FLOAT_EQ(g[0], -1);
+    EXPECT_FLOAT_EQ(g[1], 0);
+
+    // The gradient of a piecewise function is the gradient of
+    // the selected piece.
+    Compiled_Test_Shape box(
+        "{"
+        "  dist [x,y,z,_] = max(max(abs x, abs y), abs z) - 1;"
+        "  colour _ = [1,0,0];"
+        "  bbox = [[-1,-1,-1],[1,1,1]];"
+        "  is_2d = false;"
+        "  is_3d = true;"
+        "}", false, true);
+    g = box.gradient(0.5f, -2, 0.25f);
+    EXPECT_FLOAT_EQ(g[0], 1);
+    EXPECT_FLOAT_EQ(g[1], 0);
+    EXPECT_FLOAT_EQ(g[2], -1);
+    EXPECT_FLOAT_EQ(g[3], 0);
+
+    // The Shape base class doesn't compute an exact gradient.
+    float x = 0, out[4];
+    EXPECT_FALSE(sphere.cshape_->Shape::dist_grad_batch(
+        &x, &x, &x, 0.0f, out, 1));
+}
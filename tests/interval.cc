@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include "compiled_shape.h"
+#include <cmath>
+
+using namespace curv;
+
+TEST(curv, dist_interval)
+{
+    Compiled_Test_Shape sphere(
+        "{"
+        "  dist [x,y,z,_] = mag[x,y,z] - 1;"
+        "  colour _ = [1,0,0];"
+        "  bbox = [[-1,-1,-1],[1,1,1]];"
+        "  is_2d = false;"
+        "  is_3d = true;"
+        "}", true, false);
+    // a box outside of the sphere
+    auto b = sphere.bounds(2, 3);
+    EXPECT_GE(b.first, std::sqrt(12.0) - 1 - 1e-9);
+    EXPECT_LE(b.first, std::sqrt(12.0) - 1);
+    EXPECT_GE(b.second, std::sqrt(27.0) - 1);
+    // a box inside of the sphere
+    b = sphere.bounds(-0.25, 0.25);
+    EXPECT_LE(b.first, -1);
+    EXPECT_LT(b.second, 0);
+    // a box that contains the surface
+    b = sphere.bounds(0.5, 1);
+    EXPECT_LT(b.first, 0);
+    EXPECT_GT(b.second, 0);
+
+    // An `if` expression with an ambiguous condition
+    // returns the hull of both arms.
+    Compiled_Test_Shape cond(
+        "{"
+        "  dist [x,y,z,_] = if (x > 0) x - 1 else -x - 1;"
+        "  colour _ = [1,0,0];"
+        "  bbox = [[-1,-1,-1],[1,1,1]];"
+        "  is_2d = false;"
+        "  is_3d = true;"
+        "}", true, false);
+    b = cond.bounds(2, 3);
+    EXPECT_GE(b.first, 1 - 1e-9);
+    EXPECT_LE(b.second, 2 + 1e-9);
+    b = cond.bounds(-0.5, 0.5);
+    EXPECT_LE(b.first, -1.5);
+    EXPECT_GE(b.second, -0.5);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include <libcurv/exception.h>
+#include <libcurv/io/tempfile.h>
+#include <libcurv/library.h>
+#include <libcurv/program.h>
+#include <libcurv/source.h>
+#include <libcurv/system.h>
+#include <fstream>
+#include <sstream>
+
+using namespace curv;
+
+static std::string
+eval(System& sys, const char* expr)
+{
+    Program prog{sys};
+    prog.compile(make<String_Source>("", expr));
+    std::ostringstream out;
+    out << prog.eval();
+    return out.str();
+}
+
+TEST(curv, library)
+{
+    auto path = io::register_tempfile(io::make_tempfile_id(), ".curv");
+    {
+        std::ofstream f(path);
+        f << "{\n"
+             "twice x = 2 * x;\n"
+             "four = twice two;\n"
+             "two = 2;\n"
+             "even n = if (n == 0) true else odd(n - 1);\n"
+             "odd n = if (n == 0) false else even(n - 1);\n"
+             "bad = no_such_name;\n"
+             "}\n";
+    }
+    System_Impl lsys(std::cerr);
+    // 'bad' has an error, which isn't reported until it is referenced.
+    ASSERT_NO_THROW(lsys.load_library(make_string(path.string().c_str())));
+    EXPECT_EQ(eval(lsys, "four"), "4");
+    EXPECT_EQ(eval(lsys, "twice 21"), "42");
+    EXPECT_EQ(eval(lsys, "[even 10, odd 7]"), "[#true,#true]");
+    try {
+        eval(lsys, "bad");
+        ADD_FAILURE() << "no exception";
+    } catch (Exception& e) {
+        std::ostringstream msg;
+        e.write(msg, false);
+        EXPECT_NE(msg.str().find("no_such_name: not defined"),
+            std::string::npos);
+        // The error location is the line in the library source file.
+        EXPECT_NE(msg.str().find("7| bad = no_such_name;"), std::string::npos)
+            << msg.str();
+    }
+
+    // The index lists the dependencies of each definition.
+    Library_Index index;
+    auto src = make<File_Source>(make_string(path.string().c_str()),
+        At_System{lsys});
+    ASSERT_TRUE(index.build(*src, lsys));
+    ASSERT_EQ(index.entries_.size(), 6u);
+    EXPECT_EQ(index.entries_[1].name_, "four");
+    EXPECT_EQ(index.entries_[1].deps_, (std::vector<unsigned>{0, 2}));
+    EXPECT_EQ(index.entries_[3].deps_, (std::vector<unsigned>{4}));
+    EXPECT_EQ(index.entries_[5].line_, 6u);
+    EXPECT_EQ(index.entries_[5].column_, 0u);
+    std::stringstream image;
+    index.write(image);
+    Library_Index index2;
+    ASSERT_TRUE(index2.read(image));
+    EXPECT_EQ(index2.entries_[1].deps_, index.entries_[1].deps_);
+    EXPECT_EQ(index2.entries_[5].name_, "bad");
+    EXPECT_EQ(index2.entries_[5].line_, 6u);
+
+    // A file that isn't a module of simple definitions is loaded eagerly.
+    Library_Index index3;
+    auto expr = make<String_Source>("", "{a = 1; include {b = 2}}");
+    EXPECT_FALSE(index3.build(*expr, lsys));
+}
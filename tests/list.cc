@@ -1,7 +1,14 @@
 #include <gtest/gtest.h>
 #undef FAIL
 
+#include <libcurv/context.h>
+#include <libcurv/exception.h>
 #include <libcurv/list.h>
+#include <libcurv/program.h>
+#include <libcurv/record.h>
+#include <libcurv/source.h>
+#include <libcurv/tree.h>
+#include "sys.h"
 
 using namespace std;
 using namespace curv;
@@ -29,4 +36,78 @@ TEST(curv, list)
     (*y)[0] = c;
     (*y)[1] = c;
     ASSERT_TRUE(curv::is_string(Value{y}));
+
+    // A long list of numbers is packed into a Num_Array.
+    List_Builder lb;
+    for (int i = 0; i < int(Num_Array::min_packed); ++i)
+        lb.push_back(Value{double(i)});
+    Value packed = lb.get_value();
+    auto na = packed.maybe<Num_Array>();
+    ASSERT_TRUE(na != nullptr);
+    ASSERT_EQ(na->size(), Num_Array::min_packed);
+    ASSERT_EQ(na->at(3), 3.0);
+
+    // It is only unpacked for code that requires a List.
+    ASSERT_TRUE(packed.maybe<List>() == nullptr);
+    auto li = unpack_list(packed, At_System{sys});
+    ASSERT_TRUE(li != nullptr);
+    ASSERT_EQ(li->size(), Num_Array::min_packed);
+    ASSERT_TRUE(li->at(3).eq(Value{3.0}));
+
+    // A non-number makes it a List.
+    lb.push_back(Value{true});
+    ASSERT_TRUE(lb.get_value().maybe<Num_Array>() == nullptr);
+}
+
+static Value make_list_value(std::initializer_list<Value> elems)
+{
+    return Value{Shared<List>{make_tail_array<List>(elems)}};
+}
+
+TEST(curv, tree_amend)
+{
+    Program prog{sys};
+    prog.compile(make<String_Source>("", "0"));
+    At_Program cx(prog);
+
+    // A uniquely owned tree is amended in place.
+    Value tree = make_list_value({make_list_value({Value{1.0}, Value{2.0}})});
+    Value ix[2] = {Value{0.0}, Value{1.0}};
+    auto list = &tree.to_ref_unsafe();
+    tree = tree_amend(move(tree), make_tpath(ix, ix+2), Value{9.0}, cx);
+    Value expected =
+        make_list_value({make_list_value({Value{1.0}, Value{9.0}})});
+    ASSERT_EQ(&tree.to_ref_unsafe(), list);
+    ASSERT_TRUE(tree.equal(expected, cx).to_bool());
+
+    // If amend fails, the tree is left unchanged.
+    Value bad[2] = {Value{0.0}, Value{7.0}};
+    ASSERT_THROW(
+        tree_amend(move(tree), make_tpath(bad, bad+2), Value{0.0}, cx),
+        Exception);
+    ASSERT_EQ(&tree.to_ref_unsafe(), list);
+    ASSERT_TRUE(tree.equal(expected, cx).to_bool());
+
+    Value rec{make<DRecord>()};
+    ASSERT_THROW(tree_amend(move(rec), make_symbol("x").to_value(), tree, cx),
+        Exception);
+    ASSERT_TRUE(rec.maybe<DRecord>() != nullptr);
+
+    // A list of indexes also amends in place, and if one of the indexes is
+    // bad, the elements amended before it are restored.
+    Value flat = make_list_value({Value{1.0}, Value{2.0}, Value{3.0}});
+    auto flist = &flat.to_ref_unsafe();
+    Value ilist = make_list_value({Value{2.0}, Value{0.0}});
+    flat = tree_amend(move(flat), ilist,
+        make_list_value({Value{7.0}, Value{8.0}}), cx);
+    Value fexpected = make_list_value({Value{8.0}, Value{2.0}, Value{7.0}});
+    ASSERT_EQ(&flat.to_ref_unsafe(), flist);
+    ASSERT_TRUE(flat.equal(fexpected, cx).to_bool());
+
+    Value badlist = make_list_value({Value{0.0}, Value{1.0}, Value{5.0}});
+    ASSERT_THROW(tree_amend(move(flat), badlist,
+        make_list_value({Value{4.0}, Value{5.0}, Value{6.0}}), cx),
+        Exception);
+    ASSERT_EQ(&flat.to_ref_unsafe(), flist);
+    ASSERT_TRUE(flat.equal(fexpected, cx).to_bool());
 }
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include <libcurv/exception.h>
+#include <libcurv/io/compiled_shape.h>
+#include <libcurv/program.h>
+#include <libcurv/shape.h>
+#include <libcurv/source.h>
+#include <libcurv/system.h>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace curv;
+
+// A parametric sphere. `r` and `c` have pickers, `n` does not.
+static const char sphere_src[] =
+    "parametric"
+    "  r :: slider[1,5] = 2;"
+    "  c :: checkbox = false;"
+    "  n = 1;"
+    "in {"
+    "  dist [x,y,z,_] = mag[x,y,z] - r*n + (if (c) 1 else 0);"
+    "  colour _ = [1,0,0];"
+    "  bbox = [[-r,-r,-r],[r,r,r]];"
+    "  is_2d = false;"
+    "  is_3d = true;"
+    "}";
+
+// Evaluate `src` followed by `suffix`, which may call the shape's
+// `call` function to construct another instance of the shape. The standard
+// library defines the pickers.
+struct Parametric_Shape
+{
+    System_Impl sys_{std::cerr};
+    Program prog_{sys_};
+    std::unique_ptr<Shape_Program> shape_;
+    Parametric_Shape(const char* suffix, const char* src = sphere_src)
+    {
+        sys_.load_library("../lib/curv/std.curv");
+        prog_.compile(make<String_Source>("",
+            std::string("(") + src + ")" + suffix));
+        Value val = prog_.eval();
+        shape_ = std::make_unique<Shape_Program>(prog_);
+        EXPECT_TRUE(shape_->recognize(val, nullptr));
+    }
+};
+
+TEST(curv, parametric_jit)
+{
+    Parametric_Shape sphere("");
+    io::Compiled_Shape cshape(*sphere.shape_);
+    EXPECT_EQ(cshape.params_.size(), 2u);
+    EXPECT_FLOAT_EQ(cshape.dist(3, 0, 4, 0), 3);
+
+    // Picker parameters are passed at run time, without recompiling.
+    Parametric_Shape big(".call{r:4}");
+    EXPECT_TRUE(cshape.set_parameters(*big.shape_));
+    EXPECT_FLOAT_EQ(cshape.dist(3, 0, 4, 0), 1);
+    EXPECT_EQ(cshape.bbox_.max.x, 4);
+    float x = 0, y = 0, z = 5, out;
+    cshape.dist_batch(&x, &y, &z, 0.0f, &out, 1);
+    EXPECT_FLOAT_EQ(out, 1);
+
+    Parametric_Shape checked(".call{c:true}");
+    EXPECT_TRUE(cshape.set_parameters(*checked.shape_));
+    EXPECT_FLOAT_EQ(cshape.dist(3, 0, 4, 0), 4);
+
+    // A parameter without a picker is compiled into the code.
+    Parametric_Shape scaled(".call{n:2}");
+    EXPECT_FALSE(cshape.set_parameters(*scaled.shape_));
+    EXPECT_FLOAT_EQ(cshape.dist(3, 0, 4, 0), 4);
+    io::Compiled_Shape cscaled(*scaled.shape_);
+    EXPECT_FLOAT_EQ(cscaled.dist(3, 0, 4, 0), 1);
+
+    // The `call` function of an instance constructs another instance.
+    Parametric_Shape twice(".call{r:3}.call{c:true}");
+    EXPECT_TRUE(cshape.set_parameters(*twice.shape_));
+    EXPECT_FLOAT_EQ(cshape.dist(3, 0, 4, 0), 3);
+}
+
+TEST(curv, parametric_dist_batch)
+{
+    Parametric_Shape sphere("");
+    io::Compiled_Shape cshape(*sphere.shape_);
+    std::vector<float> defaults = cshape.params_;
+    float xs[3] = {3, 0, 0}, ys[3] = {0, 5, 0}, zs[3] = {4, 0, 6}, out[3];
+    cshape.dist_batch(xs, ys, zs, 0.0f, out, 3);
+    EXPECT_FLOAT_EQ(out[0], 3);
+    EXPECT_FLOAT_EQ(out[1], 3);
+    EXPECT_FLOAT_EQ(out[2], 4);
+
+    // Each batch uses the parameter values it is passed.
+    Parametric_Shape other(".call{r:4,c:true}");
+    EXPECT_TRUE(cshape.set_parameters(*other.shape_));
+    EXPECT_NE(cshape.params_, defaults);
+    cshape.dist_batch(xs, ys, zs, 0.0f, out, 3);
+    EXPECT_FLOAT_EQ(out[0], 2);
+    EXPECT_FLOAT_EQ(out[1], 2);
+    EXPECT_FLOAT_EQ(out[2], 3);
+    cshape.dist_batch_(xs, ys, zs, 0.0f, defaults.data(), out, 3);
+    EXPECT_FLOAT_EQ(out[0], 3);
+    EXPECT_FLOAT_EQ(out[1], 3);
+    EXPECT_FLOAT_EQ(out[2], 4);
+}
+
+// `n` is a picker parameter, but SubCurv requires the index of a vector
+// with a variable element to be a constant.
+static const char index_src[] =
+    "parametric"
+    "  n :: int_slider[0,2] = 2;"
+    "in {"
+    "  dist [x,y,z,_] = mag[x,y,z] - [x,y,z].[n];"
+    "  colour _ = [1,0,0];"
+    "  bbox = [[-5,-5,-5],[5,5,5]];"
+    "  is_2d = false;"
+    "  is_3d = true;"
+    "}";
+
+TEST(curv, parametric_jit_fallback)
+{
+    // If the parametric version of the shape doesn't compile, then the
+    // values of the parameters are compiled into the code.
+    Parametric_Shape shape("", index_src);
+    io::Compiled_Shape cshape(*shape.shape_);
+    EXPECT_TRUE(cshape.params_.empty());
+    EXPECT_FLOAT_EQ(cshape.dist(3, 0, 4, 0), 1);
+
+    Parametric_Shape other(".call{n:0}", index_src);
+    EXPECT_FALSE(cshape.set_parameters(*other.shape_));
+    io::Compiled_Shape cother(*other.shape_);
+    EXPECT_FLOAT_EQ(cother.dist(3, 0, 4, 0), 2);
+}
+
+// Parameters with the same names as sphere_src, but `r` has another type,
+// and `c` is missing.
+static const char mistyped_src[] =
+    "parametric"
+    "  r :: checkbox = true;"
+    "  n = 1;"
+    "in {"
+    "  dist [x,y,z,_] = mag[x,y,z] - (if (r) 2 else 1);"
+    "  colour _ = [1,0,0];"
+    "  bbox = [[-2,-2,-2],[2,2,2]];"
+    "  is_2d = false;"
+    "  is_3d = true;"
+    "}";
+
+TEST(curv, parametric_bad_parameters)
+{
+    // A parameter of the wrong type, or a missing parameter, is an error,
+    // and the parameter block is unchanged.
+    Parametric_Shape sphere("");
+    io::Compiled_Shape cshape(*sphere.shape_);
+    std::vector<float> defaults = cshape.params_;
+    Parametric_Shape mistyped("", mistyped_src);
+    EXPECT_THROW(cshape.set_parameters(*mistyped.shape_), Exception);
+    EXPECT_EQ(cshape.params_, defaults);
+    EXPECT_FLOAT_EQ(cshape.dist(3, 0, 4, 0), 3);
+}
+
+TEST(curv, parametric_export)
+{
+    // Export two instances of a shape using the `*` in the output pathname.
+    EXPECT_EQ(std::system("sh params.sh"), 0);
+}
@@ -0,0 +1,20 @@
+# Export two instances of a parametric shape with '-O params=',
+# and check that the meshes differ.
+rm -rf ,params
+mkdir -p ,params
+../debug/curv -o ',params/ball*.stl' -O jit -O mgen=#tmc -O vcount=20 \
+  -O 'params=[{r:1},{r:2}]' params.curv || exit 1
+test -s ,params/ball0.stl && test -s ,params/ball1.stl || exit 1
+cmp -s ,params/ball0.stl ,params/ball1.stl && exit 1
+
+# Bad parameter lists are reported as errors.
+../debug/curv -o ',params/bad*.stl' -O jit \
+  -O 'params=[{r:#foo}]' params.curv 2>,params/err && exit 1
+grep -q 'does not match slider' ,params/err || exit 1
+../debug/curv -o ',params/bad*.stl' -O jit \
+  -O 'params=[{r:1,zz:2}]' params.curv 2>,params/err && exit 1
+grep -q 'bad argument zz' ,params/err || exit 1
+../debug/curv -o ',params/bad*.stl' -O jit \
+  -O 'params=[]' params.curv 2>,params/err && exit 1
+grep -q "'params' must not be empty" ,params/err || exit 1
+exit 0
@@ -25,8 +25,8 @@ TEST(curv, record)
     At_System cx{sys};
 
     auto r = make<DRecord>();
-    r->fields_[make_symbol("a")] = Value{1.0};
-    r->fields_[make_symbol("b")] = Value{true};
+    r->set(make_symbol("a"), Value{1.0});
+    r->set(make_symbol("b"), Value{true});
     ASSERT_TRUE(prints_as(Value{r}, "{a:1,b:#true}"));
     auto i = r->iter();
 
@@ -44,4 +44,24 @@ TEST(curv, record)
 
     // at end
     ASSERT_TRUE(i->empty());
+
+    // Fields are stored in symbol order. Records built by adding the same
+    // fields in the same order share a layout.
+    auto r2 = make<DRecord>();
+    r2->set(make_symbol("b"), Value{false});
+    r2->set(make_symbol("a"), Value{2.0});
+    ASSERT_TRUE(prints_as(Value{r2}, "{a:2,b:#false}"));
+    ASSERT_EQ(r->layout_->find(make_symbol("b")), 1);
+    ASSERT_EQ(r->layout_->find(make_symbol("c")), -1);
+    auto r3 = make<DRecord>();
+    r3->set(make_symbol("a"), Value{3.0});
+    r3->set(make_symbol("b"), Value{true});
+    ASSERT_EQ(r3->layout_, r->layout_);
+    Symbol_Map<Value> fields;
+    fields[make_symbol("b")] = Value{false};
+    fields[make_symbol("a")] = Value{4.0};
+    auto r4 = make<DRecord>(fields);
+    ASSERT_EQ(r4->layout_, r->layout_);
+    ASSERT_TRUE(prints_as(Value{r4}, "{a:4,b:#false}"));
+    ASSERT_EQ(r->clone()->find_field(make_symbol("a"), cx).to_num(cx), 1.0);
 }
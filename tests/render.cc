@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include <libcurv/io/cpu_render.h>
+#include <libcurv/program.h>
+#include <libcurv/shape.h>
+#include <libcurv/source.h>
+#include <libcurv/system.h>
+#include <vector>
+
+using namespace curv;
+
+// Render a shape using the interpreter, and return the RGBA pixels.
+static std::vector<unsigned char>
+render(const char* src, int size)
+{
+    System_Impl sys(std::cerr);
+    Program prog{sys};
+    prog.compile(make<String_Source>("", src));
+    Value val = prog.eval();
+    io::Image_Export ix;
+    ix.aa_ = 1;
+    ix.size = {size, size};
+    Shape_Program shape(prog);
+    EXPECT_TRUE(shape.recognize(val, &ix));
+    std::vector<unsigned char> pixels(size * size * 4);
+    io::cpu_render(shape, ix, pixels.data(), false);
+    return pixels;
+}
+
+TEST(curv, cpu_render)
+{
+    // A red disk of radius 1, with a 4x4 bounding box.
+    auto disk = render(
+        "{"
+        "  dist [x,y,_,_] = mag[x,y] - 1;"
+        "  colour _ = [1,0,0];"
+        "  bbox = [[-2,-2,0],[2,2,0]];"
+        "  is_2d = true;"
+        "  is_3d = false;"
+        "}", 8);
+    // The centre is red, and the corner is the white background.
+    unsigned char* centre = &disk[(4*8 + 4)*4];
+    EXPECT_EQ(centre[0], 255);
+    EXPECT_EQ(centre[1], 0);
+    EXPECT_EQ(disk[0], 255);
+    EXPECT_EQ(disk[1], 255);
+    EXPECT_EQ(disk[3], 255);
+
+    // A ray-marched sphere: the centre pixel is shaded green.
+    auto sphere = render(
+        "{"
+        "  dist [x,y,z,_] = mag[x,y,z] - 1;"
+        "  colour _ = [0,1,0];"
+        "  bbox = [[-1,-1,-1],[1,1,1]];"
+        "  is_2d = false;"
+        "  is_3d = true;"
+        "}", 16);
+    centre = &sphere[(8*16 + 8)*4];
+    EXPECT_LT(centre[0], 200);
+    EXPECT_GT(centre[1], 100);
+    EXPECT_EQ(sphere[0], 255);
+    EXPECT_EQ(sphere[2], 255);
+}
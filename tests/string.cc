@@ -36,6 +36,12 @@ TEST(curv, string)
     ASSERT_FALSE(a0 < a2);
     ASSERT_FALSE(a0 < a0);
 
+    // Symbols are interned.
+    ASSERT_EQ(sym0.get(), make_symbol(std::string("foo")).to_value()
+        .maybe<Symbol>().get());
+    ASSERT_EQ(a0.hash(), strhash("foo"));
+    ASSERT_TRUE(make_symbol("foox", 3) == a0);
+
     Symbol_Ref anull;
     ASSERT_TRUE(anull.empty());
     ASSERT_FALSE(a0.empty());
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include <libcurv/exception.h>
+#include <libcurv/program.h>
+#include <libcurv/shape.h>
+#include <libcurv/source.h>
+#include <thread>
+#include <vector>
+#include "sys.h"
+
+using namespace curv;
+
+TEST(curv, thread)
+{
+    auto source = make<String_Source>("",
+        "let d [x,y,z,_] = mag[x,y,z] - 2 + sin(x*y);\n"
+        "in {is_2d: false, is_3d: true, bbox: [[-3,-3,-3],[3,3,3]],\n"
+        "    dist: p -> d p, colour: p -> [1,0,0]}");
+    Program prog{sys};
+    prog.compile(source);
+    Shape_Program shape(prog);
+    ASSERT_TRUE(shape.recognize(prog.eval(), nullptr));
+
+    constexpr int nthreads = 4;
+    constexpr int npoints = 2000;
+    std::vector<double> expected(npoints);
+    for (int i = 0; i < npoints; ++i)
+        expected[i] = shape.dist(i*0.01, 1.0, -i*0.005, 0.0);
+
+    // With atomic refcounts, the interpreter can be shared by many threads.
+    Atomic_Refcounts atomic;
+    std::vector<std::vector<double>> results(nthreads);
+    Thread_Exception ex;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        threads.emplace_back([&, t]{
+            ex.guard([&]{
+                for (int i = 0; i < npoints; ++i)
+                    results[t].push_back(
+                        shape.dist(i*0.01, 1.0, -i*0.005, 0.0));
+            });
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    ex.rethrow();
+    for (int t = 0; t < nthreads; ++t)
+        ASSERT_EQ(results[t], expected);
+
+    // An exception thrown by a worker is rethrown by the caller.
+    Thread_Exception ex2;
+    std::thread th([&]{
+        ex2.guard([&]{ shape.dist(0.0, 0.0, 0.0, 0.0); });
+        ex2.guard([&]{ throw Exception(At_Program(shape), "boom"); });
+    });
+    th.join();
+    ASSERT_THROW(ex2.rethrow(), Exception);
+}
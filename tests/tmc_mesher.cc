@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include <curv/mesher.h>
+#include <libcurv/program.h>
+#include <libcurv/shape.h>
+#include <libcurv/source.h>
+#include <libcurv/system.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace curv;
+using namespace curv::io;
+
+struct Sphere_Shape : public Shape
+{
+    Sphere_Shape()
+    {
+        is_2d_ = false;
+        is_3d_ = true;
+        bbox_ = BBox{glm::dvec3(-2), glm::dvec3(2)};
+    }
+    virtual double dist(double x, double y, double z, double) const
+    {
+        return std::sqrt(x*x + y*y + z*z) - 2;
+    }
+    virtual Vec3 colour(double, double, double, double) const
+    {
+        return Vec3{1, 0, 0};
+    }
+};
+
+// A quad mesh, read from the OBJ output of the TMC mesher.
+struct Obj_Mesh
+{
+    std::vector<std::array<double,3>> v_;
+    std::vector<std::array<int,4>> quad_;
+
+    Obj_Mesh(Mesh_Export& opts)
+    {
+        System_Impl sys(std::cerr);
+        Program prog(sys);
+        prog.compile(make<String_Source>("", "0")); // for error messages
+        At_Program cx(prog);
+        Sphere_Shape shape;
+        Mesh_Bench bench;
+        std::ostringstream out;
+        tmc_mesher(shape, true, opts, bench, cx, Mesh_Format::obj, out);
+        std::istringstream in(out.str());
+        std::string tag;
+        while (in >> tag) {
+            if (tag == "v") {
+                std::array<double,3> v;
+                in >> v[0] >> v[1] >> v[2];
+                v_.push_back(v);
+            } else if (tag == "f") {
+                std::array<int,4> q;
+                in >> q[0] >> q[1] >> q[2] >> q[3];
+                quad_.push_back(q);
+            }
+        }
+    }
+
+    // The number of edges that aren't shared by exactly two quads.
+    int open_edges() const
+    {
+        std::map<std::pair<int,int>, int> edges;
+        for (auto& q : quad_) {
+            for (int i = 0; i < 4; ++i) {
+                int a = q[i], b = q[(i+1)%4];
+                ++edges[{std::min(a,b), std::max(a,b)}];
+            }
+        }
+        int n = 0;
+        for (auto& e : edges)
+            n += (e.second != 2);
+        return n;
+    }
+
+    std::vector<std::array<double,3>> sorted_vertices() const
+    {
+        auto v = v_;
+        std::sort(v.begin(), v.end());
+        return v;
+    }
+};
+
+TEST(curv, tmc_narrowband)
+{
+    // Evaluating only the voxels near the surface gives the same mesh.
+    Mesh_Export opts;
+    opts.vcount_ = 300000;
+    Obj_Mesh dense(opts);
+    opts.narrowband_ = true;
+    Obj_Mesh narrow(opts);
+    EXPECT_GT(dense.quad_.size(), 0u);
+    EXPECT_EQ(narrow.quad_.size(), dense.quad_.size());
+    EXPECT_EQ(narrow.sorted_vertices(), dense.sorted_vertices());
+    EXPECT_EQ(narrow.open_edges(), 0);
+}
+
+TEST(curv, tmc_chunked)
+{
+    // A mesh assembled from slabs is closed, and the vertices on the seams
+    // between the slabs are not duplicated.
+    Mesh_Export opts;
+    opts.vcount_ = 40000;
+    opts.chunk_ = 8;
+    Obj_Mesh chunked(opts);
+    EXPECT_GT(chunked.quad_.size(), 0u);
+    EXPECT_EQ(chunked.open_edges(), 0);
+    auto v = chunked.sorted_vertices();
+    EXPECT_EQ(std::adjacent_find(v.begin(), v.end()), v.end());
+
+    opts.narrowband_ = true;
+    Obj_Mesh narrow(opts);
+    EXPECT_EQ(narrow.sorted_vertices(), v);
+    EXPECT_EQ(narrow.quad_.size(), chunked.quad_.size());
+}
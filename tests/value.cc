@@ -134,6 +134,14 @@ TEST(curv, value)
     ASSERT_TRUE(v.is_ref());
     EXPECT_TRUE(v.to_ref_unsafe().use_count == 1);
     EXPECT_TRUE(v.to_ref_unsafe().type_ == Ref_Value::ty_function);
+    // maybe<T> uses type codes for Function, and RTTI for its subclasses.
+    EXPECT_TRUE(v.maybe<Function>() != nullptr);
+    EXPECT_TRUE(v.maybe<const Tuple_Function>() != nullptr);
+    EXPECT_TRUE(v.maybe<Closure>() == nullptr);
+    EXPECT_TRUE(v.maybe<String>() == nullptr);
+    Value str{make_string("abc")};
+    EXPECT_TRUE(str.maybe<const Abstract_List>() != nullptr);
+    EXPECT_TRUE(str.maybe<List>() == nullptr);
     Tuple_Function* f = (Tuple_Function*)&v.to_ref_unsafe();
     EXPECT_TRUE(f->use_count == 1);
     EXPECT_TRUE(f->type_ == Ref_Value::ty_function);
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#undef FAIL
+#include <libcurv/io/mesh.h>
+#include <libcurv/shape.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace curv;
+using namespace curv::io;
+
+// Three faces of a tetrahedron. Vertex 0 is not used, so that the
+// smallest vertex index is 1.
+struct Test_Mesh : public Mesh
+{
+    std::vector<glm::vec3> v_{
+        {9,9,9}, {0,0,0}, {1,0,0}, {0,1,0}, {0,0,1}};
+    std::vector<glm::ivec3> tri_{{1,3,2}, {1,2,4}, {1,4,3}};
+    virtual void each_triangle(std::function<void(const glm::ivec3&)> f)
+    {
+        for (auto& t : tri_) f(t);
+    }
+    virtual void each_quad(std::function<void(const glm::ivec4&)>) {}
+    virtual void all_triangles(std::function<void(const glm::ivec3&)> f)
+    {
+        for (auto& t : tri_) f(t);
+    }
+    virtual unsigned num_vertices() { return v_.size(); }
+    virtual glm::vec3 vertex(unsigned i) { return v_[i]; }
+};
+
+struct Test_Shape : public Shape
+{
+    Test_Shape()
+    {
+        is_2d_ = false;
+        is_3d_ = true;
+        bbox_ = BBox{glm::dvec3(-1), glm::dvec3(1)};
+    }
+    virtual double dist(double x, double y, double z, double) const
+    {
+        return std::sqrt(x*x + y*y + z*z) - 1;
+    }
+    virtual Vec3 colour(double, double, double, double) const
+    {
+        return Vec3{1, 0, 0};
+    }
+};
+
+static uint32_t get_u32(const std::string& s, size_t pos)
+{
+    uint32_t n = 0;
+    for (int i = 3; i >= 0; --i)
+        n = (n << 8) | uint8_t(s[pos + i]);
+    return n;
+}
+
+static float get_float(const std::string& s, size_t pos)
+{
+    uint32_t n = get_u32(s, pos);
+    float f;
+    std::memcpy(&f, &n, 4);
+    return f;
+}
+
+TEST(curv, write_binary_stl)
+{
+    Test_Mesh mesh;
+    Test_Shape shape;
+    std::ostringstream out;
+    auto stats = write_mesh(Mesh_Format::stl_binary, mesh, shape, false,
+        Mesh_Export{}, out);
+    std::string stl = out.str();
+    EXPECT_EQ(stats.ntri, 3u);
+
+    // An 80 byte header that doesn't begin with "solid" (which would mark
+    // an ASCII STL file), the triangle count, then 50 bytes per triangle.
+    ASSERT_EQ(stl.size(), 80u + 4u + 3u * 50u);
+    EXPECT_NE(stl.compare(0, 5, "solid"), 0);
+    EXPECT_EQ(get_u32(stl, 80), 3u);
+
+    // The second triangle is {1,2,4}, with normal (0,-1,0).
+    size_t tri = 84 + 50;
+    EXPECT_FLOAT_EQ(get_float(stl, tri + 0), 0);
+    EXPECT_FLOAT_EQ(get_float(stl, tri + 4), -1);
+    EXPECT_FLOAT_EQ(get_float(stl, tri + 8), 0);
+    EXPECT_FLOAT_EQ(get_float(stl, tri + 12 + 12), 1); // v1.x
+    EXPECT_FLOAT_EQ(get_float(stl, tri + 12 + 32), 1); // v2.z
+    EXPECT_EQ(stl[tri + 48], 0);
+    EXPECT_EQ(stl[tri + 49], 0);
+}
+
+TEST(curv, write_glb)
+{
+    Test_Mesh mesh;
+    Test_Shape shape;
+    Mesh_Export opts;
+    opts.normals_ = true;
+    opts.colours_ = true;
+    std::ostringstream out;
+    write_mesh(Mesh_Format::glb, mesh, shape, false, opts, out);
+    std::string glb = out.str();
+
+    // The 12 byte header: magic, version, total length.
+    ASSERT_GE(glb.size(), 20u);
+    EXPECT_EQ(glb.compare(0, 4, "glTF"), 0);
+    EXPECT_EQ(get_u32(glb, 4), 2u);
+    EXPECT_EQ(get_u32(glb, 8), glb.size());
+
+    // The JSON chunk, padded to 4 bytes.
+    uint32_t json_len = get_u32(glb, 12);
+    EXPECT_EQ(glb.compare(16, 4, "JSON"), 0);
+    EXPECT_EQ(json_len % 4, 0u);
+    ASSERT_LE(20u + json_len + 8u, glb.size());
+    std::string json = glb.substr(20, json_len);
+    EXPECT_NE(json.find("\"min\": [1]"), std::string::npos);
+    EXPECT_NE(json.find("\"max\": [4]"), std::string::npos);
+
+    // The binary chunk: 9 16 bit indices, padded to 20 bytes, then the
+    // positions, normals and colours of 5 vertices.
+    size_t bin = 20 + json_len;
+    uint32_t bin_len = get_u32(glb, bin);
+    EXPECT_EQ(glb.compare(bin + 4, 4, std::string("BIN\0", 4)), 0);
+    EXPECT_EQ(bin_len % 4, 0u);
+    EXPECT_EQ(bin_len, 20u + 3u * 5u * 12u);
+    EXPECT_EQ(bin + 8 + bin_len, glb.size());
+    EXPECT_NE(json.find("\"byteLength\": " + std::to_string(bin_len)),
+        std::string::npos);
+    EXPECT_NE(json.find("\"byteOffset\": 20,"), std::string::npos);
+}
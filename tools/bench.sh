@@ -0,0 +1,40 @@
+#!/bin/sh
+#
+# Usage: bench.sh [curv-executable] [vcount]
+#
+# Export a fixed corpus of example shapes using each mesh generator, with and
+# without '-O jit', and print the '-O bench' results as a JSON array.
+# Run it from the top of the source tree. Override the corpus, the mesh
+# generators or the output format using EXAMPLES, MGENS and FORMAT.
+#
+CURV=${1:-curv}
+VCOUNT=${2:-200000}
+EXAMPLES=${EXAMPLES:-"stella fat_bottom_mug twistor tyre menger finial"}
+MGENS=${MGENS:-"smooth sharp iso hybrid tmc"}
+FORMAT=${FORMAT:-ply}
+
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+echo "["
+SEP=""
+for EXAMPLE in $EXAMPLES; do
+    for MGEN in $MGENS; do
+        for JIT in false true; do
+            echo "$EXAMPLE mgen=$MGEN jit=$JIT" >&2
+            RESULT=$("$CURV" -o "$TMPDIR/out.$FORMAT" \
+                -O bench -O "mgen=#$MGEN" -O "jit=$JIT" -O "vcount=$VCOUNT" \
+                "examples/$EXAMPLE.curv" 2>"$TMPDIR/log")
+            if [ $? -eq 0 ] && [ -n "$RESULT" ]; then
+                printf '%s  {"example":"%s",%s' "$SEP" "$EXAMPLE" "${RESULT#\{}"
+            else
+                printf '%s  {"example":"%s","mgen":"%s","jit":%s,"error":true}' \
+                    "$SEP" "$EXAMPLE" "$MGEN" "$JIT"
+            fi
+            SEP=",
+"
+        done
+    done
+done
+echo
+echo "]"
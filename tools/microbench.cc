@@ -0,0 +1,138 @@
+// Copyright 2016-2021 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+// Micro-benchmarks for the evaluator.
+//
+// Usage: microbench [curv-expression]
+//
+// Times Value::maybe<T> (which uses type codes, see ref_cast) against the
+// equivalent dynamic_cast, on a mix of values. Then times copying values,
+// which updates reference counts, with and without atomic_refcounts. Then
+// times the evaluation of a builtin-heavy Curv expression, which can be given
+// as an argument.
+// Run it from the top of the source tree, so that lib/curv/std.curv is found.
+
+#include <libcurv/exception.h>
+#include <libcurv/function.h>
+#include <libcurv/io/builtin.h>
+#include <libcurv/list.h>
+#include <libcurv/num.h>
+#include <libcurv/program.h>
+#include <libcurv/reactive.h>
+#include <libcurv/record.h>
+#include <libcurv/source.h>
+#include <libcurv/string.h>
+#include <libcurv/system.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace curv;
+
+template <class T>
+Shared<T> rtti_maybe(Value v)
+{
+    if (v.is_ref()) {
+        T* p = dynamic_cast<T*>(&v.to_ref_unsafe());
+        if (p != nullptr)
+            return share(*p);
+    }
+    return nullptr;
+}
+
+template <class F>
+double best_time(int reps, F f)
+{
+    double best = 1e30;
+    for (int i = 0; i < reps; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    const char* expr = argc > 1 ? argv[1]
+        : "sum[for (i in 1..100000) "
+          "max[i, count[i,i]] + (if (is_list [i]) 1 else 0) + {a:i}.a]";
+    try {
+        System_Impl sys(std::cerr);
+        io::add_builtins(sys);
+        sys.load_library(make_string("lib/curv/std.curv"));
+
+        Program fprog{sys};
+        fprog.compile(make<String_Source>("", "max"));
+        Value func = fprog.eval();
+
+        std::vector<Value> values;
+        for (int i = 0; i < 1000; ++i) {
+            switch (i % 5) {
+            case 0: values.push_back({make_list(1)}); break;
+            case 1: values.push_back({make<DRecord>()}); break;
+            case 2: values.push_back({make_string("abc")}); break;
+            case 3: values.push_back(Value{double(i)}); break;
+            case 4: values.push_back(func); break;
+            }
+        }
+        const int n = 1000;
+        unsigned hits = 0;
+        double tag_t = best_time(5, [&]{
+            for (int r = 0; r < n; ++r) for (auto& v : values) {
+                hits += v.maybe<List>() != nullptr;
+                hits += v.maybe<Record>() != nullptr;
+                hits += v.maybe<Function>() != nullptr;
+                hits += v.maybe<Reactive_Value>() != nullptr;
+            }
+        });
+        double rtti_t = best_time(5, [&]{
+            for (int r = 0; r < n; ++r) for (auto& v : values) {
+                hits += rtti_maybe<List>(v) != nullptr;
+                hits += rtti_maybe<Record>(v) != nullptr;
+                hits += rtti_maybe<Function>(v) != nullptr;
+                hits += rtti_maybe<Reactive_Value>(v) != nullptr;
+            }
+        });
+        double casts = 4.0 * n * values.size();
+        std::cout << "maybe<T>:     " << tag_t / casts * 1e9 << " ns/cast\n"
+                  << "dynamic_cast: " << rtti_t / casts * 1e9 << " ns/cast\n";
+
+        // Each copy and destruction of a Value updates a reference count.
+        std::vector<Value> copies(values.size());
+        auto copy_values = [&]{
+            for (int r = 0; r < n; ++r) {
+                for (size_t i = 0; i < values.size(); ++i)
+                    copies[i] = values[i];
+                for (auto& v : copies)
+                    v = Value{};
+            }
+        };
+        double copy_t = best_time(5, copy_values);
+        double atomic_t;
+        {
+            Atomic_Refcounts atomic;
+            atomic_t = best_time(5, copy_values);
+        }
+        double copies_n = double(n) * values.size();
+        std::cout << "copy Value:   " << copy_t / copies_n * 1e9 << " ns\n"
+                  << "  (atomic):   " << atomic_t / copies_n * 1e9 << " ns\n";
+
+        // A Program can only be evaluated once.
+        double eval_t = 1e30;
+        Value result;
+        for (int i = 0; i < 5; ++i) {
+            Program prog{sys};
+            prog.compile(make<String_Source>("", expr));
+            eval_t = std::min(eval_t,
+                best_time(1, [&]{ result = prog.eval(); }));
+        }
+        std::cout << "eval: " << eval_t * 1e3 << " ms => " << result << "\n";
+        return hits == 0;
+    } catch (std::exception& e) {
+        System::print_exception("ERROR: ", e, std::cerr);
+        return 1;
+    }
+}